@@ -3,6 +3,7 @@
 #include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <string>
 
 #define BUFFER_LENGTH 8192
 
@@ -26,6 +27,17 @@ static constexpr int BUFFER_POOL_SIZE = 65536;                                //
 // static constexpr int BUFFER_POOL_SIZE = 262144;                                // size of buffer pool 1GB
 static constexpr int LOG_BUFFER_SIZE = (1024 * PAGE_SIZE);                    // size of a log buffer in byte
 static constexpr int BUCKET_SIZE = 50;                                        // size of extendible hash bucket
+static constexpr int ASYNC_IO_QUEUE_DEPTH = 64;                               // max in-flight io_uring requests
+static constexpr int DIRECT_IO_ALIGNMENT = 4096;                              // buffer/offset/length alignment of O_DIRECT
+static constexpr int WRITE_BACK_RUN_PAGES = 32;                               // max adjacent dirty pages written back with one eviction
+static constexpr int BUFFER_POOL_SHARDS = 16;                                 // max number of independently latched buffer pool partitions
+static constexpr int MIN_FRAMES_PER_SHARD = 64;                               // smaller pools use fewer partitions
+static constexpr int BUFFER_RING_SIZE = 32;                                   // frames in the private ring of a large sequential scan
+static constexpr int BUFFER_RING_THRESHOLD = 4;                               // scans of tables larger than pool_size / BUFFER_RING_THRESHOLD use a ring
+static constexpr int PREFETCH_PAGES = 16;                                     // pages a sequential scan reads ahead, at most BUFFER_RING_SIZE / 2
+static constexpr size_t CACHE_LINE_SIZE = 64;                                 // frame descriptors are aligned to cache lines
+static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;                     // the frame arena is mapped in units of 2MB huge pages
+static constexpr size_t STAT_COUNTER_SLOTS = 64;                              // per-thread slots of the buffer pool statistics counters
 
 using frame_id_t = int32_t;  // frame id type, 帧页ID, 页在BufferPool中的存储单元称为帧,一帧对应一页
 using page_id_t = int32_t;   // page id type , 页ID
@@ -38,7 +50,29 @@ using timestamp_t = int32_t;  // timestamp type, used for transaction concurrenc
 // log file
 static const std::string LOG_FILE_NAME = "db.log";
 
-// replacer
+// replacer: "LRU", "CLOCK" or "LRU-K"
 static const std::string REPLACER_TYPE = "LRU";
+static constexpr size_t LRU_K = 2;  // number of accesses the LRU-K replacer keeps per frame
+
+// background page cleaner: keeps PAGE_CLEANER_CLEAN_FRAMES clean evictable frames, checking every PAGE_CLEANER_INTERVAL
+// off by default: LogManager reports no flushed LSN and pages carry no LSN yet, so the cleaner cannot enforce the WAL rule
+static constexpr bool ENABLE_PAGE_CLEANER = false;
+static constexpr size_t PAGE_CLEANER_CLEAN_FRAMES = BUFFER_POOL_SIZE / 16;
+static constexpr std::chrono::milliseconds PAGE_CLEANER_INTERVAL{100};
+
+// open table and index files with O_DIRECT, bypassing the kernel page cache
+static constexpr bool ENABLE_DIRECT_IO = false;
+
+// back the buffer pool frame arena with huge pages: MAP_HUGETLB if pages are reserved, otherwise transparent huge pages
+static constexpr bool ENABLE_HUGE_PAGES = true;
+
+// write flushed pages of checksummed files to a doublewrite file first, so torn pages can be repaired at startup
+static constexpr bool ENABLE_DOUBLEWRITE = false;
+static constexpr size_t DOUBLEWRITE_PAGES = 512;  // size of the doublewrite file in pages, including record headers
+
+// CREATE INDEX sorts the keys of the table and builds the B+ tree bottom up instead of inserting row by row
+static constexpr double INDEX_FILL_FACTOR = 0.9;                  // fraction of btree_order filled in each bulk-loaded node
+static constexpr size_t INDEX_SORT_BUFFER_SIZE = 64 * 1024 * 1024;  // bytes of (key, rid) pairs sorted in memory before spilling a run
 
 static const std::string DB_META_NAME = "db.meta";
+static const std::string DOUBLEWRITE_FILE_NAME = "db.dblwr";
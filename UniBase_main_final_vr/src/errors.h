@@ -148,4 +148,17 @@ class PageNotExistError : public UniBaseError {
    public:
     PageNotExistError(const std::string &table_name, int page_no)
         : UniBaseError("Page " + std::to_string(page_no) + " in table " + table_name + "not exits") {}
-};
\ No newline at end of file
+};
+
+class FileFormatError : public UniBaseError {
+   public:
+    FileFormatError(const std::string &filename, int version, int expected)
+        : UniBaseError("Unsupported format version " + std::to_string(version) + " of file " + filename +
+                       " (expected " + std::to_string(expected) + "), recreate it with this version") {}
+};
+
+class PageChecksumError : public UniBaseError {
+   public:
+    PageChecksumError(int fd, int page_no)
+        : UniBaseError("Checksum mismatch in page " + std::to_string(page_no) + " of file " + std::to_string(fd)) {}
+};
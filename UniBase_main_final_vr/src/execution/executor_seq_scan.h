@@ -43,9 +43,10 @@ class SeqScanExecutor : public AbstractExecutor {
             // 获取扫描器当前记录的 rid
             rid_ = scan_->rid();
             try {
-                auto rec = fh_->get_record(rid_, context_); 
-                // 利用eval_conds判断是否当前记录(rec.get())满足谓词条件、满足则中止循环
-                if( eval_conds( cols_, fed_conds_, rec.get() ) ) 
+                // 直接在页面中的记录上判断谓词，不复制记录
+                auto rec = fh_->get_record_view(rid_, context_); 
+                // 利用eval_conds判断是否当前记录(rec.data)满足谓词条件、满足则中止循环
+                if( eval_conds( cols_, fed_conds_, rec.data ) ) 
                     break;
             } 
             // 捕获记录未找到的异常
@@ -64,9 +65,9 @@ class SeqScanExecutor : public AbstractExecutor {
             // 获取当前记录赋给算子成员rid_
             rid_ = scan_->rid();
             try {
-                auto rec = fh_->get_record(rid_, context_);  
-                // 利用eval_conds判断是否当前记录(rec.get())满足谓词条件
-                if( eval_conds( cols_, fed_conds_, rec.get() ) )
+                auto rec = fh_->get_record_view(rid_, context_);  
+                // 利用eval_conds判断是否当前记录(rec.data)满足谓词条件
+                if( eval_conds( cols_, fed_conds_, rec.data ) )
                     break;
             }
             // 捕获记录未找到的异常 
@@ -83,13 +84,13 @@ class SeqScanExecutor : public AbstractExecutor {
 
     Rid &rid() override { return rid_; }
 
-    bool eval_cond(const std::vector<ColMeta> &rec_cols, const Condition &cond, const RmRecord *rec) {
+    bool eval_cond(const std::vector<ColMeta> &rec_cols, const Condition &cond, const char *rec) {
         // 获取左操作数列的元数据
         auto lhs_col = get_col(rec_cols, cond.lhs_col);
         // 获取左操作数的指针
-        char *lhs = rec->data + lhs_col->offset;
+        const char *lhs = rec + lhs_col->offset;
         // 右操作数的指针和类型
-        char *rhs;
+        const char *rhs;
         ColType rhs_type;
 
         // 如果右操作数是值
@@ -103,7 +104,7 @@ class SeqScanExecutor : public AbstractExecutor {
             auto rhs_col = get_col(rec_cols, cond.rhs_col);
             // 获取右操作数的类型和指针
             rhs_type = rhs_col->type;
-            rhs = rec->data + rhs_col->offset;
+            rhs = rec + rhs_col->offset;
         }
 
         // 断言左右操作数类型相同
@@ -132,7 +133,7 @@ class SeqScanExecutor : public AbstractExecutor {
     }
 
     //用于检查给定记录是否满足所有给定的条件
-    bool eval_conds(const std::vector<ColMeta> &rec_cols, const std::vector<Condition> &conds, const RmRecord *rec) {
+    bool eval_conds(const std::vector<ColMeta> &rec_cols, const std::vector<Condition> &conds, const char *rec) {
         return std::all_of(conds.begin(), conds.end(),
                            [&](const Condition &cond) { return eval_cond(rec_cols, cond, rec); });
     }
@@ -2,3 +2,4 @@
 
 #include "ix_scan.h"
 #include "ix_manager.h"
+#include "ix_bulk_loader.h"
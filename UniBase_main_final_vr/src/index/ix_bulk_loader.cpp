@@ -0,0 +1,332 @@
+#include "ix_bulk_loader.h"
+
+#include <algorithm>
+#include <cstdio>
+
+static constexpr size_t RUN_READ_BUFFER_SIZE = 1024 * 1024;  // 归并时每个有序段一次读入的字节数
+
+IxEntrySorter::IxEntrySorter(const IxIndexHandle *ih, const std::string &run_prefix, size_t sort_buffer_size)
+    : file_hdr_(ih->file_hdr_), run_prefix_(run_prefix) {
+    entry_len_ = file_hdr_->col_tot_len_ + sizeof(Rid);
+    buffer_entries_ = std::max<size_t>(1, sort_buffer_size / entry_len_);
+}
+
+IxEntrySorter::~IxEntrySorter() {
+    for (auto &run : runs_) {
+        run->in.close();
+        std::remove(run->path.c_str());
+    }
+}
+
+/**
+ * @description: 加入一个键值对，内存中的键值对达到上限时先写出一个有序段
+ * @param {char*} key 长度为col_tot_len的key
+ * @param {Rid&} rid key所在记录的位置
+ */
+void IxEntrySorter::add(const char *key, const Rid &rid) {
+    assert(!finished_);
+    if (buffer_.size() >= buffer_entries_ * entry_len_) {
+        spill();
+    }
+    buffer_.insert(buffer_.end(), key, key + file_hdr_->col_tot_len_);
+    buffer_.insert(buffer_.end(), reinterpret_cast<const char *>(&rid), reinterpret_cast<const char *>(&rid) + sizeof(Rid));
+}
+
+/**
+ * @description: 所有键值对加入之后调用，完成内存中的排序或者准备归并各个有序段
+ */
+void IxEntrySorter::finish() {
+    assert(!finished_);
+    finished_ = true;
+    if (runs_.empty()) {
+        sort_buffer();
+        return;
+    }
+    if (!buffer_.empty()) {
+        spill();
+    }
+    std::vector<char>().swap(buffer_);
+
+    size_t block_entries = std::max<size_t>(1, RUN_READ_BUFFER_SIZE / entry_len_);
+    for (auto &run : runs_) {
+        run->in.open(run->path, std::ios::binary);
+        if (!run->in.is_open()) {
+            throw UnixError();
+        }
+        run->buf.resize(block_entries * entry_len_);
+        if (advance(*run)) {
+            heap_.push_back(run.get());
+        }
+    }
+    std::make_heap(heap_.begin(), heap_.end(), [this](Run *a, Run *b) {
+        return less(b->buf.data() + b->pos, a->buf.data() + a->pos);
+    });
+}
+
+/**
+ * @description: 按(key, rid)从小到大返回下一个键值对
+ * @return {const char*} 键值对|key|rid|的首地址，在下一次调用next()之前有效；全部返回之后为nullptr
+ */
+const char *IxEntrySorter::next() {
+    assert(finished_);
+    if (runs_.empty()) {
+        return next_sorted_ < sorted_.size() ? sorted_[next_sorted_++] : nullptr;
+    }
+
+    auto greater = [this](Run *a, Run *b) { return less(b->buf.data() + b->pos, a->buf.data() + a->pos); };
+    if (last_ != nullptr) {
+        if (advance(*last_)) {
+            heap_.push_back(last_);
+            std::push_heap(heap_.begin(), heap_.end(), greater);
+        }
+        last_ = nullptr;
+    }
+    if (heap_.empty()) {
+        return nullptr;
+    }
+    std::pop_heap(heap_.begin(), heap_.end(), greater);
+    last_ = heap_.back();
+    heap_.pop_back();
+    return last_->buf.data() + last_->pos;
+}
+
+/**
+ * @description: 比较两个键值对，先比较key，key相同时比较rid
+ */
+bool IxEntrySorter::less(const char *a, const char *b) const {
+    int res = file_hdr_->key_cmp_(a, b);
+    return res != 0 ? res < 0 : rid_less(a, b);
+}
+
+/**
+ * @description: 比较两个键值对的rid，用于key相同的键值对
+ */
+bool IxEntrySorter::rid_less(const char *a, const char *b) const {
+    Rid rid_a, rid_b;
+    memcpy(&rid_a, a + file_hdr_->col_tot_len_, sizeof(Rid));
+    memcpy(&rid_b, b + file_hdr_->col_tot_len_, sizeof(Rid));
+    return rid_a.page_no != rid_b.page_no ? rid_a.page_no < rid_b.page_no : rid_a.slot_no < rid_b.slot_no;
+}
+
+/**
+ * @description: 对buffer_中的键值对排序，结果记录在sorted_中
+ */
+void IxEntrySorter::sort_buffer() {
+    sorted_.clear();
+    sorted_.reserve(buffer_.size() / entry_len_);
+    for (size_t offset = 0; offset < buffer_.size(); offset += entry_len_) {
+        sorted_.push_back(buffer_.data() + offset);
+    }
+    file_hdr_->key_cmp_.dispatch([this](auto compare) {
+        std::sort(sorted_.begin(), sorted_.end(), [this, compare](const char *a, const char *b) {
+            int res = compare(a, b);
+            return res != 0 ? res < 0 : rid_less(a, b);
+        });
+    });
+    next_sorted_ = 0;
+}
+
+/**
+ * @description: 把buffer_中的键值对排序后写入一个新的有序段文件，然后清空buffer_
+ */
+void IxEntrySorter::spill() {
+    sort_buffer();
+    auto run = std::make_unique<Run>();
+    run->path = run_prefix_ + ".run" + std::to_string(runs_.size());
+    {
+        std::ofstream out(run->path, std::ios::binary | std::ios::trunc);
+        for (const char *entry : sorted_) {
+            out.write(entry, entry_len_);
+        }
+        if (!out) {
+            throw UnixError();
+        }
+    }
+    runs_.push_back(std::move(run));
+    buffer_.clear();
+    sorted_.clear();
+}
+
+/**
+ * @description: 移动到有序段的下一个键值对，当前块读完时读入下一块
+ * @return {bool} 有序段是否还有键值对
+ */
+bool IxEntrySorter::advance(Run &run) {
+    if (run.len > 0) {
+        run.pos += entry_len_;
+        if (run.pos < run.len) {
+            return true;
+        }
+    }
+    run.in.read(run.buf.data(), run.buf.size());
+    run.len = run.in.gcount();
+    run.pos = 0;
+    return run.len > 0;
+}
+
+IxBulkLoader::IxBulkLoader(IxIndexHandle *ih, double fill_factor) : ih_(ih) {
+    int btree_order = ih_->file_hdr_->btree_order_;
+    int min_size = (btree_order + 1) / 2;
+    fill_size_ = std::clamp(static_cast<int>(btree_order * fill_factor), min_size, btree_order);
+}
+
+/**
+ * @description: 把排好序的键值对依次放入B+树，key重复时只保留排在最前面的键值对(与IxNodeHandle::insert一致)
+ * @param {IxEntrySorter&} sorter 已经加入所有键值对的排序器
+ */
+void IxBulkLoader::load(IxEntrySorter &sorter) {
+    assert(ih_->file_hdr_->root_page_ == IX_INIT_ROOT_PAGE && ih_->file_hdr_->last_leaf_ == IX_INIT_ROOT_PAGE);
+    const IxFileHdr *file_hdr = ih_->file_hdr_;
+    sorter.finish();
+    for (const char *entry = sorter.next(); entry != nullptr; entry = sorter.next()) {
+        if (!levels_.empty()) {
+            IxNodeHandle *leaf = levels_[0].curr.get();
+            if (file_hdr->key_cmp_(leaf->get_key(leaf->get_size() - 1), entry) == 0) {
+                continue;
+            }
+        }
+        Rid rid;
+        memcpy(&rid, entry + file_hdr->col_tot_len_, sizeof(Rid));
+        append(0, entry, rid);
+    }
+    finish();
+}
+
+/**
+ * @description: 在level层的最后追加一个键值对，最后一个结点已满时创建新结点，并把新结点加入上一层
+ * @param {size_t} level 层号，0为叶子层
+ * @param {char*} key 键值对的key，不小于这一层已有的key
+ * @param {Rid&} rid 叶子层为记录的位置，内部结点为孩子结点的页号
+ * @note 递归时可能在levels_中添加新的一层，不能持有levels_中元素的引用
+ */
+void IxBulkLoader::append(size_t level, const char *key, const Rid &rid) {
+    if (level == levels_.size()) {
+        levels_.emplace_back();
+    }
+    IxNodeHandle *curr = levels_[level].curr.get();
+    if (curr != nullptr && curr->get_size() < fill_size_) {
+        curr->insert_pair(curr->get_size(), key, rid);
+        return;
+    }
+
+    std::unique_ptr<IxNodeHandle> node = create_node(level);
+    node->insert_pair(0, key, rid);
+    if (curr != nullptr) {
+        if (level + 1 == levels_.size()) {
+            // 这一层出现了第二个结点，原来的根结点成为新的一层的第一个孩子
+            append(level + 1, curr->get_key(0), (Rid){curr->get_page_no()});
+            curr->set_parent_page_no(levels_[level + 1].curr->get_page_no());
+        }
+        append(level + 1, node->get_key(0), (Rid){node->get_page_no()});
+        node->set_parent_page_no(levels_[level + 1].curr->get_page_no());
+        if (node->is_leaf_page()) {
+            curr->set_next_leaf(node->get_page_no());
+            node->set_prev_leaf(curr->get_page_no());
+        }
+        levels_[level].prev = std::move(levels_[level].curr);
+    }
+    levels_[level].curr = std::move(node);
+}
+
+/**
+ * @description: 创建level层的一个空结点，第一个叶子结点使用创建索引时的根结点页面
+ * @return {unique_ptr<IxNodeHandle>} 持有页面排他latch的结点，还没有父结点，叶子结点的前后都指向leaf header
+ */
+std::unique_ptr<IxNodeHandle> IxBulkLoader::create_node(size_t level) {
+    bool is_leaf = level == 0;
+    std::unique_ptr<IxNodeHandle> node = is_leaf && levels_[0].curr == nullptr ? ih_->fetch_write_node(IX_INIT_ROOT_PAGE)
+                                                                                : ih_->create_node();
+    page_id_t leaf_link = is_leaf ? IX_LEAF_HEADER_PAGE : IX_NO_PAGE;
+    *node->page_hdr = {
+        .next_free_page_no = IX_NO_PAGE,
+        .parent = IX_NO_PAGE,
+        .num_key = 0,
+        .is_leaf = is_leaf,
+        .prev_leaf = leaf_link,
+        .next_leaf = leaf_link,
+    };
+    node->mark_dirty();
+    return node;
+}
+
+/**
+ * @description: 从叶子层开始逐层处理每层的最后一个结点，不足最小大小时：
+ *              与左兄弟的键值对总数不超过btree_order时合并到左兄弟，并从父结点中删除它，父结点可能因此变小，在上一层处理
+ *              否则从左兄弟移入键值对使两个结点平分，再更新它在父结点中的key
+ * 处理完一层就释放这一层的结点，移动内部结点的键值对时需要修改的孩子结点已经释放
+ * 根结点只剩一个孩子时由孩子成为新的根结点；被合并的结点的页面在所有结点释放之后回收
+ * 最后更新文件头中的根结点和最右叶子结点，以及leaf header的prev_leaf
+ */
+void IxBulkLoader::finish() {
+    if (levels_.empty()) {
+        return;
+    }
+    const int btree_order = ih_->file_hdr_->btree_order_;
+    const int min_size = (btree_order + 1) / 2;
+    page_id_t root_page = levels_.back().curr->get_page_no();
+    page_id_t last_leaf = levels_[0].curr->get_page_no();
+    std::vector<page_id_t> deleted_pages;
+
+    for (size_t level = 0; level < levels_.size(); ++level) {
+        IxNodeHandle *curr = levels_[level].curr.get();
+        IxNodeHandle *prev = levels_[level].prev.get();
+        IxNodeHandle *parent = level + 1 < levels_.size() ? levels_[level + 1].curr.get() : nullptr;
+        if (prev != nullptr && curr->get_size() < min_size && prev->get_size() + curr->get_size() <= btree_order) {
+            // curr是父结点的最后一个孩子，prev可能属于父结点的左兄弟
+            int num_moved = curr->get_size();
+            int to = prev->get_size();
+            prev->insert_pairs(to, curr->get_key(0), curr->get_rid(0), num_moved);
+            if (level > 0) {
+                for (int i = to; i < to + num_moved; ++i) {
+                    ih_->fetch_write_node(prev->value_at(i))->set_parent_page_no(prev->get_page_no());
+                }
+            } else {
+                prev->set_next_leaf(curr->get_next_leaf());
+                last_leaf = prev->get_page_no();
+            }
+            assert(parent->value_at(parent->get_size() - 1) == curr->get_page_no());
+            parent->erase_pair(parent->get_size() - 1);
+            deleted_pages.push_back(curr->get_page_no());
+        } else {
+            if (prev != nullptr && curr->get_size() < min_size) {
+                int num_moved = (prev->get_size() - curr->get_size()) / 2;
+                int from = prev->get_size() - num_moved;
+                curr->insert_pairs(0, prev->get_key(from), prev->get_rid(from), num_moved);
+                prev->set_size(from);
+                if (level > 0) {
+                    for (int i = 0; i < num_moved; ++i) {
+                        ih_->fetch_write_node(curr->value_at(i))->set_parent_page_no(curr->get_page_no());
+                    }
+                }
+            }
+            if (parent != nullptr) {
+                parent->set_key(parent->get_size() - 1, curr->get_key(0));
+            }
+        }
+        levels_[level].prev.reset();
+        levels_[level].curr.reset();
+    }
+
+    // 根结点的孩子合并之后可能只剩一个孩子，此时由孩子成为新的根结点
+    while (true) {
+        std::unique_ptr<IxNodeHandle> root = ih_->fetch_write_node(root_page);
+        if (root->is_leaf_page() || root->get_size() > 1) {
+            break;
+        }
+        page_id_t child = root->value_at(0);
+        deleted_pages.push_back(root_page);
+        root.reset();
+        ih_->fetch_write_node(child)->set_parent_page_no(IX_NO_PAGE);
+        root_page = child;
+    }
+
+    ih_->update_root_page_no(root_page);
+    ih_->file_hdr_->last_leaf_ = last_leaf;
+    ih_->fetch_write_node(IX_LEAF_HEADER_PAGE)->set_prev_leaf(last_leaf);
+    levels_.clear();
+
+    for (page_id_t page_no : deleted_pages) {
+        ih_->file_hdr_->num_pages_--;
+        ih_->buffer_pool_manager_->deallocate_page({ih_->fd_, page_no});
+    }
+}
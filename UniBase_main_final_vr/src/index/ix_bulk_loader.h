@@ -0,0 +1,108 @@
+#pragma once
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ix_index_handle.h"
+
+/*
+IxEntrySorter对建索引时从表中抽取的(key, rid)排序，每个键值对在内存中连续存放为|key|rid|
+内存中的键值对达到sort_buffer_size字节时排序并写入一个临时的有序段(run)文件，所有键值对加入之后多路归并各个有序段；
+键值对能放进内存时不写临时文件
+key相同时按rid排序，与按表扫描顺序逐条插入时保留下来的键值对一致
+*/
+class IxEntrySorter {
+   public:
+    /**
+     * @param {IxIndexHandle*} ih 要构建的索引，提供key的类型和长度
+     * @param {string&} run_prefix 临时有序段文件的路径前缀，文件名为run_prefix + ".run" + 编号
+     * @param {size_t} sort_buffer_size 内存中排序的键值对的最大字节数
+     */
+    IxEntrySorter(const IxIndexHandle *ih, const std::string &run_prefix,
+                  size_t sort_buffer_size = INDEX_SORT_BUFFER_SIZE);
+
+    ~IxEntrySorter();
+
+    IxEntrySorter(const IxEntrySorter &) = delete;
+    IxEntrySorter &operator=(const IxEntrySorter &) = delete;
+
+    void add(const char *key, const Rid &rid);
+
+    void finish();
+
+    const char *next();
+
+    // 写入临时文件的有序段数，为0时完全在内存中排序
+    size_t get_num_runs() const { return runs_.size(); }
+
+   private:
+    // 一个有序段文件的顺序读取
+    struct Run {
+        std::string path;
+        std::ifstream in;
+        std::vector<char> buf;      // 读入的一块键值对
+        size_t pos = 0;             // 当前键值对在buf中的偏移
+        size_t len = 0;             // buf中有效的字节数
+    };
+
+    bool less(const char *a, const char *b) const;
+
+    bool rid_less(const char *a, const char *b) const;
+
+    void sort_buffer();
+
+    void spill();
+
+    bool advance(Run &run);
+
+    const IxFileHdr *file_hdr_;
+    std::string run_prefix_;
+    size_t entry_len_;                      // 一个键值对的字节数，为col_tot_len + sizeof(Rid)
+    size_t buffer_entries_;                 // 内存中最多缓存的键值对数量
+
+    std::vector<char> buffer_;              // 还没有写入有序段的键值对
+    std::vector<const char *> sorted_;      // buffer_中键值对排序后的顺序
+    size_t next_sorted_ = 0;                // 完全在内存中排序时下一个返回的位置
+
+    std::vector<std::unique_ptr<Run>> runs_;
+    std::vector<Run *> heap_;               // 归并时各个有序段的当前键值对组成的小根堆
+    Run *last_ = nullptr;                   // 上次返回的键值对所在的有序段，下次调用next()时才前进
+    bool finished_ = false;
+};
+
+/*
+IxBulkLoader自底向上构建一棵空的B+树：按key从小到大依次填满叶子结点，每层结点填到fill_factor * btree_order个键值对，
+一个结点填满后创建同一层的下一个结点，并把它的第一个key和页号追加到上一层；某一层出现第二个结点时在其上创建新的一层
+每一层只持有最后两个结点，构建结束时最后一个结点不足最小大小的话：两个结点放得下时合并到左兄弟，
+否则两个结点平分键值对
+构建期间索引不能被其他线程访问
+*/
+class IxBulkLoader {
+   public:
+    /**
+     * @param {IxIndexHandle*} ih 刚刚创建、还没有任何键值对的索引
+     * @param {double} fill_factor 每个结点填入的键值对占btree_order的比例，不小于最小大小
+     */
+    explicit IxBulkLoader(IxIndexHandle *ih, double fill_factor = INDEX_FILL_FACTOR);
+
+    void load(IxEntrySorter &sorter);
+
+   private:
+    // B+树的一层，除最后两个结点之外都已经释放
+    struct Level {
+        std::unique_ptr<IxNodeHandle> prev;
+        std::unique_ptr<IxNodeHandle> curr;
+    };
+
+    void append(size_t level, const char *key, const Rid &rid);
+
+    std::unique_ptr<IxNodeHandle> create_node(size_t level);
+
+    void finish();
+
+    IxIndexHandle *ih_;
+    int fill_size_;                         // 每个结点填入的键值对数量
+    std::vector<Level> levels_;             // levels_[0]为叶子层
+};
@@ -1,8 +1,12 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <vector>
 
 #include "defs.h"
+#include "errors.h"
 #include "storage/buffer_pool_manager.h"
 
 constexpr int IX_NO_PAGE = -1;
@@ -12,8 +16,143 @@ constexpr int IX_INIT_ROOT_PAGE = 2;
 constexpr int IX_INIT_NUM_PAGES = 3;
 constexpr int IX_MAX_COL_LEN = 512;
 
+inline int ix_compare(const char *a, const char *b, ColType type, int col_len) {
+    switch (type) {
+        case TYPE_INT: {
+            int ia = *(int *)a;
+            int ib = *(int *)b;
+            return (ia < ib) ? -1 : ((ia > ib) ? 1 : 0);
+        }
+        case TYPE_FLOAT: {
+            float fa = *(float *)a;
+            float fb = *(float *)b;
+            return (fa < fb) ? -1 : ((fa > fb) ? 1 : 0);
+        }
+        case TYPE_STRING:
+            return memcmp(a, b, col_len);
+        default:
+            throw InternalError("Unexpected data type");
+    }
+}
+
+inline int ix_compare(const char* a, const char* b, const std::vector<ColType>& col_types, const std::vector<int>& col_lens) {
+    int offset = 0;
+    for(size_t i = 0; i < col_types.size(); ++i) {
+        int res = ix_compare(a + offset, b + offset, col_types[i], col_lens[i]);
+        if(res != 0) return res;
+        offset += col_lens[i];
+    }
+    return 0;
+}
+
+// 以下为常见key形状的比较函数，比较时不按字段类型分支，可以内联到二分查找中
+struct IxIntKeyCompare {
+    int operator()(const char *a, const char *b) const {
+        int ia, ib;
+        memcpy(&ia, a, sizeof(int));
+        memcpy(&ib, b, sizeof(int));
+        return (ia > ib) - (ia < ib);
+    }
+};
+
+struct IxFloatKeyCompare {
+    int operator()(const char *a, const char *b) const {
+        float fa, fb;
+        memcpy(&fa, a, sizeof(float));
+        memcpy(&fb, b, sizeof(float));
+        return (fa > fb) - (fa < fb);
+    }
+};
+
+struct IxStringKeyCompare {
+    int len;
+
+    int operator()(const char *a, const char *b) const { return memcmp(a, b, len); }
+};
+
+// 两个int字段：翻转符号位后拼成一个64位无符号整数，一次比较得到字典序
+struct IxIntIntKeyCompare {
+    static uint64_t normalize(const char *key) {
+        uint32_t hi, lo;
+        memcpy(&hi, key, sizeof(uint32_t));
+        memcpy(&lo, key + sizeof(uint32_t), sizeof(uint32_t));
+        return static_cast<uint64_t>(hi ^ 0x80000000u) << 32 | (lo ^ 0x80000000u);
+    }
+
+    int operator()(const char *a, const char *b) const {
+        uint64_t ka = normalize(a);
+        uint64_t kb = normalize(b);
+        return (ka > kb) - (ka < kb);
+    }
+};
+
+struct IxGenericKeyCompare {
+    const std::vector<ColType> *col_types;
+    const std::vector<int> *col_lens;
+
+    int operator()(const char *a, const char *b) const { return ix_compare(a, b, *col_types, *col_lens); }
+};
+
+/*
+IxKeyComparator是一个索引的key比较函数，打开索引时根据字段的类型和长度确定一次
+dispatch()只在调用时分支一次，把特化的比较函数对象传给func，二分查找等循环在func中进行，循环内的比较没有分支和间接调用
+没有特化的字段组合逐个字段调用ix_compare
+*/
+class IxKeyComparator {
+   public:
+    enum class Kind { INT, FLOAT, STRING, INT_INT, GENERIC };
+
+    IxKeyComparator() = default;
+
+    IxKeyComparator(const std::vector<ColType> &col_types, const std::vector<int> &col_lens)
+        : col_types_(col_types), col_lens_(col_lens) {
+        for (int len : col_lens_) key_len_ += len;
+        if (col_types_.size() == 1 && col_types_[0] == TYPE_INT && col_lens_[0] == sizeof(int)) {
+            kind_ = Kind::INT;
+        } else if (col_types_.size() == 1 && col_types_[0] == TYPE_FLOAT && col_lens_[0] == sizeof(float)) {
+            kind_ = Kind::FLOAT;
+        } else if (std::all_of(col_types_.begin(), col_types_.end(), [](ColType type) { return type == TYPE_STRING; })) {
+            // 多个字符串字段依次比较等价于整个key一起memcmp
+            kind_ = Kind::STRING;
+        } else if (col_types_.size() == 2 && col_types_[0] == TYPE_INT && col_types_[1] == TYPE_INT &&
+                   key_len_ == 2 * sizeof(int)) {
+            kind_ = Kind::INT_INT;
+        }
+    }
+
+    template <typename Func>
+    decltype(auto) dispatch(Func &&func) const {
+        switch (kind_) {
+            case Kind::INT:
+                return func(IxIntKeyCompare{});
+            case Kind::FLOAT:
+                return func(IxFloatKeyCompare{});
+            case Kind::STRING:
+                return func(IxStringKeyCompare{key_len_});
+            case Kind::INT_INT:
+                return func(IxIntIntKeyCompare{});
+            default:
+                return func(IxGenericKeyCompare{&col_types_, &col_lens_});
+        }
+    }
+
+    int operator()(const char *a, const char *b) const {
+        return dispatch([a, b](auto compare) { return compare(a, b); });
+    }
+
+    Kind get_kind() const { return kind_; }
+
+   private:
+    Kind kind_ = Kind::GENERIC;
+    int key_len_ = 0;
+    std::vector<ColType> col_types_;
+    std::vector<int> col_lens_;
+};
+
 class IxFileHdr {
 public: 
+    uint32_t magic_;                    // Page::FILE_MAGIC，第1版的文件没有这个字段
+    int format_version_;                // 文件格式版本，创建时为Page::FILE_FORMAT_VERSION
     page_id_t first_free_page_no_;      // 文件中第一个空闲的磁盘页面的页面号
     int num_pages_;                     // 磁盘文件中页面的数量
     page_id_t root_page_;               // B+树根节点对应的页面号
@@ -27,26 +166,33 @@ public:
     page_id_t first_leaf_;              // 首叶节点对应的页号，在上层IxManager的open函数进行初始化，初始化为root page_no
     page_id_t last_leaf_;               // 尾叶节点对应的页号
     int tot_len_;                       // 记录结构体的整体长度
+    IxKeyComparator key_cmp_;           // 按col_types_和col_lens_确定的key比较函数，不写入文件，打开索引时初始化
 
     IxFileHdr() {
+        magic_ = 0;
+        format_version_ = 0;
         tot_len_ = col_num_ = 0;
     }
 
     IxFileHdr(page_id_t first_free_page_no, int num_pages, page_id_t root_page, int col_num,
                 int col_tot_len, int btree_order, int keys_size, page_id_t first_leaf, page_id_t last_leaf)
-                : first_free_page_no_(first_free_page_no), num_pages_(num_pages), root_page_(root_page), col_num_(col_num),
+                : magic_(Page::FILE_MAGIC), format_version_(Page::FILE_FORMAT_VERSION), first_free_page_no_(first_free_page_no), num_pages_(num_pages), root_page_(root_page), col_num_(col_num),
                 col_tot_len_(col_tot_len), btree_order_(btree_order), keys_size_(keys_size), first_leaf_(first_leaf), last_leaf_(last_leaf) {
                     tot_len_ = 0;
                 } 
 
     void update_tot_len() {
         tot_len_ = 0;
-        tot_len_ += sizeof(page_id_t) * 4 + sizeof(int) * 6;
+        tot_len_ += sizeof(uint32_t) + sizeof(page_id_t) * 4 + sizeof(int) * 7;
         tot_len_ += sizeof(ColType) * col_num_ + sizeof(int) * col_num_;
     }
 
     void serialize(char* dest) {
         int offset = 0;
+        memcpy(dest + offset, &magic_, sizeof(uint32_t));
+        offset += sizeof(uint32_t);
+        memcpy(dest + offset, &format_version_, sizeof(int));
+        offset += sizeof(int);
         memcpy(dest + offset, &tot_len_, sizeof(int));
         offset += sizeof(int);
         memcpy(dest + offset, &first_free_page_no_, sizeof(page_id_t));
@@ -78,8 +224,20 @@ public:
         assert(offset == tot_len_);
     }
 
+    // 魔数或版本与当前格式不同时只读出这两个字段，之后的字段布局未知
     void deserialize(char* src) {
         int offset = 0;
+        magic_ = *reinterpret_cast<const uint32_t*>(src + offset);
+        offset += sizeof(uint32_t);
+        if (magic_ != Page::FILE_MAGIC) {
+            format_version_ = 1;
+            return;
+        }
+        format_version_ = *reinterpret_cast<const int*>(src + offset);
+        offset += sizeof(int);
+        if (format_version_ != Page::FILE_FORMAT_VERSION) {
+            return;
+        }
         tot_len_ = *reinterpret_cast<const int*>(src + offset);
         offset += sizeof(int);
         first_free_page_no_ = *reinterpret_cast<const page_id_t*>(src + offset);
@@ -90,7 +248,6 @@ public:
         offset += sizeof(page_id_t);
         col_num_ = *reinterpret_cast<const int*>(src + offset);
         offset += sizeof(int);
-        std::cout << col_num_ << "\n";
         for(int i = 0; i < col_num_; ++i) {
             // col_types_[i] = *reinterpret_cast<const ColType*>(src + offset);
             ColType type = *reinterpret_cast<const ColType*>(src + offset);
@@ -11,29 +11,23 @@
 int IxNodeHandle::lower_bound(const char *target) const {
     // Todo:
     // 查找当前节点中第一个大于等于target的key，并返回key的位置给上层
-    // 提示: 可以采用多种查找方式，如顺序遍历、二分查找等；使用ix_compare()函数进行比较
-
-    int left = 0;
-    int right = page_hdr->num_key;
-
-    while (left <= right) {
-        int mid = (left + right) / 2;
-        int cmp = ix_compare(target, get_key(mid), file_hdr->col_types_, file_hdr->col_lens_);
-
-        if (cmp == 0) {
-            // 找到了等于target的key，直接返回索引
-            return mid;
-        } else if (cmp < 0) {
-            // target小于当前节点的key，继续在左侧查找
-            right = mid - 1;
-        } else {
-            // target大于当前节点的key，继续在右侧查找
-            left = mid + 1;
+    // 提示: 可以采用多种查找方式，如顺序遍历、二分查找等；使用file_hdr->key_cmp_进行比较
+
+    // 二分查找区间[left,right)，循环结束时left为第一个>=target的位置
+    // 比较函数在查找之前按key的类型确定，循环内直接调用特化的比较函数
+    return file_hdr->key_cmp_.dispatch([&](auto compare) {
+        int left = 0;
+        int right = page_hdr->num_key;
+        while (left < right) {
+            int mid = (left + right) / 2;
+            if (compare(get_key(mid), target) < 0) {
+                left = mid + 1;
+            } else {
+                right = mid;
+            }
         }
-    }
-
-    // 如果没有找到等于target的key，返回最接近target且大于它的key的位置
-    return page_hdr->num_key;
+        return left;
+    });
 }
 
 /**
@@ -45,29 +39,22 @@ int IxNodeHandle::lower_bound(const char *target) const {
 int IxNodeHandle::upper_bound(const char *target) const {
     // Todo:
     // 查找当前节点中第一个大于target的key，并返回key的位置给上层
-    // 提示: 可以采用多种查找方式：顺序遍历、二分查找等；使用ix_compare()函数进行比较
-
-    int left = 0;
-    int right = page_hdr->num_key;
-    //if(ix_compare(target, get_key(0), file_hdr->col_types_, file_hdr->col_lens_) < 0)return -1;
-    while (left <= right) {
-        int mid = (left + right) / 2;
-        int cmp = ix_compare(target, get_key(mid), file_hdr->col_types_, file_hdr->col_lens_);
-    
-        if (cmp == 0) {
-            // 找到了等于target的key，直接返回索引
-            return mid + 1;
-        } else if (cmp < 0) {
-            // target小于当前节点的key，继续在右侧查找
-            right = mid - 1;
-        } else {
-            // target大于当前节点的key，继续在左侧查找
-            left = mid + 1;
+    // 提示: 可以采用多种查找方式：顺序遍历、二分查找等；使用file_hdr->key_cmp_进行比较
+
+    // 内部结点的第0个key不作为分隔，从1开始查找
+    return file_hdr->key_cmp_.dispatch([&](auto compare) {
+        int left = std::min(1, page_hdr->num_key);
+        int right = page_hdr->num_key;
+        while (left < right) {
+            int mid = (left + right) / 2;
+            if (compare(get_key(mid), target) <= 0) {
+                left = mid + 1;
+            } else {
+                right = mid;
+            }
         }
-    }
-
-    // 如果没有找到等于target的key，返回最接近target且大于它的key的位置
-    return page_hdr->num_key;
+        return left;
+    });
 }
 
 /**
@@ -88,7 +75,7 @@ bool IxNodeHandle::leaf_lookup(const char *key, Rid **value) {
     //1
     auto it = lower_bound(key);
     //2
-    if(it != page_hdr->num_key){
+    if (it != page_hdr->num_key && file_hdr->key_cmp_(key, get_key(it)) == 0) {
         *value = get_rid(it);
         return true;
     }
@@ -110,19 +97,8 @@ page_id_t IxNodeHandle::internal_lookup(const char *key) {
     //     throw IndexEntryNotFoundError();
     //}
 
-    // 暂时处理不了小于最小值
-    int child_index = -1;
-    int num_key = get_size();
-    for(int i=1; i<num_key; i++){
-        if (ix_compare(key, get_key(i), file_hdr->col_types_[i], file_hdr->col_lens_[i]) < 0) {
-            child_index = i - 1;
-            break;
-        }
-    }
-    if(child_index == -1){
-        child_index = num_key - 1;
-    }
-    return value_at(child_index);
+    // 第一个>key的位置的前一个孩子；小于所有key时进入第0个孩子
+    return value_at(upper_bound(key) - 1);
 }
 
 /**
@@ -149,7 +125,7 @@ void IxNodeHandle::insert_pairs(int pos, const char *key, const Rid *rid, int n)
     if(pos<0 || pos + n > get_max_size()){
         return;
     }
-    memmove(rids + (pos + n)*sizeof(Rid), rids + pos*sizeof(Rid), (get_size()-pos)*sizeof(Rid));
+    memmove(rids + pos + n, rids + pos, (get_size() - pos) * sizeof(Rid));
     memmove(keys + (pos + n) * file_hdr->col_tot_len_, keys + pos * file_hdr->col_tot_len_, (get_size()-pos)*file_hdr->col_tot_len_);
     for (int i = n - 1; i >= 0; i--) {
         Rid *current_rid = get_rid(pos + i);
@@ -181,7 +157,7 @@ int IxNodeHandle::insert(const char *key, const Rid &value) {
     //printf("insert start\n");
     int pos = lower_bound(key);
     //printf("%d\n",pos);
-    if (pos < get_size() && ix_compare(key, get_key(pos), file_hdr->col_types_[pos], file_hdr->col_lens_[pos]) == 0) {
+    if (pos < get_size() && file_hdr->key_cmp_(key, get_key(pos)) == 0) {
         return get_size();
     }
 
@@ -211,8 +187,7 @@ void IxNodeHandle::erase_pair(int pos) {
     memmove( key_slot, key_slot+len, mv_size*len ); // 2
 
     Rid *rid_slot = get_rid( pos );
-    len = sizeof( Rid );
-    memmove( rid_slot, rid_slot+len, mv_size*len );
+    memmove( rid_slot, rid_slot+1, mv_size*sizeof(Rid) );
     set_size(get_size() - 1);
     return;
 }
@@ -230,8 +205,7 @@ int IxNodeHandle::remove(const char *key) {
     // 3. 返回完成删除操作后的键值对数量
 
     int index = lower_bound( key );
-    int pos = lower_bound(key);
-    if( index!=get_size() && ix_compare( key, get_key(index), file_hdr->col_types_[pos], file_hdr->col_lens_[pos]) == 0)
+    if( index!=get_size() && file_hdr->key_cmp_(key, get_key(index)) == 0)
         erase_pair( index );
     return get_size();
     
@@ -246,6 +220,15 @@ IxIndexHandle::IxIndexHandle(DiskManager *disk_manager, BufferPoolManager *buffe
     disk_manager_->read_page(fd, IX_FILE_HDR_PAGE, buf, PAGE_SIZE);
     file_hdr_ = new IxFileHdr();
     file_hdr_->deserialize(buf);
+    delete[] buf;
+    // 旧版本文件的结点页头位置不同，不能按当前格式读写
+    if (file_hdr_->magic_ != Page::FILE_MAGIC || file_hdr_->format_version_ != Page::FILE_FORMAT_VERSION) {
+        int version = file_hdr_->format_version_;
+        delete file_hdr_;
+        throw FileFormatError(disk_manager_->get_file_name(fd), version, Page::FILE_FORMAT_VERSION);
+    }
+    // 按key的字段类型选择一次比较函数，之后结点内的查找不再按类型分支
+    file_hdr_->key_cmp_ = IxKeyComparator(file_hdr_->col_types_, file_hdr_->col_lens_);
     
     // disk_manager管理的fd对应的文件中，设置从file_hdr_->num_pages开始分配page_no
     int now_page_no = disk_manager_->get_fd2pageno(fd);
@@ -258,28 +241,68 @@ IxIndexHandle::IxIndexHandle(DiskManager *disk_manager, BufferPoolManager *buffe
  * @param operation 查找到目标键值对后要进行的操作类型
  * @param transaction 事务参数，如果不需要则默认传入nullptr
  * @return [leaf node] and [root_is_latched] 返回目标叶子结点以及根结点是否加锁
- * @note need to Unlatch and unpin the leaf node outside!
- * 注意：用了FindLeafPage之后一定要unlatch叶结点，否则下次latch该结点会堵塞！
+ * @note 乐观下降(latch crabbing)：先获取孩子结点的页面共享latch再释放父结点，同时最多持有两个结点；
+ * 插入和删除时叶子结点改为持有页面排他latch，换latch时仍持有父结点的共享latch，叶子结点不会被分裂或合并
+ * 返回时不持有root_latch_，返回的结点释放时自动unlatch和unpin
  */
-std::pair<IxNodeHandle *, bool> IxIndexHandle::find_leaf_page(const char *key, Operation operation,Transaction *transaction, bool find_first) {
+std::pair<std::unique_ptr<IxNodeHandle>, bool> IxIndexHandle::find_leaf_page(const char *key, Operation operation,
+                                                                             Transaction *transaction, bool find_first) {
     // Todo:
     // 1. 获取根节点
     // 2. 从根节点开始不断向下查找目标key
     // 3. 找到包含该key值的叶子结点停止查找，并返回叶子节点
 
-    // internal_lookup 暂时处理不了找不到的情况
-    // 一定找得到？
-    page_id_t node_page = file_hdr_->root_page_;
-    IxNodeHandle *node_handle = fetch_node(node_page);
-    std::scoped_lock lock{root_latch_}; 
+    auto latch_for_operation = [&](std::unique_ptr<IxNodeHandle> node) {
+        if (operation == Operation::FIND || !node->is_leaf_page()) {
+            return node;
+        }
+        page_id_t page_no = node->get_page_no();
+        node.reset();
+        return fetch_write_node(page_no);
+    };
+    std::shared_lock root_lock{root_latch_};
+    std::unique_ptr<IxNodeHandle> node_handle = latch_for_operation(fetch_read_node(file_hdr_->root_page_));
+    root_lock.unlock();
     while(!node_handle->is_leaf_page()){
-        node_page = node_handle->internal_lookup(key);
-        node_handle = fetch_node(node_page);
+        // 先获取孩子结点再释放当前结点
+        node_handle = latch_for_operation(fetch_read_node(node_handle->internal_lookup(key)));
+    }
+    return std::make_pair(std::move(node_handle), false);
+}
 
+/**
+ * @brief 悲观下降：持有root_latch_的排他锁，从根结点开始依次给结点加页面排他latch，
+ * 到达安全的结点时释放它的所有祖先以及root_latch_
+ * @param context 返回时持有从最高的不安全结点到目标叶子结点的路径，最后一个结点为叶子结点
+ */
+void IxIndexHandle::find_leaf_page_pessimistic(const char *key, Operation operation, IxLatchContext &context) {
+    context.root_lock_ = std::unique_lock<std::shared_mutex>(root_latch_);
+    IxNodeHandle *node = context.hold(fetch_write_node(file_hdr_->root_page_));
+    if (is_safe(node, key, operation)) {
+        context.release_ancestors();
+    }
+    while (!node->is_leaf_page()) {
+        node = context.hold(fetch_write_node(node->internal_lookup(key)));
+        if (is_safe(node, key, operation)) {
+            context.release_ancestors();
+        }
     }
-    buffer_pool_manager_->unpin_page(node_handle->get_page_id(),false);
-    root_latch_.unlock();
-    return std::make_pair(node_handle, false);
+}
+
+/**
+ * @brief 判断本次插入或删除是否一定不会修改node的祖先
+ * 插入：插入一个键值对之后不会分裂；删除：删除一个键值对之后不会合并或重分配，并且key大于node的第一个key，
+ * 即node的第一个key不会改变，不需要maintain_parent；根结点没有父结点，内部根结点只剩一个孩子时才需要调整根结点
+ */
+bool IxIndexHandle::is_safe(IxNodeHandle *node, const char *key, Operation operation) {
+    if (operation == Operation::INSERT) {
+        return node->get_size() + 1 < node->get_max_size();
+    }
+    if (node->is_root_page()) {
+        return node->is_leaf_page() || node->get_size() > 2;
+    }
+    return node->get_size() > node->get_min_size() &&
+           file_hdr_->key_cmp_(key, node->get_key(0)) > 0;
 }
 
 /**
@@ -297,29 +320,22 @@ bool IxIndexHandle::get_value(const char *key, std::vector<Rid> *result, Transac
     // 3. 把rid存入result参数中
     // 提示：使用完buffer_pool提供的page之后，记得unpin page；记得处理并发的上锁
 
-    // 0 Find 1 insert 2 delete
-    Operation op = Operation::FIND;
-    IxNodeHandle * node_handle = find_leaf_page(key, op, transaction, false).first;
-    //printf("%d\n",node_handle->get_page_no());
+    std::unique_ptr<IxNodeHandle> node_handle = find_leaf_page(key, Operation::FIND, transaction, false).first;
     Rid *rid;
     if(node_handle->leaf_lookup(key, &rid)){
         result->push_back(*rid);
-        buffer_pool_manager_->unpin_page(node_handle->get_page_id(), false);
         return true;
     }
-    buffer_pool_manager_->unpin_page(node_handle->get_page_id(), false);
-    root_latch_.unlock();
     return false;
 }
 
 /**
  * @brief  将传入的一个node拆分(Split)成两个结点，在node的右边生成一个新结点new node
  * @param node 需要拆分的结点
+ * @param context 持有node及其父结点，新结点也由context持有
  * @return 拆分得到的new_node
- * @note need to unpin the new node outside
- * 注意：本函数执行完毕后，原node和new node都需要在函数外面进行unpin
  */
-IxNodeHandle *IxIndexHandle::split(IxNodeHandle *node) {
+IxNodeHandle *IxIndexHandle::split(IxNodeHandle *node, IxLatchContext &context) {
     // Todo:
     // 1. 将原结点的键值对平均分配，右半部分分裂为新的右兄弟结点
     //    需要初始化新节点的page_hdr内容
@@ -329,32 +345,25 @@ IxNodeHandle *IxIndexHandle::split(IxNodeHandle *node) {
     int total_keys = node->get_size();
     int mid = total_keys / 2;
 
-    IxNodeHandle *new_node = create_node();
-    if(node->is_leaf_page())new_node->page_hdr->is_leaf=true;
-    //只有叶子会分出叶子
+    IxNodeHandle *new_node = context.hold(create_node());
+    new_node->page_hdr->is_leaf = node->is_leaf_page();
     //insert_pair 的时候不会改变树的关系，只有split会有父子的变化
-    for (int i = mid; i < total_keys; ++i) {
-        const char *key = node->get_key(i);
-        Rid *rid = node->get_rid(i);
-        new_node->insert_pair(i - mid, key, *rid);
-        //num_key changed
-    }
+    new_node->insert_pairs(0, node->get_key(mid), node->get_rid(mid), total_keys - mid);
 
     node->set_size(mid);
     new_node->set_parent_page_no(node->get_parent_page_no());
-    //注意此处只是更新了parent_page_no 并没有真正插入到父节点，因为插入只是指定key和rid，无法判断现在添加的是记录还是在向父节点添加儿子信息
-    //大任交给split
+    //注意此处只是更新了parent_page_no 并没有真正插入到父节点，由insert_into_parent完成
     if (new_node->is_leaf_page()) {
         new_node->set_prev_leaf(node->get_page_no());
         new_node->set_next_leaf(node->get_next_leaf());
+        // 后继叶子结点在右边，叶子层只从左向右加latch
+        std::unique_ptr<IxNodeHandle> next = fetch_write_node(node->get_next_leaf());
+        next->set_prev_leaf(new_node->get_page_no());
         node->set_next_leaf(new_node->get_page_no());
     }
     else {
-        for (int i = 0; i <= new_node->get_size(); ++i) {
-            maintain_child(new_node, i);
-
-            /*IxNodeHandle *child = fetch_node(new_node->value_at(i));
-            child->set_parent_page_no(new_node->get_page_no());*/
+        for (int i = 0; i < new_node->get_size(); ++i) {
+            maintain_child(new_node, i, context);
         }
     }
 
@@ -372,9 +381,10 @@ IxNodeHandle *IxIndexHandle::split(IxNodeHandle *node) {
  * @param key 要插入parent的key
  * @note 一个结点插入了键值对之后需要分裂，分裂后左半部分的键值对保留在原结点，在参数中称为old_node，
  * 右半部分的键值对分裂为新的右兄弟节点，在参数中称为new_node（参考Split函数来理解old_node和new_node）
- * @note 本函数执行完毕后，new node和old node都需要在函数外面进行unpin
+ * @note old_node分裂说明它不安全，它的父结点仍由context持有；old_node为根结点时context持有root_latch_
  */
-void IxIndexHandle::insert_into_parent(IxNodeHandle *old_node, const char *key, IxNodeHandle *new_node,Transaction *transaction) {
+void IxIndexHandle::insert_into_parent(IxNodeHandle *old_node, const char *key, IxNodeHandle *new_node,
+                                       Transaction *transaction, IxLatchContext &context) {
     // Todo:
     // 1. 分裂前的结点（原结点, old_node）是否为根结点，如果为根结点需要分配新的root
     // 2. 获取原结点（old_node）的父亲结点
@@ -382,13 +392,10 @@ void IxIndexHandle::insert_into_parent(IxNodeHandle *old_node, const char *key,
     // 4. 如果父亲结点仍需要继续分裂，则进行递归插入
     // 提示：记得unpin page
 
-    //split更新新分裂出的节点的parent_page_no
-    //根节点特判
-    //得到了old的新兄弟 现在向父节点插入新节点
     if (old_node->is_root_page()) {
+        assert(context.root_is_latched());
+        IxNodeHandle *new_root = context.hold(create_node());
 
-        IxNodeHandle *new_root = create_node();
-        
         new_root->insert_pair(0, old_node->get_key(0), (Rid){old_node->get_page_no()});
         new_root->insert_pair(1, new_node->get_key(0), (Rid){new_node->get_page_no()});
 
@@ -404,14 +411,15 @@ void IxIndexHandle::insert_into_parent(IxNodeHandle *old_node, const char *key,
         return;
     }
 
-    IxNodeHandle *parent_node = fetch_node(old_node->get_parent_page_no());
+    IxNodeHandle *parent_node = context.find(old_node->get_parent_page_no());
+    assert(parent_node != nullptr);
 
-    int parent_insert_pos = parent_node->upper_bound(key);//合理!
+    int parent_insert_pos = parent_node->find_child(old_node) + 1;
     parent_node->insert_pair(parent_insert_pos, new_node->get_key(0), (Rid){new_node->get_page_no()});
 
     if (parent_node->get_size() >= parent_node->get_max_size()) {
-        IxNodeHandle *new_parent_node = split(parent_node);
-        insert_into_parent(parent_node, key, new_parent_node, transaction);
+        IxNodeHandle *new_parent_node = split(parent_node, context);
+        insert_into_parent(parent_node, key, new_parent_node, transaction, context);
     }
 
 }
@@ -421,6 +429,7 @@ void IxIndexHandle::insert_into_parent(IxNodeHandle *old_node, const char *key,
  * @param (key, value) 要插入的键值对
  * @param transaction 事务指针
  * @return page_id_t 插入到的叶结点的page_no
+ * @note 先乐观插入，只持有叶子结点的排他latch；叶子结点可能分裂时释放它，重新悲观下降
  */
 page_id_t IxIndexHandle::insert_entry(const char *key, const Rid &value, Transaction *transaction) {
     // Todo:
@@ -429,36 +438,30 @@ page_id_t IxIndexHandle::insert_entry(const char *key, const Rid &value, Transac
     // 3. 如果结点已满，分裂结点，并把新结点的相关信息插入父节点
     // 提示：记得unpin page；若当前叶子节点是最右叶子节点，则需要更新file_hdr_.last_leaf；记得处理并发的上锁
 
-    //first_leaf 首叶节点对应的页号，在上层IxManager的open函数进行初始化，初始化为root page_no这个不会变
-    //printf("start entry\n");
-    Operation op = Operation::INSERT;
-    std::pair<IxNodeHandle *, bool> result = find_leaf_page(key, op, transaction, false);
+    {
+        std::unique_ptr<IxNodeHandle> leaf = find_leaf_page(key, Operation::INSERT, transaction).first;
+        if (is_safe(leaf.get(), key, Operation::INSERT)) {
+            leaf->insert(key, value);
+            return leaf->get_page_no();
+        }
+    }
 
-    IxNodeHandle *leaf_node = result.first;
-    // int NO = leaf_node->get_page_no();
-    // printf("%d\n",NO);
-    bool root_is_latched = result.second;
+    IxLatchContext context;
+    find_leaf_page_pessimistic(key, Operation::INSERT, context);
+    IxNodeHandle *leaf_node = context.back();
 
     int insert_result = leaf_node->insert(key, value);
-    //printf("insert_result: %d\n", insert_result );
     if (insert_result == leaf_node->get_max_size()) {
-        IxNodeHandle *new_node = split(leaf_node);
-        insert_into_parent(leaf_node, key, new_node, transaction);
-        if(file_hdr_->last_leaf_ == leaf_node->get_page_no()){
-            file_hdr_->last_leaf_ = new_node->get_page_id().page_no;
+        IxNodeHandle *new_node = split(leaf_node, context);
+        {
+            std::scoped_lock lock{file_hdr_latch_};
+            if (file_hdr_->last_leaf_ == leaf_node->get_page_no()) {
+                file_hdr_->last_leaf_ = new_node->get_page_no();
+            }
         }
+        insert_into_parent(leaf_node, key, new_node, transaction, context);
         //本质是个pushup
-        buffer_pool_manager_->unpin_page(leaf_node->get_page_id(), true);
-        buffer_pool_manager_->unpin_page(new_node->get_page_id(), true);
-    } 
-    else{
-        buffer_pool_manager_->unpin_page(leaf_node->get_page_id(), true);
-    }
-
-    if (root_is_latched) {
-        root_latch_.unlock();
     }
-    //printf("END entry\n");
     return leaf_node->get_page_no();
 }
 
@@ -466,6 +469,7 @@ page_id_t IxIndexHandle::insert_entry(const char *key, const Rid &value, Transac
  * @brief 用于删除B+树中含有指定key的键值对
  * @param key 要删除的key值
  * @param transaction 事务指针
+ * @note 先乐观删除，只持有叶子结点的排他latch；叶子结点可能合并或第一个key改变时释放它，重新悲观下降
  */
 bool IxIndexHandle::delete_entry(const char *key, Transaction *transaction) {
     // Todo:
@@ -474,16 +478,38 @@ bool IxIndexHandle::delete_entry(const char *key, Transaction *transaction) {
     // 3. 如果删除成功需要调用CoalesceOrRedistribute来进行合并或重分配操作，并根据函数返回结果判断是否有结点需要删除
     // 4. 如果需要并发，并且需要删除叶子结点，则需要在事务的delete_page_set中添加删除结点的对应页面；记得处理并发的上锁
 
-    std::scoped_lock lock{root_latch_};
-    // 1. 获取该键值对所在的叶子结点
-    IxNodeHandle *leaf = find_leaf_page( key, Operation::DELETE, transaction ).first;
-    int num = leaf->get_size();
-    // 2. 在该叶子结点中删除键值对
-    bool res = ( num != leaf->remove(key));
-    // 3
-    if(res)coalesce_or_redistribute(leaf);
+    {
+        std::unique_ptr<IxNodeHandle> leaf = find_leaf_page(key, Operation::DELETE, transaction).first;
+        int pos = leaf->lower_bound(key);
+        if (pos == leaf->get_size() ||
+            file_hdr_->key_cmp_(key, leaf->get_key(pos)) != 0) {
+            return false;
+        }
+        if (is_safe(leaf.get(), key, Operation::DELETE)) {
+            leaf->erase_pair(pos);
+            return true;
+        }
+    }
+
+    bool res;
+    std::vector<page_id_t> deleted_pages;
+    {
+        IxLatchContext context;
+        // 1. 获取该键值对所在的叶子结点
+        find_leaf_page_pessimistic(key, Operation::DELETE, context);
+        IxNodeHandle *leaf = context.back();
+        int num = leaf->get_size();
+        // 2. 在该叶子结点中删除键值对
+        res = ( num != leaf->remove(key));
+        // 3
+        if(res)coalesce_or_redistribute(leaf, transaction, context);
+        deleted_pages = std::move(context.deleted_pages_);
+    }
 
-    buffer_pool_manager_->unpin_page( leaf->get_page_id(), res );
+    // 4. 被删除的结点已经全部unlatch和unpin，此时释放其磁盘页面以便之后复用
+    for (page_id_t page_no : deleted_pages) {
+        buffer_pool_manager_->deallocate_page({fd_, page_no});
+    }
 
     return res;
 }
@@ -493,13 +519,13 @@ bool IxIndexHandle::delete_entry(const char *key, Transaction *transaction) {
  *
  * @param node 执行完删除操作的结点
  * @param transaction 事务指针
- * @param root_is_latched 传出参数：根节点是否上锁，用于并发操作
+ * @param context 持有node及其所有可能被修改的祖先
  * @return 是否需要删除结点
  * @note User needs to first find the sibling of input page.
  * If sibling's size + input page's size >= 2 * page's minsize, then redistribute.
  * Otherwise, merge(Coalesce).
  */
-bool IxIndexHandle::coalesce_or_redistribute(IxNodeHandle *node, Transaction *transaction, bool *root_is_latched) {
+bool IxIndexHandle::coalesce_or_redistribute(IxNodeHandle *node, Transaction *transaction, IxLatchContext &context) {
     // Todo:
     // 1. 判断node结点是否为根节点
     //    1.1 如果是根节点，需要调用AdjustRoot() 函数来进行处理，返回根节点是否需要被删除
@@ -510,26 +536,27 @@ bool IxIndexHandle::coalesce_or_redistribute(IxNodeHandle *node, Transaction *tr
     // NodeMinSize*2)，则只需要重新分配键值对（调用Redistribute函数）
     // 5. 如果不满足上述条件，则需要合并两个结点，将右边的结点合并到左边的结点（调用Coalesce函数）
 
-    if( node->get_page_no() == file_hdr_->root_page_ )  // 1.1
-       return adjust_root(node);
+    if( node->is_root_page() )  // 1.1
+       return adjust_root(node, context);
     else if( node->get_size() >= node->get_min_size() ) { // 1.2
-        maintain_parent(node);
+        maintain_parent(node, context);
         return false;
     }
     else {
-        IxNodeHandle *parent = fetch_node( node->get_parent_page_no() ); // 2
+        // node的第一个key可能刚被删除，先更新祖先：合并时node的第一个key会作为分隔key移动到兄弟结点中
+        if( node->get_size() > 0 )
+            maintain_parent(node, context);
+        IxNodeHandle *parent = context.find( node->get_parent_page_no() ); // 2 node不安全，父结点仍被持有
+        assert(parent != nullptr);
         int index = parent->find_child( node );
-        IxNodeHandle *neighbor = fetch_node( parent->get_rid( index+(index?-1:1) )->page_no ); // 3
+        // 3 兄弟结点与node有相同的父结点，持有父结点的排他latch时其他线程只能从叶子层的前驱结点加latch
+        IxNodeHandle *neighbor = context.hold(fetch_write_node( parent->value_at( index+(index?-1:1) ) ));
         if( node->get_size()+neighbor->get_size() >= node->get_min_size()*2 ) { // 4
-            redistribute( neighbor, node, parent, index );
-            buffer_pool_manager_->unpin_page( parent->get_page_id(), true );
-            buffer_pool_manager_->unpin_page( neighbor->get_page_id(), true );
+            redistribute( neighbor, node, parent, index, context );
             return false;
         }
         else {
-            coalesce( &neighbor, &node, &parent, index, transaction, root_is_latched); // 5
-            buffer_pool_manager_->unpin_page( parent->get_page_id(), true );
-            buffer_pool_manager_->unpin_page( neighbor->get_page_id(), true );
+            coalesce( &neighbor, &node, &parent, index, transaction, context); // 5
             return true;
         }
     }
@@ -543,25 +570,22 @@ bool IxIndexHandle::coalesce_or_redistribute(IxNodeHandle *node, Transaction *tr
  * @return bool 根结点是否需要被删除
  * @note size of root page can be less than min size and this method is only called within coalesce_or_redistribute()
  */
-bool IxIndexHandle::adjust_root(IxNodeHandle *old_root_node) {
+bool IxIndexHandle::adjust_root(IxNodeHandle *old_root_node, IxLatchContext &context) {
     // Todo:
     // 1. 如果old_root_node是内部结点，并且大小为1，则直接把它的孩子更新成新的根结点
     // 2. 如果old_root_node是叶结点，且大小为0，则直接更新root page
     // 3. 除了上述两种情况，不需要进行操作
     if( !old_root_node->is_leaf_page() && old_root_node->page_hdr->num_key==1 ) { // 1
-        IxNodeHandle *child = fetch_node( old_root_node->get_rid(0)->page_no );
-        release_node_handle( *old_root_node );
-        file_hdr_->root_page_ = child->get_page_no();
+        assert(context.root_is_latched());
+        // 孩子这一层的结点在合并之后已经释放
+        std::unique_ptr<IxNodeHandle> child = fetch_write_node( old_root_node->value_at(0) );
+        release_node_handle( *old_root_node, context );
+        update_root_page_no( child->get_page_no() );
         child->set_parent_page_no(IX_NO_PAGE);
-        buffer_pool_manager_->unpin_page( child->get_page_id(), true );
-        return true;
-    }
-    else if( old_root_node->is_leaf_page() && !old_root_node->page_hdr->num_key ){ // 2
-        release_node_handle( *old_root_node );
-        file_hdr_->root_page_ = INVALID_PAGE_ID;
         return true;
     }
-    else return false;
+    // 2. 叶子根结点删空时保留为空的根结点，与新创建的索引相同，之后的插入仍从根结点开始
+    return false;
 }
 
 /**
@@ -578,7 +602,8 @@ bool IxIndexHandle::adjust_root(IxNodeHandle *old_root_node) {
  * index>0，则neighbor是node前驱结点，表示：neighbor(left)  node(right)
  * 注意更新parent结点的相关kv对
  */
-void IxIndexHandle::redistribute(IxNodeHandle *neighbor_node, IxNodeHandle *node, IxNodeHandle *parent, int index) {
+void IxIndexHandle::redistribute(IxNodeHandle *neighbor_node, IxNodeHandle *node, IxNodeHandle *parent, int index,
+                                 IxLatchContext &context) {
     // Todo:
     // 1. 通过index判断neighbor_node是否为node的前驱结点
     // 2. 从neighbor_node中移动一个键值对到node结点中
@@ -588,8 +613,8 @@ void IxIndexHandle::redistribute(IxNodeHandle *neighbor_node, IxNodeHandle *node
     int insert_pos = index ? 0 : node->get_size();
     node->insert_pair( insert_pos, neighbor_node->get_key(erase_pos),  *(neighbor_node->get_rid(erase_pos)) );
     neighbor_node->erase_pair( erase_pos );
-    maintain_child( node, insert_pos );
-    maintain_parent( index?node:neighbor_node );
+    maintain_child( node, insert_pos, context );
+    maintain_parent( index?node:neighbor_node, context );
 }
 
 /**
@@ -605,9 +630,11 @@ void IxIndexHandle::redistribute(IxNodeHandle *neighbor_node, IxNodeHandle *node
  * @param index node在parent中的rid_idx
  * @return true means parent node should be deleted, false means no deletion happend
  * @note Assume that *neighbor_node is the left sibling of *node (neighbor -> node)
+ * @note 递归处理parent之前释放node和neighbor_node：处理parent时要给parent的兄弟加latch，
+ * 此时不能持有下一层的结点，否则会与从左向右给叶子加latch的线程形成环
  */
 bool IxIndexHandle::coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node, IxNodeHandle **parent, int index,
-                             Transaction *transaction, bool *root_is_latched) {
+                             Transaction *transaction, IxLatchContext &context) {
     // Todo:
     // 1. 用index判断neighbor_node是否为node的前驱结点，若不是则交换两个结点，让neighbor_node作为左结点，node作为右结点
     // 2. 把node结点的键值对移动到neighbor_node中，并更新node结点孩子结点的父节点信息（调用maintain_child函数）
@@ -620,16 +647,22 @@ bool IxIndexHandle::coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node,
         neighbor_node = temp;
         index += 1;
     }
-    if( (*node)->is_leaf_page() && (*node)->get_page_no()==file_hdr_->last_leaf_ ) // note
-        file_hdr_->last_leaf_ = (*neighbor_node)->get_page_no();
+    if( (*node)->is_leaf_page() ) { // note
+        std::scoped_lock lock{file_hdr_latch_};
+        if( (*node)->get_page_no()==file_hdr_->last_leaf_ )
+            file_hdr_->last_leaf_ = (*neighbor_node)->get_page_no();
+    }
     int insert_pos = (*neighbor_node)->get_size();
     (*neighbor_node)->insert_pairs( insert_pos, (*node)->get_key(0), (*node)->get_rid(0), (*node)->get_size() ); // 2
     for( int i = 0; i < (*node)->get_size(); i++ )
-        maintain_child( *neighbor_node, i+insert_pos );
-    erase_leaf( *node ); // 3
-    release_node_handle( **node );
+        maintain_child( *neighbor_node, i+insert_pos, context );
+    if( (*node)->is_leaf_page() )
+        erase_leaf( *node, context ); // 3
+    release_node_handle( **node, context );
     (*parent)->erase_pair( index );
-    return coalesce_or_redistribute( *parent, transaction );
+    context.release( *node );
+    context.release( *neighbor_node );
+    return coalesce_or_redistribute( *parent, transaction, context );
 }
 
 /**
@@ -642,11 +675,10 @@ bool IxIndexHandle::coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node,
  * @note iid和rid存的不是一个东西，rid是上层传过来的记录位置，iid是索引内部生成的索引槽位置
  */
 Rid IxIndexHandle::get_rid(const Iid &iid) const {
-    IxNodeHandle *node = fetch_node(iid.page_no);
+    std::unique_ptr<IxNodeHandle> node = fetch_read_node(iid.page_no);
     if (iid.slot_no >= node->get_size()) {
         throw IndexEntryNotFoundError();
     }
-    buffer_pool_manager_->unpin_page(node->get_page_id(), false);  // unpin it!
     return *node->get_rid(iid.slot_no);
 }
 
@@ -659,8 +691,8 @@ Rid IxIndexHandle::get_rid(const Iid &iid) const {
  * 可用*(int *)key转换回去
  */
 Iid IxIndexHandle::lower_bound(const char *key) {
-
-    return Iid{-1, -1};
+    std::unique_ptr<IxNodeHandle> leaf = find_leaf_page(key, Operation::FIND, nullptr).first;
+    return leaf_iid(leaf.get(), leaf->lower_bound(key));
 }
 
 /**
@@ -670,8 +702,24 @@ Iid IxIndexHandle::lower_bound(const char *key) {
  * @return Iid
  */
 Iid IxIndexHandle::upper_bound(const char *key) {
-    
-    return Iid{-1, -1};
+    std::unique_ptr<IxNodeHandle> leaf = find_leaf_page(key, Operation::FIND, nullptr).first;
+    // 结点的upper_bound从1开始，叶子结点中key可能小于第0个key，因此由lower_bound跳过相等的key
+    int key_idx = leaf->lower_bound(key);
+    if (key_idx < leaf->get_size() &&
+        file_hdr_->key_cmp_(key, leaf->get_key(key_idx)) == 0) {
+        key_idx++;
+    }
+    return leaf_iid(leaf.get(), key_idx);
+}
+
+/**
+ * @brief 叶子结点中key_idx位置对应的Iid，key_idx为结点大小并且不是最右叶子结点时指向下一个叶子结点的开头
+ */
+Iid IxIndexHandle::leaf_iid(IxNodeHandle *leaf, int key_idx) const {
+    if (key_idx == leaf->get_size() && leaf->get_next_leaf() != IX_LEAF_HEADER_PAGE) {
+        return Iid{.page_no = leaf->get_next_leaf(), .slot_no = 0};
+    }
+    return Iid{.page_no = leaf->get_page_no(), .slot_no = key_idx};
 }
 
 /**
@@ -681,10 +729,9 @@ Iid IxIndexHandle::upper_bound(const char *key) {
  * @return Iid
  */
 Iid IxIndexHandle::leaf_end() const {
-    IxNodeHandle *node = fetch_node(file_hdr_->last_leaf_);
-    Iid iid = {.page_no = file_hdr_->last_leaf_, .slot_no = node->get_size()};
-    buffer_pool_manager_->unpin_page(node->get_page_id(), false);  // unpin it!
-    return iid;
+    page_id_t last_leaf = get_last_leaf();
+    std::unique_ptr<IxNodeHandle> node = fetch_read_node(last_leaf);
+    return Iid{.page_no = last_leaf, .slot_no = node->get_size()};
 }
 
 /**
@@ -699,7 +746,7 @@ Iid IxIndexHandle::leaf_begin() const {
 }
 
 /**
- * @brief 获取一个指定结点
+ * @brief 获取一个指定结点，供测试和调试工具遍历B+树使用
  *
  * @param page_no
  * @return IxNodeHandle*
@@ -712,48 +759,78 @@ IxNodeHandle *IxIndexHandle::fetch_node(int page_no) const {
     return node;
 }
 
+/**
+ * @brief 获取一个指定结点并加页面共享latch，用于查找、扫描和乐观下降
+ *
+ * @param page_no
+ * @return std::unique_ptr<IxNodeHandle> 释放时自动unlatch和unpin
+ */
+std::unique_ptr<IxNodeHandle> IxIndexHandle::fetch_read_node(int page_no) const {
+    return std::make_unique<IxNodeHandle>(file_hdr_, buffer_pool_manager_->fetch_page_read(PageId{fd_, page_no}));
+}
+
+/**
+ * @brief 获取一个指定结点并加页面排他latch，用于插入和删除时修改结点
+ * 同一次修改中已经持有的结点不能再次获取，需要先在IxLatchContext中查找
+ *
+ * @param page_no
+ * @return std::unique_ptr<IxNodeHandle> 释放时自动unlatch和unpin，修改过的结点标记为脏页
+ */
+std::unique_ptr<IxNodeHandle> IxIndexHandle::fetch_write_node(int page_no) const {
+    return std::make_unique<IxNodeHandle>(file_hdr_, buffer_pool_manager_->fetch_page_write(PageId{fd_, page_no}));
+}
+
 /**
  * @brief 创建一个新结点
  *
- * @return IxNodeHandle*
- * @note pin the page, remember to unpin it outside!
+ * @return std::unique_ptr<IxNodeHandle> 释放时自动unpin
  * 注意：对于Index的处理是，删除某个页面后，认为该被删除的页面是free_page
  * 而first_free_page实际上就是最新被删除的页面，初始为IX_NO_PAGE
  * 在最开始插入时，一直是create node，那么first_page_no一直没变，一直是IX_NO_PAGE
  * 与Record的处理不同，Record将未插入满的记录页认为是free_page
  */
-IxNodeHandle *IxIndexHandle::create_node() {
-    IxNodeHandle *node;
-    file_hdr_->num_pages_++;
+std::unique_ptr<IxNodeHandle> IxIndexHandle::create_node() {
+    {
+        std::scoped_lock lock{file_hdr_latch_};
+        file_hdr_->num_pages_++;
+    }
 
     PageId new_page_id = {.fd = fd_, .page_no = INVALID_PAGE_ID};
     // 从3开始分配page_no，第一次分配之后，new_page_id.page_no=3，file_hdr_.num_pages=4
-    Page *page = buffer_pool_manager_->new_page(&new_page_id);
-    node = new IxNodeHandle(file_hdr_, page);
-    return node;
+    // 新结点持有页面排他latch，链入叶子链表之后其他线程可以通过next_leaf访问它
+    return std::make_unique<IxNodeHandle>(file_hdr_, buffer_pool_manager_->new_page_guarded(&new_page_id));
+}
+
+/**
+ * @brief 读取最右叶子结点的页号，插入和删除时file_hdr_.last_leaf可能被其他线程修改
+ */
+page_id_t IxIndexHandle::get_last_leaf() const {
+    std::scoped_lock lock{file_hdr_latch_};
+    return file_hdr_->last_leaf_;
 }
 
 /**
  * @brief 从node开始更新其父节点的第一个key，一直向上更新直到根节点
+ * 只更新context持有的祖先：下降时释放的祖先的key不会因为本次删除而改变(见is_safe)
  *
  * @param node
  */
-void IxIndexHandle::maintain_parent(IxNodeHandle *node) {
+void IxIndexHandle::maintain_parent(IxNodeHandle *node, IxLatchContext &context) {
     IxNodeHandle *curr = node;
     while (curr->get_parent_page_no() != IX_NO_PAGE) {
         // Load its parent
-        IxNodeHandle *parent = fetch_node(curr->get_parent_page_no());
+        IxNodeHandle *parent = context.find(curr->get_parent_page_no());
+        if (parent == nullptr) {
+            break;
+        }
         int rank = parent->find_child(curr);
         char *parent_key = parent->get_key(rank);
         char *child_first_key = curr->get_key(0);
         if (memcmp(parent_key, child_first_key, file_hdr_->col_tot_len_) == 0) {
-            assert(buffer_pool_manager_->unpin_page(parent->get_page_id(), true));
             break;
         }
-        memcpy(parent_key, child_first_key, file_hdr_->col_tot_len_);  // 修改了parent node
+        parent->set_key(rank, child_first_key);  // 修改了parent node
         curr = parent;
-
-        assert(buffer_pool_manager_->unpin_page(parent->get_page_id(), true));
     }
 }
 
@@ -762,37 +839,48 @@ void IxIndexHandle::maintain_parent(IxNodeHandle *node) {
  *
  * @param leaf 要删除的leaf
  */
-void IxIndexHandle::erase_leaf(IxNodeHandle *leaf) {
+void IxIndexHandle::erase_leaf(IxNodeHandle *leaf, IxLatchContext &context) {
     assert(leaf->is_leaf_page());
 
-    IxNodeHandle *prev = fetch_node(leaf->get_prev_leaf());
+    // 被删除的总是右边的结点，前驱结点是合并到的兄弟结点，已经持有
+    IxNodeHandle *prev = context.find(leaf->get_prev_leaf());
+    assert(prev != nullptr);
     prev->set_next_leaf(leaf->get_next_leaf());
-    buffer_pool_manager_->unpin_page(prev->get_page_id(), true);
 
-    IxNodeHandle *next = fetch_node(leaf->get_next_leaf());
+    // 后继结点在右边，叶子层只从左向右加latch
+    std::unique_ptr<IxNodeHandle> next = fetch_write_node(leaf->get_next_leaf());
     next->set_prev_leaf(leaf->get_prev_leaf());  // 注意此处是SetPrevLeaf()
-    buffer_pool_manager_->unpin_page(next->get_page_id(), true);
 }
 
 /**
- * @brief 删除node时，更新file_hdr_.num_pages
+ * @brief 删除node时，更新file_hdr_.num_pages，并记录node的页面，在delete_entry释放所有latch之后回收
+ * node此时仍被固定，不能立即释放其页面
  *
  * @param node
  */
-void IxIndexHandle::release_node_handle(IxNodeHandle &node) {
-    file_hdr_->num_pages_--;
+void IxIndexHandle::release_node_handle(IxNodeHandle &node, IxLatchContext &context) {
+    {
+        std::scoped_lock lock{file_hdr_latch_};
+        file_hdr_->num_pages_--;
+    }
+    context.deleted_pages_.push_back(node.get_page_no());
 }
 
 /**
  * @brief 将node的第child_idx个孩子结点的父节点置为node
  */
-void IxIndexHandle::maintain_child(IxNodeHandle *node, int child_idx) {
+void IxIndexHandle::maintain_child(IxNodeHandle *node, int child_idx, IxLatchContext &context) {
     if (!node->is_leaf_page()) {
         //  Current node is inner node, load its child and set its parent to current node
+        //  孩子可能是本次分裂中已经持有的结点，其余孩子加latch后立即释放
         int child_page_no = node->value_at(child_idx);
-        IxNodeHandle *child = fetch_node(child_page_no);
+        IxNodeHandle *child = context.find(child_page_no);
+        std::unique_ptr<IxNodeHandle> child_handle;
+        if (child == nullptr) {
+            child_handle = fetch_write_node(child_page_no);
+            child = child_handle.get();
+        }
         child->set_parent_page_no(node->get_page_no());
-        buffer_pool_manager_->unpin_page(child->get_page_id(), true);
     }
 }
 
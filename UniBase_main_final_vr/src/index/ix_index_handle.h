@@ -1,5 +1,10 @@
 #pragma once
 
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+
 #include "ix_defs.h"
 #include "transaction/transaction.h"
 
@@ -7,63 +12,42 @@ enum class Operation { FIND = 0, INSERT, DELETE };  // 三种操作：查找、
 
 static const bool binary_search = false;
 
-inline int ix_compare(const char *a, const char *b, ColType type, int col_len) {
-    switch (type) {
-        case TYPE_INT: {
-            std::cout<<"types:"<<type<<'\n';
-            int ia = *(int *)a;
-            int ib = *(int *)b;
-            return (ia < ib) ? -1 : ((ia > ib) ? 1 : 0);
-        }
-        case TYPE_FLOAT: {
-            std::cout<<"types:"<<type<<'\n';
-            float fa = *(float *)a;
-            float fb = *(float *)b;
-            return (fa < fb) ? -1 : ((fa > fb) ? 1 : 0);
-        }
-        case TYPE_STRING:
-            std::cout<<"types:"<<type<<'\n';
-            return memcmp(a, b, col_len);
-        default:
-            std::cout<<"types:"<<type<<'\n';
-            throw InternalError("Unexpected data type");
-    }
-}
-
-inline int ix_compare(const char* a, const char* b, const std::vector<ColType>& col_types, const std::vector<int>& col_lens) {
-    int offset = 0;
-    for(size_t i = 0; i < col_types.size(); ++i) {
-        int res = ix_compare(a + offset, b + offset, col_types[i], col_lens[i]);
-        if(res != 0) return res;
-        offset += col_lens[i];
-    }
-    return 0;
-}
-
 /* 管理B+树中的每个节点 */
 class IxNodeHandle {
     friend class IxIndexHandle;
     friend class IxScan;
+    friend class IxBulkLoader;
 
    private:
     const IxFileHdr *file_hdr;      // 节点所在文件的头部信息
     Page *page;                     // 存储节点的页面
-    IxPageHdr *page_hdr;            // page->data的第一部分，指针指向首地址，长度为sizeof(IxPageHdr)
+    IxPageHdr *page_hdr;            // page->data的第一部分，在页面lsn和校验和之后，长度为sizeof(IxPageHdr)
     char *keys;                     // page->data的第二部分，指针指向首地址，长度为file_hdr->keys_size，每个key的长度为file_hdr->col_len
     Rid *rids;                      // page->data的第三部分，指针指向首地址
+    BasicPageGuard guard;           // 结点页面的固定和latch，为空时由调用者自行unpin
 
    public:
     IxNodeHandle() = default;
 
     IxNodeHandle(const IxFileHdr *file_hdr_, Page *page_) : file_hdr(file_hdr_), page(page_) {
-        page_hdr = reinterpret_cast<IxPageHdr *>(page->get_data());
-        keys = page->get_data() + sizeof(IxPageHdr);
+        page_hdr = reinterpret_cast<IxPageHdr *>(page->get_data() + Page::OFFSET_PAGE_HDR);
+        keys = page->get_data() + Page::OFFSET_PAGE_HDR + sizeof(IxPageHdr);
         rids = reinterpret_cast<Rid *>(keys + file_hdr->keys_size_);
     }
 
+    IxNodeHandle(const IxFileHdr *file_hdr_, BasicPageGuard guard_) : IxNodeHandle(file_hdr_, guard_.get_page()) {
+        guard = std::move(guard_);
+    }
+
+    // 修改了结点内容，释放结点时写回标记为脏页；setter和插入删除键值对时自动调用
+    void mark_dirty() { guard.mark_dirty(); }
+
     int get_size() { return page_hdr->num_key; }
 
-    void set_size(int size) { page_hdr->num_key = size; }
+    void set_size(int size) {
+        page_hdr->num_key = size;
+        mark_dirty();
+    }
 
     int get_max_size() { return file_hdr->btree_order_ + 1; }
 
@@ -88,19 +72,34 @@ class IxNodeHandle {
 
     bool is_root_page() { return get_parent_page_no() == INVALID_PAGE_ID; }
 
-    void set_next_leaf(page_id_t page_no) { page_hdr->next_leaf = page_no; }
+    void set_next_leaf(page_id_t page_no) {
+        page_hdr->next_leaf = page_no;
+        mark_dirty();
+    }
 
-    void set_prev_leaf(page_id_t page_no) { page_hdr->prev_leaf = page_no; }
+    void set_prev_leaf(page_id_t page_no) {
+        page_hdr->prev_leaf = page_no;
+        mark_dirty();
+    }
 
-    void set_parent_page_no(page_id_t parent) { page_hdr->parent = parent; }
+    void set_parent_page_no(page_id_t parent) {
+        page_hdr->parent = parent;
+        mark_dirty();
+    }
 
     char *get_key(int key_idx) const { return keys + key_idx * file_hdr->col_tot_len_; }
 
     Rid *get_rid(int rid_idx) const { return &rids[rid_idx]; }
 
-    void set_key(int key_idx, const char *key) { memcpy(keys + key_idx * file_hdr->col_tot_len_, key, file_hdr->col_tot_len_); }
+    void set_key(int key_idx, const char *key) {
+        memcpy(keys + key_idx * file_hdr->col_tot_len_, key, file_hdr->col_tot_len_);
+        mark_dirty();
+    }
 
-    void set_rid(int rid_idx, const Rid &rid) { rids[rid_idx] = rid; }
+    void set_rid(int rid_idx, const Rid &rid) {
+        rids[rid_idx] = rid;
+        mark_dirty();
+    }
 
     int lower_bound(const char *target) const;
 
@@ -151,17 +150,68 @@ class IxNodeHandle {
     }
 };
 
+/*
+插入和删除在悲观模式下持有排他latch的结点(latch crabbing)
+下降时每到达一个安全的结点(本次修改不会使其分裂或合并)就释放它的所有祖先，之后的修改只会影响仍然持有的结点
+分裂和合并中创建、获取的结点也由上下文持有，操作结束时一起释放；被删除结点的页面在所有latch释放之后再回收
+*/
+class IxLatchContext {
+   public:
+    IxNodeHandle *hold(std::unique_ptr<IxNodeHandle> node) {
+        nodes_.push_back(std::move(node));
+        return nodes_.back().get();
+    }
+
+    // 查找已经持有的结点，同一个结点不能再次加latch
+    IxNodeHandle *find(page_id_t page_no) const {
+        for (auto &node : nodes_) {
+            if (node->get_page_no() == page_no) return node.get();
+        }
+        return nullptr;
+    }
+
+    // 释放除最后获取的结点之外的所有结点以及root_latch_
+    void release_ancestors() {
+        nodes_.erase(nodes_.begin(), nodes_.end() - 1);
+        if (root_lock_.owns_lock()) root_lock_.unlock();
+    }
+
+    void release(IxNodeHandle *node) {
+        for (auto it = nodes_.begin(); it != nodes_.end(); ++it) {
+            if (it->get() == node) {
+                nodes_.erase(it);
+                return;
+            }
+        }
+    }
+
+    IxNodeHandle *back() const { return nodes_.back().get(); }
+
+    // 持有root_latch_的排他锁时才能修改根结点
+    bool root_is_latched() const { return root_lock_.owns_lock(); }
+
+    std::unique_lock<std::shared_mutex> root_lock_;
+    std::vector<page_id_t> deleted_pages_;
+
+   private:
+    std::deque<std::unique_ptr<IxNodeHandle>> nodes_;
+};
+
 /* B+树 */
 class IxIndexHandle {
     friend class IxScan;
     friend class IxManager;
+    friend class IxEntrySorter;
+    friend class IxBulkLoader;
 
    private:
     DiskManager *disk_manager_;
     BufferPoolManager *buffer_pool_manager_;
     int fd_;                                    // 存储B+树的文件
     IxFileHdr* file_hdr_;                       // 存了root_page，但其初始化为2（第0页存FILE_HDR_PAGE，第1页存LEAF_HEADER_PAGE）
-    std::mutex root_latch_;
+    // 保护file_hdr_->root_page_：下降时先持有root_latch_再给根结点加latch，根结点可能改变的修改持有排他锁直到根结点安全
+    mutable std::shared_mutex root_latch_;
+    mutable std::mutex file_hdr_latch_;         // 保护file_hdr_中的num_pages_和last_leaf_
 
    public:
     IxIndexHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, int fd);
@@ -169,27 +219,29 @@ class IxIndexHandle {
     // for search
     bool get_value(const char *key, std::vector<Rid> *result, Transaction *transaction);
 
-    std::pair<IxNodeHandle *, bool> find_leaf_page(const char *key, Operation operation, Transaction *transaction,
-                                                 bool find_first = false);
+    std::pair<std::unique_ptr<IxNodeHandle>, bool> find_leaf_page(const char *key, Operation operation,
+                                                                Transaction *transaction, bool find_first = false);
 
     // for insert
     page_id_t insert_entry(const char *key, const Rid &value, Transaction *transaction);
 
-    IxNodeHandle *split(IxNodeHandle *node);
+    IxNodeHandle *split(IxNodeHandle *node, IxLatchContext &context);
 
-    void insert_into_parent(IxNodeHandle *old_node, const char *key, IxNodeHandle *new_node, Transaction *transaction);
+    void insert_into_parent(IxNodeHandle *old_node, const char *key, IxNodeHandle *new_node, Transaction *transaction,
+                            IxLatchContext &context);
 
     // for delete
     bool delete_entry(const char *key, Transaction *transaction);
 
-    bool coalesce_or_redistribute(IxNodeHandle *node, Transaction *transaction = nullptr,
-                                bool *root_is_latched = nullptr);
-    bool adjust_root(IxNodeHandle *old_root_node);
+    bool coalesce_or_redistribute(IxNodeHandle *node, Transaction *transaction, IxLatchContext &context);
 
-    void redistribute(IxNodeHandle *neighbor_node, IxNodeHandle *node, IxNodeHandle *parent, int index);
+    bool adjust_root(IxNodeHandle *old_root_node, IxLatchContext &context);
+
+    void redistribute(IxNodeHandle *neighbor_node, IxNodeHandle *node, IxNodeHandle *parent, int index,
+                      IxLatchContext &context);
 
     bool coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node, IxNodeHandle **parent, int index,
-                  Transaction *transaction, bool *root_is_latched);
+                  Transaction *transaction, IxLatchContext &context);
 
     Iid lower_bound(const char *key);
 
@@ -200,6 +252,12 @@ class IxIndexHandle {
     Iid leaf_begin() const;
 
    private:
+    void find_leaf_page_pessimistic(const char *key, Operation operation, IxLatchContext &context);
+
+    bool is_safe(IxNodeHandle *node, const char *key, Operation operation);
+
+    Iid leaf_iid(IxNodeHandle *leaf, int key_idx) const;
+
     // 辅助函数
     void update_root_page_no(page_id_t root) { file_hdr_->root_page_ = root; }
 
@@ -208,16 +266,22 @@ class IxIndexHandle {
     // for get/create node
     IxNodeHandle *fetch_node(int page_no) const;
 
-    IxNodeHandle *create_node();
+    std::unique_ptr<IxNodeHandle> fetch_read_node(int page_no) const;
+
+    std::unique_ptr<IxNodeHandle> fetch_write_node(int page_no) const;
+
+    std::unique_ptr<IxNodeHandle> create_node();
+
+    page_id_t get_last_leaf() const;
 
     // for maintain data structure
-    void maintain_parent(IxNodeHandle *node);
+    void maintain_parent(IxNodeHandle *node, IxLatchContext &context);
 
-    void erase_leaf(IxNodeHandle *leaf);
+    void erase_leaf(IxNodeHandle *leaf, IxLatchContext &context);
 
-    void release_node_handle(IxNodeHandle &node);
+    void release_node_handle(IxNodeHandle &node, IxLatchContext &context);
 
-    void maintain_child(IxNodeHandle *node, int child_idx);
+    void maintain_child(IxNodeHandle *node, int child_idx, IxLatchContext &context);
 
     // for index test
     Rid get_rid(const Iid &iid) const;
@@ -3,6 +3,7 @@
 #include <memory>
 #include <string>
 
+#include "storage/page_checksum.h"
 #include "system/sm_meta.h"
 #include "ix_defs.h"
 #include "ix_index_handle.h"
@@ -63,9 +64,10 @@ class IxManager {
         if (col_tot_len > IX_MAX_COL_LEN) {
             throw InvalidColLengthError(col_tot_len);
         }
-        // 根据 |page_hdr| + (|attr| + |rid|) * (n + 1) <= PAGE_SIZE 求得n的最大值btree_order
+        // 根据 |lsn, checksum| + |page_hdr| + (|attr| + |rid|) * (n + 1) <= PAGE_SIZE 求得n的最大值btree_order
         // 即 n <= btree_order，那么btree_order就是每个结点最多可插入的键值对数量（实际还多留了一个空位，但其不可插入）
-        int btree_order = static_cast<int>((PAGE_SIZE - sizeof(IxPageHdr)) / (col_tot_len + sizeof(Rid)) - 1);
+        int btree_order = static_cast<int>((PAGE_SIZE - Page::OFFSET_PAGE_HDR - sizeof(IxPageHdr)) /
+                                           (col_tot_len + sizeof(Rid)) - 1);
         assert(btree_order > 2);
 
         // Create file header and write to file
@@ -89,7 +91,7 @@ class IxManager {
         // Create leaf list header page and write to file
         {
             memset(page_buf, 0, PAGE_SIZE);
-            auto phdr = reinterpret_cast<IxPageHdr *>(page_buf);
+            auto phdr = reinterpret_cast<IxPageHdr *>(page_buf + Page::OFFSET_PAGE_HDR);
             *phdr = {
                 .next_free_page_no = IX_NO_PAGE,
                 .parent = IX_NO_PAGE,
@@ -98,13 +100,14 @@ class IxManager {
                 .prev_leaf = IX_INIT_ROOT_PAGE,
                 .next_leaf = IX_INIT_ROOT_PAGE,
             };
+            set_page_checksum(page_buf);  // 结点页面之后由缓冲池读入并校验
             disk_manager_->write_page(fd, IX_LEAF_HEADER_PAGE, page_buf, PAGE_SIZE);
         }
         // 注意root node页号为2，也标记为叶子结点，其前一个/后一个叶子均指向leaf header
         // Create root node and write to file
         {
             memset(page_buf, 0, PAGE_SIZE);
-            auto phdr = reinterpret_cast<IxPageHdr *>(page_buf);
+            auto phdr = reinterpret_cast<IxPageHdr *>(page_buf + Page::OFFSET_PAGE_HDR);
             *phdr = {
                 .next_free_page_no = IX_NO_PAGE,
                 .parent = IX_NO_PAGE,
@@ -114,6 +117,7 @@ class IxManager {
                 .next_leaf = IX_LEAF_HEADER_PAGE,
             };
             // Must write PAGE_SIZE here in case of future fetch_node()
+            set_page_checksum(page_buf);
             disk_manager_->write_page(fd, IX_INIT_ROOT_PAGE, page_buf, PAGE_SIZE);
         }
 
@@ -137,15 +141,27 @@ class IxManager {
     std::unique_ptr<IxIndexHandle> open_index(const std::string &filename, const std::vector<ColMeta>& index_cols) {
         std::string ix_name = get_index_name(filename, index_cols);
         int fd = disk_manager_->open_file(ix_name);
-        return std::make_unique<IxIndexHandle>(disk_manager_, buffer_pool_manager_, fd);
+        disk_manager_->set_page_checksums(fd, true);
+        try {
+            return std::make_unique<IxIndexHandle>(disk_manager_, buffer_pool_manager_, fd);
+        } catch (FileFormatError &) {
+            disk_manager_->close_file(fd);
+            throw;
+        }
     }
 
     std::unique_ptr<IxIndexHandle> open_index(const std::string &filename, const std::vector<std::string>& index_cols) {
         std::string ix_name = get_index_name(filename, index_cols);
         //printf("RNM\n");
         int fd = disk_manager_->open_file(ix_name);
+        disk_manager_->set_page_checksums(fd, true);
         //printf("OPEN FIN\n");
-        return std::make_unique<IxIndexHandle>(disk_manager_, buffer_pool_manager_, fd);
+        try {
+            return std::make_unique<IxIndexHandle>(disk_manager_, buffer_pool_manager_, fd);
+        } catch (FileFormatError &) {
+            disk_manager_->close_file(fd);
+            throw;
+        }
         //printf("Make_unique FIN\n");
     }
 
@@ -1,21 +1,76 @@
 #include "ix_scan.h"
 
+#include <algorithm>
+
 /**
- * @brief 
- * @todo 加上读锁（需要使用缓冲池得到page）
+ * @brief 在当前叶子结点的页面共享latch下移动到下一个位置
+ * latch只保证读到完整的页面，不会重新定位iid_：调用者需要在整个扫描期间排除对索引的写操作
+ * 最右叶子结点的next_leaf是叶子链表的头结点IX_LEAF_HEADER_PAGE，不需要读取file_hdr_.last_leaf
  */
 void IxScan::next() {
     assert(!is_end());
-    IxNodeHandle *node = ih_->fetch_node(iid_.page_no);
-    assert(node->is_leaf_page());
-    assert(iid_.slot_no < node->get_size());
-    // increment slot no
-    iid_.slot_no++;
-    if (iid_.page_no != ih_->file_hdr_->last_leaf_ && iid_.slot_no == node->get_size()) {
-        // go to next leaf
-        iid_.slot_no = 0;
-        iid_.page_no = node->get_next_leaf();
+    bool next_leaf;
+    {
+        std::unique_ptr<IxNodeHandle> node = ih_->fetch_read_node(iid_.page_no);
+        assert(node->is_leaf_page());
+        assert(iid_.slot_no < node->get_size());
+        // increment slot no
+        iid_.slot_no++;
+        next_leaf = node->get_next_leaf() != IX_LEAF_HEADER_PAGE && iid_.slot_no == node->get_size();
+        if (next_leaf) {
+            // go to next leaf
+            iid_.slot_no = 0;
+            iid_.page_no = node->get_next_leaf();
+        }
+    }
+    if (next_leaf && !is_end()) {
+        prefetch_leaves(iid_.page_no);
+    }
+}
+
+/**
+ * @brief 预读leaf_page_no之后的叶子结点：叶子结点之间只有next_leaf指针，因此从父结点中取出其后的兄弟结点，
+ *        一次预读PREFETCH_PAGES个；当前叶子结点还在上一次预读的前半部分时不需要预读
+ *        当前叶子结点是父结点的最后一个孩子时只预读next_leaf，进入下一个父结点后再成批预读
+ *        叶子结点和父结点先后加latch，读到父结点时它可能已经不是叶子结点的父结点，此时只预读next_leaf
+ */
+void IxScan::prefetch_leaves(page_id_t leaf_page_no) {
+    auto it = std::find(prefetch_window_.begin(), prefetch_window_.end(), leaf_page_no);
+    if (it != prefetch_window_.end() &&
+        static_cast<size_t>(it - prefetch_window_.begin()) < prefetch_window_.size() / 2) {
+        return;
     }
+    page_id_t parent_page_no;
+    page_id_t next_leaf;
+    {
+        std::unique_ptr<IxNodeHandle> leaf = ih_->fetch_read_node(leaf_page_no);
+        parent_page_no = leaf->get_parent_page_no();
+        next_leaf = leaf->get_next_leaf();
+    }
+    if (next_leaf == IX_LEAF_HEADER_PAGE || leaf_page_no == end_.page_no) {
+        prefetch_window_.clear();
+        return;
+    }
+
+    std::vector<page_id_t> leaves;
+    if (parent_page_no != INVALID_PAGE_ID) {
+        std::unique_ptr<IxNodeHandle> parent = ih_->fetch_read_node(parent_page_no);
+        int child_idx = 0;
+        while (child_idx < parent->get_size() && parent->value_at(child_idx) != leaf_page_no) {
+            child_idx++;
+        }
+        for (int i = child_idx + 1; i < parent->get_size() && leaves.size() < PREFETCH_PAGES; i++) {
+            leaves.push_back(parent->value_at(i));
+            if (leaves.back() == end_.page_no) break;  // 不预读扫描范围之外的结点
+        }
+    }
+    if (leaves.empty()) {
+        leaves.push_back(next_leaf);
+    }
+
+    prefetch_window_ = leaves;
+    prefetch_window_.insert(prefetch_window_.begin(), leaf_page_no);
+    bpm_->prefetch_pages(ih_->fd_, leaves);
 }
 
 Rid IxScan::rid() const {
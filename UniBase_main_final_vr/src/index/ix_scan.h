@@ -7,16 +7,25 @@
 
 // 用于遍历叶子结点
 // 用于直接遍历叶子结点，而不用findleafpage来得到叶子结点
-// TODO：对page遍历时，要加上读锁
+// 每次移动时只持有当前叶子结点的页面共享latch，移动之间不持有任何latch
+// iid_和end_是叶子结点中的原始位置：插入和删除会移动槽位、分裂或合并叶子结点，合并后的叶子结点还可能被释放，
+// 因此扫描期间调用者必须阻止对该索引的插入和删除(例如持有表上的共享锁)，IxScan不能与写操作并发执行
 class IxScan : public RecScan {
     const IxIndexHandle *ih_;
     Iid iid_;  // 初始为lower（用于遍历的指针）
     Iid end_;  // 初始为upper
     BufferPoolManager *bpm_;
+    std::vector<page_id_t> prefetch_window_;  // 最近一次预读的叶子结点，按扫描顺序排列
+
+    void prefetch_leaves(page_id_t leaf_page_no);
 
    public:
     IxScan(const IxIndexHandle *ih, const Iid &lower, const Iid &upper, BufferPoolManager *bpm)
-        : ih_(ih), iid_(lower), end_(upper), bpm_(bpm) {}
+        : ih_(ih), iid_(lower), end_(upper), bpm_(bpm) {
+        if (!is_end()) {
+            prefetch_leaves(iid_.page_no);
+        }
+    }
 
     void next() override;
 
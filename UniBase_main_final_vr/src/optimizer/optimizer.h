@@ -28,6 +28,12 @@ class Optimizer {
         } else if (auto x = std::dynamic_pointer_cast<ast::ShowTables>(query->parse)) {
             // show tables;
             return std::make_shared<OtherPlan>(T_ShowTable, std::string());
+        } else if (auto x = std::dynamic_pointer_cast<ast::ShowBufferStats>(query->parse)) {
+            // show buffer stats;
+            return std::make_shared<OtherPlan>(T_ShowBufferStats, std::string());
+        } else if (auto x = std::dynamic_pointer_cast<ast::ResizeBufferPool>(query->parse)) {
+            // resize buffer pool n;
+            return std::make_shared<OtherPlan>(T_ResizeBufferPool, x->pool_size);
         } else if (auto x = std::dynamic_pointer_cast<ast::DescTable>(query->parse)) {
             // desc table;
             return std::make_shared<OtherPlan>(T_DescTable, x->tab_name);
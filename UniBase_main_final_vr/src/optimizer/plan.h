@@ -13,6 +13,8 @@ typedef enum PlanTag{
     T_Invalid = 1,
     T_Help,
     T_ShowTable,
+    T_ShowBufferStats,
+    T_ResizeBufferPool,
     T_DescTable,
     T_CreateTable,
     T_DropTable,
@@ -160,9 +162,10 @@ class DDLPlan : public Plan
         std::string tab_name_;
         std::vector<std::string> tab_col_names_;
         std::vector<ColDef> cols_;
+        bool compressed_ = false;   // CREATE TABLE ... COMPRESSED
 };
 
-// help; show tables; desc tables; begin; abort; commit; rollback语句对应的plan
+// help; show tables; show buffer stats; resize buffer pool; desc tables; begin; abort; commit; rollback语句对应的plan
 class OtherPlan : public Plan
 {
     public:
@@ -171,8 +174,14 @@ class OtherPlan : public Plan
             Plan::tag = tag;
             tab_name_ = std::move(tab_name);            
         }
+        OtherPlan(PlanTag tag, int pool_size)
+        {
+            Plan::tag = tag;
+            pool_size_ = pool_size;
+        }
         ~OtherPlan(){}
         std::string tab_name_;
+        int pool_size_ = 0;     // resize buffer pool的目标帧数
 };
 
 class plannerInfo{
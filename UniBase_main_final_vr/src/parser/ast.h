@@ -34,6 +34,15 @@ struct Help : public TreeNode {
 struct ShowTables : public TreeNode {
 };
 
+struct ShowBufferStats : public TreeNode {
+};
+
+struct ResizeBufferPool : public TreeNode {
+    int pool_size;
+
+    ResizeBufferPool(int pool_size_) : pool_size(pool_size_) {}
+};
+
 struct TxnBegin : public TreeNode {
 };
 
@@ -67,9 +76,10 @@ struct ColDef : public Field {
 struct CreateTable : public TreeNode {
     std::string tab_name;
     std::vector<std::shared_ptr<Field>> fields;
+    bool compressed;
 
-    CreateTable(std::string tab_name_, std::vector<std::shared_ptr<Field>> fields_) :
-            tab_name(std::move(tab_name_)), fields(std::move(fields_)) {}
+    CreateTable(std::string tab_name_, std::vector<std::shared_ptr<Field>> fields_, bool compressed_ = false) :
+            tab_name(std::move(tab_name_)), fields(std::move(fields_)), compressed(compressed_) {}
 };
 
 struct DropTable : public TreeNode {
@@ -7,8 +7,11 @@
 int main() {
     std::vector<std::string> sqls = {
         "show tables;",
+        "show buffer stats;",
+        "resize buffer pool 1024;",
         "desc tb;",
         "create table tb (a int, b float, c char(4));",
+        "create table tb (a int, c char(64)) compressed;",
         "drop table tb;",
         "create index tb(a);",
         "create index tb(a, b, c);",
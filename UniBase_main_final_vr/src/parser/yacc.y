@@ -21,7 +21,7 @@ using namespace ast;
 %define parse.error verbose
 
 // keywords
-%token SHOW TABLES CREATE TABLE DROP DESC INSERT INTO VALUES DELETE FROM ASC ORDER BY
+%token SHOW TABLES BUFFER STATS RESIZE POOL CREATE TABLE COMPRESSED DROP DESC INSERT INTO VALUES DELETE FROM ASC ORDER BY
 WHERE UPDATE SET SELECT INT CHAR FLOAT INDEX AND JOIN EXIT HELP TXN_BEGIN TXN_COMMIT TXN_ABORT TXN_ROLLBACK ORDER_BY
 // non-keywords
 %token LEQ NEQ GEQ T_EOF
@@ -106,6 +106,14 @@ dbStmt:
     {
         $$ = std::make_shared<ShowTables>();
     }
+    |   SHOW BUFFER STATS
+    {
+        $$ = std::make_shared<ShowBufferStats>();
+    }
+    |   RESIZE BUFFER POOL VALUE_INT
+    {
+        $$ = std::make_shared<ResizeBufferPool>($4);
+    }
     ;
 
 ddl:
@@ -113,6 +121,10 @@ ddl:
     {
         $$ = std::make_shared<CreateTable>($3, $5);
     }
+    |   CREATE TABLE tbName '(' fieldList ')' COMPRESSED
+    {
+        $$ = std::make_shared<CreateTable>($3, $5, true);
+    }
     |   DROP TABLE tbName
     {
         $$ = std::make_shared<DropTable>($3);
@@ -21,7 +21,8 @@ class Bitmap {
     static bool is_set(const char *bm, int pos) { return (bm[get_bucket(pos)] & get_bit(pos)) != 0; }
 
     /**
-     * @brief 找下一个为0 or 1的位
+     * @brief 找下一个为0 or 1的位，每次检查64位：把8个字节按大端序拼成一个字，位序与is_set一致(第0位是最高位)，
+     *        用clz找到字中第一个符合条件的位，复杂度为O(字数)
      * @param bit false表示要找下一个为0的位，true表示要找下一个为1的位
      * @param bm 要找的起始地址为bm
      * @param max_n 要找的从起始地址开始的偏移为[curr+1,max_n)
@@ -29,12 +30,24 @@ class Bitmap {
      * @return 找到了就返回偏移位置，没找到就返回max_n
      */
     static int next_bit(bool bit, const char *bm, int max_n, int curr) {
-        for (int i = curr + 1; i < max_n; i++) {
-            if (is_set(bm, i) == bit) {
-                return i;
+        int pos = curr + 1;
+        if (pos >= max_n) {
+            return max_n;
+        }
+        int num_bytes = (max_n + BITMAP_WIDTH - 1) / BITMAP_WIDTH;
+        uint64_t invert = bit ? 0 : ~0ULL;  // 找0时取反，统一成找1
+        int byte = pos / WORD_BITS * WORD_BYTES;
+        uint64_t word = (load_word(bm, byte, num_bytes) ^ invert) & (~0ULL >> (pos % WORD_BITS));
+        while (word == 0) {
+            byte += WORD_BYTES;
+            if (byte >= num_bytes) {
+                return max_n;
             }
+            word = load_word(bm, byte, num_bytes) ^ invert;
         }
-        return max_n;
+        // 最后一个字中max_n之后的位(包括补齐的字节)也可能符合条件，它们都在max_n之前的位之后
+        int found = byte * BITMAP_WIDTH + __builtin_clzll(word);
+        return found < max_n ? found : max_n;
     }
 
     // 找第一个为0 or 1的位
@@ -45,6 +58,19 @@ class Bitmap {
     // rid_.slot_no); int slot_no = Bitmap::first_bit(false, page_handle.bitmap, file_hdr_.num_records_per_page);
 
    private:
+    static constexpr int WORD_BYTES = 8;
+    static constexpr int WORD_BITS = WORD_BYTES * BITMAP_WIDTH;
+
+    // 读取从第byte个字节开始的一个字，第byte个字节在最高位；超出num_bytes的字节补0，不会越界读取
+    static uint64_t load_word(const char *bm, int byte, int num_bytes) {
+        uint64_t word = 0;
+        memcpy(&word, bm + byte, byte + WORD_BYTES <= num_bytes ? WORD_BYTES : num_bytes - byte);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        word = __builtin_bswap64(word);
+#endif
+        return word;
+    }
+
     static int get_bucket(int pos) { return pos / BITMAP_WIDTH; }
 
     static char get_bit(int pos) { return BITMAP_HIGHEST_BIT >> static_cast<char>(pos % BITMAP_WIDTH); }
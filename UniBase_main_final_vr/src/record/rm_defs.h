@@ -10,6 +10,8 @@ constexpr int RM_MAX_RECORD_SIZE = 512;
 
 /* 文件头，记录表数据文件的元信息，写入磁盘中文件的第0号页面 */
 struct RmFileHdr {
+    uint32_t magic;             // Page::FILE_MAGIC，第1版的文件没有这个字段
+    int format_version;         // 文件格式版本，创建时为Page::FILE_FORMAT_VERSION
     int record_size;            // 表中每条记录的大小，由于不包含变长字段，因此当前字段初始化后保持不变
     int num_pages;              // 文件中分配的页面个数（初始化为1）
     int num_records_per_page;   // 每个页面最多能存储的元组个数
@@ -80,3 +82,19 @@ struct RmRecord {
         data = nullptr;
     }
 };
+
+/* 表中记录的只读视图：直接指向缓冲池页面中的记录，不分配内存也不复制
+   视图持有页面的固定和共享latch，存在期间记录不会被修改或移走；同一个线程在视图销毁之前不能修改该页面 */
+struct RmRecordView {
+    const char* data = nullptr;  // 记录在页面中的地址
+    int size = 0;                // 记录的大小
+    BasicPageGuard guard;
+
+    RmRecordView() = default;
+
+    RmRecordView(const char* data_, int size_, BasicPageGuard guard_)
+        : data(data_), size(size_), guard(std::move(guard_)) {}
+
+    // 复制出一条独立的记录，视图销毁之后仍然需要记录时使用
+    std::unique_ptr<RmRecord> to_record() const { return std::make_unique<RmRecord>(size, const_cast<char*>(data)); }
+};
@@ -7,19 +7,23 @@
  * @return {unique_ptr<RmRecord>} rid对应的记录对象指针
  */
 std::unique_ptr<RmRecord> RmFileHandle::get_record(const Rid& rid, Context* context) const {
-    // Todo:
-    // 1. 获取指定记录所在的page handle
-    // 2. 初始化一个指向RmRecord的指针（赋值其内部的data和size）
-    
-    RmPageHandle page_handle = fetch_page_handle(rid.page_no);
-    if (rid.slot_no < 0 || !Bitmap::is_set(page_handle.bitmap, rid.slot_no)) {
+    return get_record_view(rid, context).to_record();
+}
+
+/**
+ * @description: 获取当前表中记录号为rid的记录的只读视图，不复制记录
+ * @param {Rid&} rid 记录号，指定记录的位置
+ * @param {Context*} context
+ * @return {RmRecordView} 指向页面中记录的视图，持有页面的共享latch直到视图销毁
+ */
+RmRecordView RmFileHandle::get_record_view(const Rid& rid, Context* context) const {
+    RmPageHandle page_handle = fetch_read_page_handle(rid.page_no);
+    if (rid.slot_no < 0 || rid.slot_no >= file_hdr_.num_records_per_page ||
+        !Bitmap::is_set(page_handle.bitmap, rid.slot_no)) {
         throw RecordNotFoundError(rid.page_no,rid.slot_no);
     }
-    char* record_data = page_handle.get_slot(rid.slot_no);
-    std::unique_ptr<RmRecord> record = std::make_unique<RmRecord>(file_hdr_.record_size, record_data);
-
-    return record;
-    
+    const char* record_data = page_handle.get_slot(rid.slot_no);
+    return RmRecordView(record_data, file_hdr_.record_size, std::move(page_handle.guard));
 }
 
 /**
@@ -49,13 +53,11 @@ Rid RmFileHandle::insert_record(char* buf, Context* context) {
     while(true){
         int num = page_handle.file_hdr->num_records_per_page;
         //printf("%d\n",num);
-        for (int slot_no = 0; slot_no < num; slot_no++) {
-            if (!Bitmap::is_set(page_handle.bitmap, slot_no)) {
-                free_slot = slot_no;
-                break;
-            }
+        int slot_no = Bitmap::first_bit(false, page_handle.bitmap, num);
+        if (slot_no < num) {
+            free_slot = slot_no;
+            break;
         }
-        if(free_slot!=-1)break;
         page_no = page_handle.page_hdr->next_free_page_no;
         file_hdr_.first_free_page_no = page_no;
         if(page_no == -1)break;
@@ -66,6 +68,7 @@ Rid RmFileHandle::insert_record(char* buf, Context* context) {
         RmPageHandle new_page_handle = create_new_page_handle();
         page_no = new_page_handle.page->get_page_id().page_no;
         page_handle.page_hdr->next_free_page_no = page_no;
+        page_handle.mark_dirty();
         file_hdr_.first_free_page_no = page_no;
         page_handle = std::move(new_page_handle);
         free_slot = 0;
@@ -76,6 +79,7 @@ Rid RmFileHandle::insert_record(char* buf, Context* context) {
 
     Bitmap::set(page_handle.bitmap, free_slot);
     page_handle.page_hdr->num_records++;
+    page_handle.mark_dirty();
 
     if(page_handle.page_hdr->num_records == file_hdr_.num_records_per_page){
 
@@ -101,10 +105,7 @@ void RmFileHandle::insert_record(const Rid& rid, char* buf) {
     page_handle.page_hdr->num_records++;                                     // 4
     if (page_handle.page_hdr->num_records == file_hdr_.num_records_per_page) // page is full
         file_hdr_.first_free_page_no = page_handle.page_hdr->next_free_page_no;
-
-    PageId page_id = page_handle.page->get_page_id();
-    buffer_pool_manager_->unpin_page(page_id, true);
-    return;
+    page_handle.mark_dirty();
 }
 
 /**
@@ -131,10 +132,19 @@ void RmFileHandle::delete_record(const Rid& rid, Context* context) {
     Bitmap::reset(page_handle.bitmap, rid.slot_no);
 
     page_handle.page_hdr->num_records--;
+    page_handle.mark_dirty();
 
     if (page_handle.page_hdr->num_records == file_hdr_.num_records_per_page - 1) {
         release_page_handle(page_handle);
     }
+
+    // 页面中已经没有记录时把页面归还给磁盘，以便表文件在大量删除后复用或截断
+    bool page_empty = page_handle.page_hdr->num_records == 0;
+    int next_free_page_no = page_handle.page_hdr->next_free_page_no;
+    page_handle.guard.drop();  // 释放页面之前需要取消固定
+    if (page_empty) {
+        release_empty_page(rid.page_no, next_free_page_no);
+    }
     //printf("delete FIN\n");
 }
 
@@ -157,13 +167,14 @@ void RmFileHandle::update_record(const Rid& rid, char* buf, Context* context) {
 
     char* slot_data = page_handle.get_slot(rid.slot_no);
     memcpy(slot_data, buf, file_hdr_.record_size);
+    page_handle.mark_dirty();
 }
 
 /**
  * 以下函数为辅助函数，仅提供参考，可以选择完成如下函数，也可以删除如下函数，在单元测试中不涉及如下函数接口的直接调用
 */
 /**
- * @description: 获取指定页面的页面句柄
+ * @description: 获取指定页面的页面句柄，句柄持有页面的排他latch，用于修改页面
  * @param {int} page_no 页面号
  * @return {RmPageHandle} 指定页面的句柄
  */
@@ -173,11 +184,23 @@ RmPageHandle RmFileHandle::fetch_page_handle(int page_no) const {
     // if page_no is invalid, throw PageNotExistError exception
 
     std::string table_name = disk_manager_->get_file_name(fd_);
-    if (page_no < 0 || page_no >= file_hdr_.num_pages) {
+    if (page_no < 0 || page_no >= file_hdr_.num_pages || is_free_page(page_no)) {
         throw PageNotExistError(table_name,page_no);
     }
-    Page* page = buffer_pool_manager_->fetch_page((PageId){fd_,page_no});
-    return RmPageHandle(&file_hdr_, page);
+    return RmPageHandle(&file_hdr_, buffer_pool_manager_->fetch_page_write((PageId){fd_,page_no}));
+}
+
+/**
+ * @description: 获取指定页面的只读页面句柄，句柄持有页面的共享latch，多个读者可以同时读取同一个页面
+ * @param {int} page_no 页面号
+ * @param {BufferRing*} ring 顺序扫描使用的私有帧环，为空时使用整个缓冲池
+ * @return {RmPageHandle} 指定页面的句柄
+ */
+RmPageHandle RmFileHandle::fetch_read_page_handle(int page_no, BufferRing* ring) const {
+    if (page_no < 0 || page_no >= file_hdr_.num_pages || is_free_page(page_no)) {
+        throw PageNotExistError(disk_manager_->get_file_name(fd_), page_no);
+    }
+    return RmPageHandle(&file_hdr_, buffer_pool_manager_->fetch_page_read((PageId){fd_,page_no}, ring));
 }
 
 /**
@@ -191,10 +214,9 @@ RmPageHandle RmFileHandle::create_new_page_handle() {
     // 3.更新file_hdr_
     
     PageId page_id = (PageId){fd_,INVALID_PAGE_ID};
-    Page* page;
-    page = buffer_pool_manager_->new_page(&page_id);
+    WritePageGuard guard = buffer_pool_manager_->new_page_guarded(&page_id);
     int page_no = page_id.page_no;
-    file_hdr_.num_pages++;
+    file_hdr_.num_pages = std::max(file_hdr_.num_pages, page_no + 1);   // 可能复用了之前释放的页面
     //printf("create_new_page_handle_page_no %d %d\n",page_no,file_hdr_.num_pages);
 
     if(file_hdr_.first_free_page_no==-1){
@@ -203,16 +225,16 @@ RmPageHandle RmFileHandle::create_new_page_handle() {
     else {
         RmPageHandle firstFreePageHandle = fetch_page_handle(file_hdr_.first_free_page_no);
         firstFreePageHandle.page_hdr->next_free_page_no = page_no;
+        firstFreePageHandle.mark_dirty();
     }
     //std::printf("create_new_page_handle\n");
-    return RmPageHandle(&file_hdr_, page);
+    return RmPageHandle(&file_hdr_, std::move(guard));
 }
 
 /**
  * @brief 创建或获取一个空闲的page handle
  *
- * @return RmPageHandle 返回生成的空闲page handle
- * @note pin the page, remember to unpin it outside!
+ * @return RmPageHandle 返回生成的空闲page handle，持有页面的排他latch
  */
 RmPageHandle RmFileHandle::create_page_handle() {
     // Todo:
@@ -250,4 +272,38 @@ void RmFileHandle::release_page_handle(RmPageHandle&page_handle) {
         file_hdr_.first_free_page_no = page_handle.page->get_page_id().page_no;
         page_handle.page_hdr->next_free_page_no = oldFirstFreePage;
     }
+    page_handle.mark_dirty();
+}
+
+/**
+ * @description: 释放一个已经没有记录的页面，把它从空闲页面链表中摘除并交给DiskManager复用
+ *              页面仍被固定时(例如还有其他句柄在使用)不释放，保留为链表中的普通空闲页面
+ * @param {int} page_no 要释放的页面号
+ * @param {int} next_free_page_no 该页面在空闲页面链表中的后继
+ */
+void RmFileHandle::release_empty_page(int page_no, int next_free_page_no) {
+    if (!buffer_pool_manager_->deallocate_page({fd_, page_no})) {
+        return;
+    }
+
+    if (file_hdr_.first_free_page_no == page_no) {
+        file_hdr_.first_free_page_no = next_free_page_no;
+    } else {
+        // 在链表中找到前驱并跳过该页面，最多遍历num_pages个页面
+        int curr = file_hdr_.first_free_page_no;
+        for (int i = 0; curr != RM_NO_PAGE && i < file_hdr_.num_pages; i++) {
+            RmPageHandle page_handle = fetch_page_handle(curr);
+            int next = page_handle.page_hdr->next_free_page_no;
+            bool found = next == page_no;
+            if (found) {
+                page_handle.page_hdr->next_free_page_no = next_free_page_no;
+                page_handle.mark_dirty();
+                break;
+            }
+            curr = next;
+        }
+    }
+
+    // 文件末尾的空闲页面已经被截断
+    file_hdr_.num_pages = disk_manager_->get_fd2pageno(fd_);
 }
\ No newline at end of file
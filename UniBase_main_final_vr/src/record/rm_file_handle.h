@@ -2,6 +2,7 @@
 
 #include <assert.h>
 
+#include <algorithm>
 #include <memory>
 
 #include "bitmap.h"
@@ -10,20 +11,25 @@
 
 class RmManager;
 
-/* 对表数据文件中的页面进行封装 */
+/* 对表数据文件中的页面进行封装，句柄持有页面的guard，析构时释放页面latch并取消固定 */
 struct RmPageHandle {
     const RmFileHdr *file_hdr;  // 当前页面所在文件的文件头指针
     Page *page;                 // 页面的实际数据，包括页面存储的数据、元信息等
     RmPageHdr *page_hdr;        // page->data的第一部分，存储页面元信息，指针指向首地址，长度为sizeof(RmPageHdr)
     char *bitmap;               // page->data的第二部分，存储页面的bitmap，指针指向首地址，长度为file_hdr->bitmap_size
     char *slots;                // page->data的第三部分，存储表的记录，指针指向首地址，每个slot的长度为file_hdr->record_size
+    BasicPageGuard guard;       // 页面的固定和latch(读取时共享，修改时排他)
 
-    RmPageHandle(const RmFileHdr *fhdr_, Page *page_) : file_hdr(fhdr_), page(page_) {
+    RmPageHandle(const RmFileHdr *fhdr_, BasicPageGuard guard_)
+        : file_hdr(fhdr_), page(guard_.get_page()), guard(std::move(guard_)) {
         page_hdr = reinterpret_cast<RmPageHdr *>(page->get_data() + page->OFFSET_PAGE_HDR);
         bitmap = page->get_data() + sizeof(RmPageHdr) + page->OFFSET_PAGE_HDR;
         slots = bitmap + file_hdr->bitmap_size;
     }
 
+    // 修改了页面内容，释放句柄时写回标记为脏页
+    void mark_dirty() { guard.mark_dirty(); }
+
     // 返回指定slot_no的slot存储收地址
     char* get_slot(int slot_no) const {
         return slots + slot_no * file_hdr->record_size;  // slots的首地址 + slot个数 * 每个slot的大小(每个record的大小)
@@ -48,6 +54,11 @@ class RmFileHandle {
         // 这里实际就是初始化file_hdr，只不过是从磁盘中读出进行初始化
         // init file_hdr_
         disk_manager_->read_page(fd, RM_FILE_HDR_PAGE, (char *)&file_hdr_, sizeof(file_hdr_));
+        // 旧版本文件的页头位置不同，不能按当前格式读写
+        if (file_hdr_.magic != Page::FILE_MAGIC || file_hdr_.format_version != Page::FILE_FORMAT_VERSION) {
+            int version = file_hdr_.magic == Page::FILE_MAGIC ? file_hdr_.format_version : 1;
+            throw FileFormatError(disk_manager_->get_file_name(fd), version, Page::FILE_FORMAT_VERSION);
+        }
         // disk_manager管理的fd对应的文件中，设置从file_hdr_.num_pages开始分配page_no
         disk_manager_->set_fd2pageno(fd, file_hdr_.num_pages);
     }
@@ -57,12 +68,18 @@ class RmFileHandle {
 
     /* 判断指定位置上是否已经存在一条记录，通过Bitmap来判断 */
     bool is_record(const Rid &rid) const {
-        RmPageHandle page_handle = fetch_page_handle(rid.page_no);
+        if (is_free_page(rid.page_no)) return false;
+        RmPageHandle page_handle = fetch_read_page_handle(rid.page_no);
         return Bitmap::is_set(page_handle.bitmap, rid.slot_no);  // page的slot_no位置上是否有record
     }
 
+    /* 判断指定页面是否已经因为记录全部被删除而释放 */
+    bool is_free_page(int page_no) const { return disk_manager_->is_free_page(fd_, page_no); }
+
     std::unique_ptr<RmRecord> get_record(const Rid &rid, Context *context) const;
 
+    RmRecordView get_record_view(const Rid &rid, Context *context) const;
+
     Rid insert_record(char *buf, Context *context);
 
     void insert_record(const Rid &rid, char *buf);
@@ -75,8 +92,12 @@ class RmFileHandle {
 
     RmPageHandle fetch_page_handle(int page_no) const;
 
+    RmPageHandle fetch_read_page_handle(int page_no, BufferRing *ring = nullptr) const;
+
    private:
     RmPageHandle create_page_handle();
 
     void release_page_handle(RmPageHandle &page_handle);
+
+    void release_empty_page(int page_no, int next_free_page_no);
 };
\ No newline at end of file
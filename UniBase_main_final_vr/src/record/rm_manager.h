@@ -20,16 +20,19 @@ class RmManager {
      * @description: 创建表的数据文件并初始化相关信息
      * @param {string&} filename 要创建的文件名称
      * @param {int} record_size 表中记录的大小
+     * @param {bool} compressed 是否压缩存储，页面在写回时压缩、读入时解压
      */ 
-    void create_file(const std::string& filename, int record_size) {
+    void create_file(const std::string& filename, int record_size, bool compressed = false) {
         if (record_size < 1 || record_size > RM_MAX_RECORD_SIZE) {
             throw InvalidRecordSizeError(record_size);
         }
-        disk_manager_->create_file(filename);
+        disk_manager_->create_file(filename, compressed);
         int fd = disk_manager_->open_file(filename);
 
         // 初始化file header
         RmFileHdr file_hdr{};
+        file_hdr.magic = Page::FILE_MAGIC;
+        file_hdr.format_version = Page::FILE_FORMAT_VERSION;
         file_hdr.record_size = record_size;
         file_hdr.num_pages = 1;
         file_hdr.first_free_page_no = RM_NO_PAGE;
@@ -58,7 +61,13 @@ class RmManager {
      */
     std::unique_ptr<RmFileHandle> open_file(const std::string& filename) {
         int fd = disk_manager_->open_file(filename);
-        return std::make_unique<RmFileHandle>(disk_manager_, buffer_pool_manager_, fd);
+        disk_manager_->set_page_checksums(fd, true);
+        try {
+            return std::make_unique<RmFileHandle>(disk_manager_, buffer_pool_manager_, fd);
+        } catch (FileFormatError &) {
+            disk_manager_->close_file(fd);
+            throw;
+        }
     }
     /**
      * @description: 关闭表的数据文件
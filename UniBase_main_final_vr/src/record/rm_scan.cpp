@@ -1,23 +1,75 @@
 #include "rm_scan.h"
 #include "rm_file_handle.h"
 
+#include <algorithm>
+#include <cstring>
+
 /**
  * @brief 初始化file_handle和rid
+ *        表文件超过缓冲池的1/BUFFER_RING_THRESHOLD时通过私有的BufferRing读取，避免把其他页面挤出缓冲池
  * @param file_handle
  */
-RmScan::RmScan(const RmFileHandle *file_handle) : file_handle_(file_handle) {
+RmScan::RmScan(const RmFileHandle *file_handle) : file_handle_(file_handle), prefetch_end_(RM_FIRST_RECORD_PAGE) {
+    size_t pool_size = file_handle_->buffer_pool_manager_->get_pool_size();
+    if (static_cast<size_t>(file_handle_->file_hdr_.num_pages) > pool_size / BUFFER_RING_THRESHOLD) {
+        ring_ = std::make_unique<BufferRing>();
+    }
+    bitmap_.resize(file_handle_->file_hdr_.bitmap_size);
     rid_ = find_first_record();
 }
 
-Rid RmScan::find_first_record() const {
-    RmFileHandle file_hdr= *file_handle_;
-    for (int page_no = RM_FIRST_RECORD_PAGE; page_no < file_hdr.get_file_hdr().num_pages; page_no++) {
-        RmPageHandle page_handle = file_handle_->fetch_page_handle(page_no);
-        int num = page_handle.file_hdr->num_records_per_page;
-        for (int slot_no = 0; slot_no < num; slot_no++) {
-            if (file_handle_->is_record(Rid{page_no, slot_no})) {
-                return Rid{page_no, slot_no};
-            }
+/**
+ * @brief 进入页面：固定页面，复制bitmap后立即释放，页面通过ring_读取
+ * @return 页面已经被释放时返回false
+ */
+bool RmScan::load_page(int page_no) {
+    prefetch(page_no);
+    if (file_handle_->is_free_page(page_no)) return false;
+    RmPageHandle page_handle = file_handle_->fetch_read_page_handle(page_no, ring_.get());
+    memcpy(bitmap_.data(), page_handle.bitmap, bitmap_.size());
+    return true;
+}
+
+/**
+ * @brief 顺序预读：剩余的预读页面不足PREFETCH_PAGES / 2时，预读page_no之后的PREFETCH_PAGES个页面
+ *        已经释放的页面不预读，预读的页面同样放入ring_
+ */
+void RmScan::prefetch(int page_no) {
+    if (page_no + PREFETCH_PAGES / 2 < prefetch_end_) {
+        return;
+    }
+    int begin = std::max(prefetch_end_, page_no + 1);
+    int end = std::min(file_handle_->file_hdr_.num_pages, page_no + 1 + PREFETCH_PAGES);
+    std::vector<page_id_t> page_nos;
+    for (int p = begin; p < end; p++) {
+        if (!file_handle_->is_free_page(p)) {
+            page_nos.push_back(p);
+        }
+    }
+    prefetch_end_ = std::max(prefetch_end_, end);
+    if (!page_nos.empty()) {
+        file_handle_->buffer_pool_manager_->prefetch_pages(file_handle_->fd_, page_nos, ring_.get());
+    }
+}
+
+Rid RmScan::find_first_record() { return find_record(RM_FIRST_RECORD_PAGE, -1); }
+
+/**
+ * @brief 从page_no页的slot_no之后开始找第一条记录
+ *        slot_no为-1时从页面的开头开始找，需要先进入页面；否则bitmap_已经是page_no页的bitmap
+ * @return 没有找到时返回{-1, -1}
+ */
+Rid RmScan::find_record(int page_no, int slot_no) {
+    int num_pages = file_handle_->file_hdr_.num_pages;
+    int num = file_handle_->file_hdr_.num_records_per_page;
+    for (; page_no < num_pages; page_no++, slot_no = -1) {
+        // 已经释放的页面中没有记录，直接跳到下一个页面
+        if (slot_no < 0 && !load_page(page_no)) {
+            continue;
+        }
+        slot_no = Bitmap::next_bit(true, bitmap_.data(), num, slot_no);
+        if (slot_no < num) {
+            return Rid{page_no, slot_no};
         }
     }
     return (Rid){-1, -1};
@@ -27,31 +79,10 @@ Rid RmScan::find_first_record() const {
  * @brief 找到文件中下一个存放了记录的位置
  */
 void RmScan::next() {
-    // Todo:
     // 找到文件中下一个存放了记录的非空闲位置，用rid_来指向这个位置
-    while (rid_ != (Rid){-1,-1}) {
-        RmFileHandle file_hdr= *file_handle_;
-        int page_no = (file_hdr.get_file_hdr()).num_pages;
-        if (rid_.page_no < page_no) {
-            //printf("rid_page_no %d\n",rid_.page_no);
-            RmPageHandle page_handle = file_handle_->fetch_page_handle(rid_.page_no);
-            if (rid_.slot_no + 1 < page_handle.file_hdr->num_records_per_page) {
-                rid_.slot_no++;
-            } 
-            else {
-                rid_.page_no++;
-                rid_.slot_no = 0;
-            }
-        }
-        if(rid_.page_no == page_no) {
-            rid_ = (Rid){-1,-1}; 
-            break;
-        }
-        else if(file_handle_->is_record(rid_)) {
-            break;
-        }
+    if (rid_ != (Rid){-1,-1}) {
+        rid_ = find_record(rid_.page_no, rid_.slot_no);
     }
-    //printf("Next FIN\n");
 }
 
 /**
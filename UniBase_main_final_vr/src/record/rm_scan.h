@@ -1,12 +1,29 @@
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include "rm_defs.h"
 
 class RmFileHandle;
 
+/*
+RmScan按页面扫描表：进入一个页面时固定一次，把页面的bitmap复制到bitmap_后立即释放，
+之后在副本中找存放了记录的slot，同一个页面上的记录不再访问缓冲池
+扫描看到的是进入页面时的bitmap，之后在该页面上插入的记录可能看不到，删除的记录在get_record时报告RecordNotFoundError
+*/
 class RmScan : public RecScan {
     const RmFileHandle *file_handle_;
+    std::unique_ptr<BufferRing> ring_;  // 扫描大表时使用的私有帧环，小表为空
+    int prefetch_end_;                  // 编号小于prefetch_end_的页面已经提交过预读
+    std::vector<char> bitmap_;          // rid_所在页面的bitmap的副本
     Rid rid_;
+
+    bool load_page(int page_no);
+
+    Rid find_record(int page_no, int slot_no);
+
+    void prefetch(int page_no);
 public:
     RmScan(const RmFileHandle *file_handle);
 
@@ -16,5 +33,5 @@ public:
 
     Rid rid() const override;
 
-    Rid find_first_record() const ;
+    Rid find_first_record();
 };
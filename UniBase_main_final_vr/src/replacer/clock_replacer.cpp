@@ -0,0 +1,76 @@
+#include "clock_replacer.h"
+
+#include <cassert>
+
+ClockReplacer::ClockReplacer(size_t num_pages)
+    : num_frames_(num_pages), states_(new std::atomic<uint8_t>[num_pages]) {
+    for (size_t i = 0; i < num_frames_; i++) {
+        states_[i].store(ABSENT, std::memory_order_relaxed);
+    }
+}
+
+ClockReplacer::~ClockReplacer() = default;
+
+/**
+ * @description: 使用CLOCK策略删除一个victim frame，并返回该frame的id
+ *              时钟指针遇到访问位为1的帧时清除访问位，遇到访问位为0的帧时将其淘汰
+ * @param {frame_id_t*} frame_id 被移除的frame的id，如果没有frame被移除返回nullptr
+ * @return {bool} 如果成功淘汰了一个页面则返回true，否则返回false
+ */
+bool ClockReplacer::victim(frame_id_t* frame_id) {
+    // 指针转两圈之内一定能淘汰一个帧：第一圈清除所有访问位，第二圈淘汰
+    for (size_t step = 0; step <= 2 * num_frames_ && size_.load() > 0; step++) {
+        size_t pos = hand_.fetch_add(1, std::memory_order_relaxed) % num_frames_;
+        uint8_t state = states_[pos].load();
+        if (state == REFERENCED) {
+            states_[pos].compare_exchange_strong(state, UNREFERENCED);
+        } else if (state == UNREFERENCED && states_[pos].compare_exchange_strong(state, ABSENT)) {
+            size_--;
+            *frame_id = static_cast<frame_id_t>(pos);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @description: 固定指定的frame，即该页面无法被淘汰
+ * @param {frame_id_t} 需要固定的frame的id
+ */
+void ClockReplacer::pin(frame_id_t frame_id) {
+    assert(frame_id >= 0 && static_cast<size_t>(frame_id) < num_frames_);
+    if (states_[frame_id].exchange(ABSENT) != ABSENT) {
+        size_--;
+    }
+}
+
+/**
+ * @description: 取消固定一个frame，代表该页面可以被淘汰，同时设置访问位
+ * @param {frame_id_t} frame_id 取消固定的frame的id
+ */
+void ClockReplacer::unpin(frame_id_t frame_id) {
+    assert(frame_id >= 0 && static_cast<size_t>(frame_id) < num_frames_);
+    if (states_[frame_id].exchange(REFERENCED) == ABSENT) {
+        size_++;
+    }
+}
+
+/**
+ * @description: 扩大帧的取值范围，已有帧的状态保持不变，新增的帧不在replacer中
+ *              调用者需要保证此时没有其他线程访问replacer(缓冲池在持有分区锁时调用)
+ * @param {size_t} num_pages 新的帧数，不小于原来的帧数
+ */
+void ClockReplacer::resize(size_t num_pages) {
+    assert(num_pages >= num_frames_);
+    std::unique_ptr<std::atomic<uint8_t>[]> states(new std::atomic<uint8_t>[num_pages]);
+    for (size_t i = 0; i < num_pages; i++) {
+        states[i].store(i < num_frames_ ? states_[i].load() : ABSENT, std::memory_order_relaxed);
+    }
+    states_ = std::move(states);
+    num_frames_ = num_pages;
+}
+
+/**
+ * @description: 获取当前replacer中可以被淘汰的页面数量
+ */
+size_t ClockReplacer::Size() { return size_.load(); }
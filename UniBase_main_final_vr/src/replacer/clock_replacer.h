@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "common/config.h"
+#include "replacer/replacer.h"
+
+/*
+ClockReplacer实现了CLOCK(second-chance)替换策略
+每个帧只用一个原子变量记录状态，pin/unpin只需一次原子操作，不需要加锁
+*/
+class ClockReplacer : public Replacer {
+   public:
+    /**
+     * @description: 创建一个新的ClockReplacer
+     * @param {size_t} num_pages ClockReplacer最多需要存储的page数量，frame_id的取值范围为[0, num_pages)
+     */
+    explicit ClockReplacer(size_t num_pages);
+
+    ~ClockReplacer();
+
+    bool victim(frame_id_t *frame_id);
+
+    void pin(frame_id_t frame_id);
+
+    void unpin(frame_id_t frame_id);
+
+    size_t Size();
+
+    void resize(size_t num_pages);
+
+   private:
+    // 帧的状态
+    static constexpr uint8_t ABSENT = 0;        // 不在replacer中（被固定或者空闲）
+    static constexpr uint8_t UNREFERENCED = 1;  // 可以被淘汰，访问位为0
+    static constexpr uint8_t REFERENCED = 2;    // 可以被淘汰，访问位为1，时钟指针经过时先清除访问位
+
+    size_t num_frames_;                             // 最大容量（与缓冲池的容量相同）
+    std::unique_ptr<std::atomic<uint8_t>[]> states_;  // 每个帧的状态
+    std::atomic<size_t> hand_{0};                   // 时钟指针
+    std::atomic<size_t> size_{0};                   // 可以被淘汰的帧数
+};
@@ -0,0 +1,139 @@
+#include "lru_k_replacer.h"
+
+#include <cassert>
+
+LRUKReplacer::LRUKReplacer(size_t num_pages, size_t k) : k_(k), history_(num_pages), evictable_(num_pages, false) {
+    assert(k_ > 0);
+}
+
+LRUKReplacer::~LRUKReplacer() = default;
+
+/**
+ * @description: 使用LRU-K策略删除一个victim frame，并返回该frame的id，被淘汰帧的访问记录被清空
+ *              优先淘汰访问不足K次的帧（按最早一次访问），否则淘汰倒数第K次访问最早的帧
+ * @param {frame_id_t*} frame_id 被移除的frame的id，如果没有frame被移除返回nullptr
+ * @return {bool} 如果成功淘汰了一个页面则返回true，否则返回false
+ */
+bool LRUKReplacer::victim(frame_id_t* frame_id) {
+    std::scoped_lock lock{latch_};
+
+    std::set<Entry>& list = cold_.empty() ? hot_ : cold_;
+    if (list.empty()) {
+        return false;
+    }
+    *frame_id = list.begin()->second;
+    list.erase(list.begin());
+    evictable_[*frame_id] = false;
+    history_[*frame_id].clear();
+    return true;
+}
+
+/**
+ * @description: 固定指定的frame，即该页面无法被淘汰，访问记录保留
+ * @param {frame_id_t} 需要固定的frame的id
+ */
+void LRUKReplacer::pin(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+    assert(frame_id >= 0 && static_cast<size_t>(frame_id) < evictable_.size());
+
+    if (evictable_[frame_id]) {
+        list_of(frame_id).erase(entry_of(frame_id));
+        evictable_[frame_id] = false;
+    }
+}
+
+/**
+ * @description: 取消固定一个frame，代表该页面可以被淘汰
+ *              没有访问记录的帧（调用者没有使用record_access）把本次unpin记为一次访问
+ * @param {frame_id_t} frame_id 取消固定的frame的id
+ */
+void LRUKReplacer::unpin(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+    assert(frame_id >= 0 && static_cast<size_t>(frame_id) < evictable_.size());
+
+    if (evictable_[frame_id]) {
+        return;
+    }
+    if (history_[frame_id].empty()) {
+        access(frame_id);
+    }
+    evictable_[frame_id] = true;
+    list_of(frame_id).insert(entry_of(frame_id));
+}
+
+/**
+ * @description: 获取当前replacer中可以被淘汰的页面数量
+ */
+size_t LRUKReplacer::Size() {
+    std::scoped_lock lock{latch_};
+    return cold_.size() + hot_.size();
+}
+
+/**
+ * @description: 扩大帧的取值范围，已有帧的访问记录保持不变，新增的帧没有访问记录
+ * @param {size_t} num_pages 新的帧数，不小于原来的帧数
+ */
+void LRUKReplacer::resize(size_t num_pages) {
+    std::scoped_lock lock{latch_};
+    assert(num_pages >= evictable_.size());
+
+    history_.resize(num_pages);
+    evictable_.resize(num_pages, false);
+}
+
+/**
+ * @description: 记录一次对frame中页面的访问
+ * @param {frame_id_t} frame_id 被访问的frame的id
+ */
+void LRUKReplacer::record_access(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+    assert(frame_id >= 0 && static_cast<size_t>(frame_id) < evictable_.size());
+
+    if (evictable_[frame_id]) {
+        list_of(frame_id).erase(entry_of(frame_id));
+        access(frame_id);
+        list_of(frame_id).insert(entry_of(frame_id));
+    } else {
+        access(frame_id);
+    }
+}
+
+/**
+ * @description: 移除一个回到free_list的frame，并清空其访问记录
+ * @param {frame_id_t} frame_id 需要移除的frame的id
+ */
+void LRUKReplacer::remove(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+    assert(frame_id >= 0 && static_cast<size_t>(frame_id) < evictable_.size());
+
+    if (evictable_[frame_id]) {
+        list_of(frame_id).erase(entry_of(frame_id));
+        evictable_[frame_id] = false;
+    }
+    history_[frame_id].clear();
+}
+
+/**
+ * @description: 向frame的访问记录中追加当前时间戳，只保留最近k_次，调用者需要持有latch_
+ */
+void LRUKReplacer::access(frame_id_t frame_id) {
+    auto& history = history_[frame_id];
+    history.push_back(current_timestamp_++);
+    if (history.size() > k_) {
+        history.pop_front();
+    }
+}
+
+/**
+ * @description: frame在cold_/hot_中的排序键：访问不足k_次时为最早一次访问，否则为倒数第k_次访问，两者都是history的首部
+ */
+LRUKReplacer::Entry LRUKReplacer::entry_of(frame_id_t frame_id) const {
+    return {history_[frame_id].front(), frame_id};
+}
+
+/**
+ * @description: frame按访问次数所属的候选集合
+ */
+std::set<LRUKReplacer::Entry>& LRUKReplacer::list_of(frame_id_t frame_id) {
+    return history_[frame_id].size() < k_ ? cold_ : hot_;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+#include "replacer/replacer.h"
+
+/*
+LRUKReplacer实现了LRU-K替换策略
+每个帧记录最近K次访问的时间戳，淘汰backward K-distance最大的帧；访问不足K次的帧K-distance为无穷大，最先被淘汰
+只被顺序扫描访问过一次的页面因此会先于被反复访问的热点页面淘汰
+*/
+class LRUKReplacer : public Replacer {
+   public:
+    /**
+     * @description: 创建一个新的LRUKReplacer
+     * @param {size_t} num_pages LRUKReplacer最多需要存储的page数量，frame_id的取值范围为[0, num_pages)
+     * @param {size_t} k 每个帧记录的访问次数
+     */
+    LRUKReplacer(size_t num_pages, size_t k);
+
+    ~LRUKReplacer();
+
+    bool victim(frame_id_t *frame_id);
+
+    void pin(frame_id_t frame_id);
+
+    void unpin(frame_id_t frame_id);
+
+    size_t Size();
+
+    void resize(size_t num_pages);
+
+    void record_access(frame_id_t frame_id);
+
+    void remove(frame_id_t frame_id);
+
+   private:
+    using Entry = std::pair<uint64_t, frame_id_t>;  // <排序用的时间戳, frame id>
+
+    void access(frame_id_t frame_id);
+    Entry entry_of(frame_id_t frame_id) const;
+    std::set<Entry> &list_of(frame_id_t frame_id);
+
+    std::mutex latch_;                        // 互斥锁
+    size_t k_;                                // 每个帧记录的访问次数
+    uint64_t current_timestamp_ = 0;          // 逻辑时钟，每次访问加1
+    std::vector<std::deque<uint64_t>> history_;  // 每个帧最近k_次访问的时间戳，首部最早
+    std::vector<bool> evictable_;             // 帧是否可以被淘汰
+    std::set<Entry> cold_;  // 可淘汰且访问不足k_次的帧，按最早一次访问排序
+    std::set<Entry> hot_;   // 可淘汰且访问了k_次的帧，按倒数第k_次访问排序（K-distance从大到小）
+};
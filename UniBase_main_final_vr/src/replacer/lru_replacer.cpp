@@ -1,5 +1,7 @@
 #include "lru_replacer.h"
 
+#include <algorithm>
+
 LRUReplacer::LRUReplacer(size_t num_pages) { max_size_ = num_pages; }
 
 LRUReplacer::~LRUReplacer() = default;  
@@ -65,6 +67,15 @@ void LRUReplacer::unpin(frame_id_t frame_id) {
     }
 }
 
+/**
+ * @description: 扩大replacer的容量
+ * @param {size_t} num_pages 新的容量，不小于原来的容量
+ */
+void LRUReplacer::resize(size_t num_pages) {
+    std::scoped_lock lock{latch_};
+    max_size_ = std::max(max_size_, num_pages);
+}
+
 /**
  * @description: 获取当前replacer中可以被淘汰的页面数量
  */
@@ -29,6 +29,26 @@ class Replacer {
      */
     virtual void unpin(frame_id_t frame_id) = 0;
 
+    /**
+     * Records that the page held by a frame was requested by fetch_page or new_page.
+     * Policies that only look at pin state ignore it.
+     * @param frame_id the id of the accessed frame
+     */
+    virtual void record_access(frame_id_t frame_id) {}
+
+    /**
+     * Removes a frame that goes back to the free list, forgetting anything known about its old page.
+     * @param frame_id the id of the frame to remove
+     */
+    virtual void remove(frame_id_t frame_id) { pin(frame_id); }
+
+    /**
+     * Grows the range of frame ids to [0, num_pages) when the buffer pool adds frames.
+     * Frames that are already tracked keep their state; num_pages is never smaller than the current range.
+     * @param num_pages the new number of frames
+     */
+    virtual void resize(size_t num_pages) = 0;
+
     /** @return the number of elements in the replacer that can be victimized */
     virtual size_t Size() = 0;
 };
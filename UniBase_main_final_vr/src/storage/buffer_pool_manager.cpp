@@ -1,27 +1,142 @@
 #include "buffer_pool_manager.h"
 
+#include <cstdint>
+#include <new>
+
+#include "page_checksum.h"
+
+/**
+ * @description: 计算页面所属的分区
+ *              同一文件中相邻的WRITE_BACK_RUN_PAGES个页面属于同一个分区，便于淘汰时合并写回相邻的脏页
+ * @return {Shard&} 页面所属的分区
+ * @param {PageId} page_id 目标页的PageId
+ */
+BufferPoolManager::Shard& BufferPoolManager::shard_of(PageId page_id) {
+    uint64_t key = (static_cast<uint64_t>(page_id.fd) << 32) |
+                   static_cast<uint32_t>(page_id.page_no / WRITE_BACK_RUN_PAGES);
+    key *= 0x9E3779B97F4A7C15ULL;
+    return *shards_[(key >> 32) % shards_.size()];
+}
+
+/**
+ * @description: 向缓冲池添加num_frames个新的帧，平均分配到各个分区并加入free_list
+ *              新的帧描述符和页面数据单独分配一段，已有帧的地址和编号不变；arena的内存已经由内核清零，不需要逐页memset
+ * @param {size_t} num_frames 新增的帧数
+ */
+void BufferPoolManager::add_frames(size_t num_frames) {
+    if (num_frames == 0) {
+        return;
+    }
+    std::unique_ptr<Page[]> pages(new Page[num_frames]);
+    auto arena = std::make_unique<FrameArena>(num_frames * PAGE_SIZE);
+    size_t num_shards = shards_.size();
+    size_t next = 0;
+    for (size_t i = 0; i < num_shards; ++i) {
+        Shard& shard = *shards_[i];
+        size_t count = num_frames / num_shards + (i < num_frames % num_shards ? 1 : 0);
+        std::scoped_lock lock{shard.latch};
+        for (size_t j = 0; j < count; ++j, ++next) {
+            Page* page = &pages[next];
+            page->data_ = arena->data() + next * PAGE_SIZE;
+            page->frame_id_ = static_cast<frame_id_t>(shard.frames.size());
+            shard.frames.push_back(page);
+            shard.free_list.push_back(page->frame_id_);
+        }
+        shard.num_frames += count;
+        shard.replacer->resize(shard.frames.size());
+        grow_page_table(shard);
+    }
+    descriptors_.push_back(std::move(pages));
+    arenas_.push_back(std::move(arena));
+    pool_size_ += num_frames;
+}
+
 /**
- * @description: 从free_list或replacer中得到可淘汰帧页的 *frame_id
+ * @description: 保证分区页表的容量不小于帧数的两倍，否则换用新的页表，调用者需要持有shard.latch(构造时除外)
+ *              旧页表中的页面复制到新页表后再发布；正在旧页表上无锁查找的线程得到的结果仍然会被校验，旧页表保留到析构
+ */
+void BufferPoolManager::grow_page_table(Shard& shard) {
+    PageTable* old_table = shard.page_table.load(std::memory_order_relaxed);
+    size_t capacity = 16;
+    while (capacity < shard.frames.size() * 2) {
+        capacity <<= 1;
+    }
+    if (old_table != nullptr && old_table->capacity() >= capacity) {
+        return;
+    }
+    auto table = std::make_unique<PageTable>(capacity);
+    if (old_table != nullptr) {
+        old_table->for_each([&](Page* page) { table->insert(page->get_page_id(), page); });
+    }
+    shard.page_table.store(table.get(), std::memory_order_release);
+    shard.page_tables.push_back(std::move(table));
+}
+
+/**
+ * @description: 不加分区锁固定缓冲池中的页面：无锁查找页表，再用CAS递增帧的pin_count_
+ *              pin_count_为负(帧空闲或正在被淘汰)、帧上正在进行I/O或者帧中是其他页面时放弃，由调用者加锁查找
+ *              检查和CAS之间帧可能被淘汰后分配给了其他页面，因此固定之后再校验一次，固定期间帧中的页面不会改变
+ * @return {Page*} 固定成功时返回页面，否则返回nullptr
+ * @param {Shard&} shard page_id所在的分区
+ * @param {PageId} page_id 目标页
+ */
+Page* BufferPoolManager::try_pin_page(Shard& shard, PageId page_id) {
+    Page* page = shard.page_table.load(std::memory_order_acquire)->find(page_id);
+    if (page == nullptr) {
+        return nullptr;
+    }
+    int pin_count = page->pin_count_.load(std::memory_order_acquire);
+    do {
+        if (pin_count < 0 || page->io_in_progress_ || !(page->get_page_id() == page_id)) {
+            return nullptr;
+        }
+    } while (!page->pin_count_.compare_exchange_weak(pin_count, pin_count + 1, std::memory_order_acq_rel));
+
+    if (page->io_in_progress_ || !(page->get_page_id() == page_id)) {
+        std::scoped_lock lock{shard.latch};
+        unpin_frame(shard, page);
+        return nullptr;
+    }
+    page->referenced_.store(true, std::memory_order_relaxed);
+    return page;
+}
+
+/**
+ * @description: 占有一个未被固定的帧：pin_count_从0改为NOT_RESIDENT，之后无锁固定不会成功，调用者需要持有shard.latch
+ * @return {bool} 帧已经被其他线程无锁固定时返回false
+ */
+bool BufferPoolManager::claim_frame(Page* page) {
+    int expected = 0;
+    return page->pin_count_.compare_exchange_strong(expected, Page::NOT_RESIDENT, std::memory_order_acq_rel);
+}
+
+/**
+ * @description: 从free_list或replacer中得到可淘汰帧页的 *frame_id，调用者需要持有shard.latch
  * @return {bool} true: 可替换帧查找成功 , false: 可替换帧查找失败
+ * @param {Shard&} shard 在该分区中查找
  * @param {frame_id_t*} frame_id 帧页id指针,返回成功找到的可替换帧id
  */
-bool BufferPoolManager::find_victim_page(frame_id_t* frame_id) {
-    // Todo:
-    // 1 使用BufferPoolManager::free_list_判断缓冲池是否已满需要淘汰页面
+bool BufferPoolManager::find_victim_page(Shard& shard, frame_id_t* frame_id) {
+    // 1 使用free_list判断分区是否已满需要淘汰页面
     // 1.1 未满获得frame
-    // 1.2 已满使用lru_replacer中的方法选择淘汰页面
+    // 1.2 已满使用replacer中的方法选择淘汰页面
 
-    if (!free_list_.empty()) {
-        // 缓冲池还有空闲帧，直接从空闲帧中选择一个作为淘汰页
-        *frame_id = free_list_.front();
-        free_list_.pop_front();
+    if (!shard.free_list.empty()) {
+        // 分区还有空闲帧，直接从空闲帧中选择一个作为淘汰页
+        *frame_id = shard.free_list.front();
+        shard.free_list.pop_front();
         return true;
     }
 
-    // 缓冲池已满，通过置换策略选择一个淘汰页
-    if (replacer_->victim(frame_id)) {
-        PageId page_id = pages_[*frame_id].get_page_id();
-        page_table_.erase(page_id);  // 从页表中移除淘汰页
+    // 分区已满，通过置换策略选择一个淘汰页
+    // 选中的帧可能刚被其他线程无锁固定，此时跳过；它已经离开replacer，取消固定到0时会重新加入
+    while (shard.replacer->victim(frame_id)) {
+        Page* page = shard.frames[*frame_id];
+        if (!claim_frame(page)) {
+            continue;
+        }
+        stats_.add(BUFFER_EVICTION);
+        shard.page_table.load(std::memory_order_relaxed)->erase(page->get_page_id());  // 从页表中移除淘汰页
         return true;
     }
 
@@ -29,86 +144,309 @@ bool BufferPoolManager::find_victim_page(frame_id_t* frame_id) {
 }
 
 /**
- * @description: 更新页面数据, 如果为脏页则需写入磁盘，再更新为新页面，更新page元数据(data, is_dirty, page_id)和page table
- * @param {Page*} page 写回页指针
- * @param {PageId} new_page_id 新的page_id
- * @param {frame_id_t} new_frame_id 新的帧frame_id
+ * @description: 从ring中取出一个属于本分区、仍然存放着ring读入的页面且没有被固定的帧，淘汰其中的页面
+ *              按读入的先后顺序查找，找到的帧从ring中移除，调用者需要持有shard.latch
+ * @return {bool} true: 找到可复用的帧, false: ring中没有可复用的帧
+ * @param {Shard&} shard 在该分区中查找
+ * @param {BufferRing&} ring 调用者私有的帧环
+ * @param {frame_id_t*} frame_id 返回可复用的帧id
+ */
+bool BufferPoolManager::reuse_ring_frame(Shard& shard, BufferRing& ring, frame_id_t* frame_id) {
+    for (auto it = ring.slots_.begin(); it != ring.slots_.end(); ++it) {
+        Page* page = it->page;
+        if (static_cast<size_t>(page->frame_id_) >= shard.frames.size() || shard.frames[page->frame_id_] != page) {
+            continue;  // 其他分区的帧
+        }
+        PageTable* table = shard.page_table.load(std::memory_order_relaxed);
+        if (page->io_in_progress_ || !(page->get_page_id() == it->page_id) || table->find(it->page_id) != page ||
+            !claim_frame(page)) {
+            continue;
+        }
+        *frame_id = page->frame_id_;
+        shard.replacer->remove(*frame_id);
+        table->erase(it->page_id);
+        ring.slots_.erase(it);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @description: 固定分区内的帧，调用者需要持有shard.latch
  */
-void BufferPoolManager::update_page(Page *page, PageId new_page_id, frame_id_t new_frame_id) {
-    // Todo:
-    // 1 如果是脏页，写回磁盘，并且把dirty置为false
-    // 2 更新page table
-    // 3 重置page的data，更新page id
+void BufferPoolManager::pin_frame(Shard& shard, frame_id_t frame_id) {
+    shard.replacer->pin(frame_id);
+    shard.frames[frame_id]->pin_count_.fetch_add(1, std::memory_order_acq_rel);
+}
 
-    if (page->is_dirty()) {
-        // 如果是脏页，将其写回磁盘
-        disk_manager_->write_page(page->get_page_id().fd, page->get_page_id().page_no, page->get_data(), PAGE_SIZE);
-        page->is_dirty_ = false;
+/**
+ * @description: 取消固定分区内的页面，pin_count_减为0时交给replacer，调用者需要持有shard.latch
+ *              期间无锁固定过页面时，先把这次访问记录到replacer
+ */
+void BufferPoolManager::unpin_frame(Shard& shard, Page* page) {
+    if (page->pin_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        if (page->referenced_.exchange(false, std::memory_order_relaxed)) {
+            shard.replacer->record_access(page->frame_id_);
+            shard.replacer->pin(page->frame_id_);
+        }
+        shard.replacer->unpin(page->frame_id_);
     }
-    page->pin_count_ = 0;
+}
 
-    // 更新页表
-    page_table_.erase(page->get_page_id());
-    page_table_[new_page_id] = new_frame_id;
+/**
+ * @description: 为即将被淘汰的脏页准备写回，把编号相邻、未被固定的脏页一起加入写回的页面中，最多WRITE_BACK_RUN_PAGES个
+ *              相邻的页面在写回期间被固定，防止被淘汰；所有页面的脏页标记被清除，写回期间被修改的页面会在unpin时重新标记
+ *              页面内容在这里复制到run.data，相邻的页面复制时持有页面共享latch，之后的写回不需要页面latch
+ *              调用者需要持有shard.latch，victim已经从页表中移除
+ * @return {WriteBackRun} 需要写回的页面，victim不是脏页时pages为空
+ * @param {Shard&} shard victim所在的分区
+ * @param {Page*} victim 被淘汰的页面
+ */
+BufferPoolManager::WriteBackRun BufferPoolManager::prepare_write_back(Shard& shard, Page* victim) {
+    WriteBackRun run;
+    if (!victim->is_dirty()) {
+        return run;
+    }
+    PageId victim_id = victim->get_page_id();
+    auto candidate = [&](page_id_t page_no) -> Page* {
+        Page* page = shard.page_table.load(std::memory_order_relaxed)->find(PageId{victim_id.fd, page_no});
+        if (page == nullptr) return nullptr;
+        return page->is_dirty() && page->pin_count_ == 0 && !page->io_in_progress_ ? page : nullptr;
+    };
 
-    // 重置页面数据并更新页面ID
-    page->reset_memory();
-    page->id_ = new_page_id;
+    std::vector<Page*> before;
+    std::vector<Page*> after;
+    int budget = WRITE_BACK_RUN_PAGES - 1;
+    for (page_id_t page_no = victim_id.page_no + 1; budget > 0; page_no++, budget--) {
+        Page* page = candidate(page_no);
+        if (page == nullptr) break;
+        after.push_back(page);
+    }
+    for (page_id_t page_no = victim_id.page_no - 1; budget > 0 && page_no >= 0; page_no--, budget--) {
+        Page* page = candidate(page_no);
+        if (page == nullptr) break;
+        before.push_back(page);
+    }
+
+    // 相邻的页面只尝试加共享latch，失败时run在这一页截断：持有排他latch的线程可能正在等待victim的写回完成
+    // victim已经从页表中移除并且未被固定，没有线程持有它的latch
+    run.data = alloc_page_copies(before.size() + 1 + after.size());
+    char* victim_copy = run.data.get() + before.size() * PAGE_SIZE;
+    auto copy_page = [](Page* page, char* dest) {
+        if (!page->latch_.try_lock_shared()) {
+            return false;
+        }
+        memcpy(dest, page->get_data(), PAGE_SIZE);
+        page->latch_.unlock_shared();
+        return true;
+    };
+    memcpy(victim_copy, victim->get_data(), PAGE_SIZE);
+    size_t num_after = 0;
+    while (num_after < after.size() && copy_page(after[num_after], victim_copy + (num_after + 1) * PAGE_SIZE)) {
+        num_after++;
+    }
+    after.resize(num_after);
+    size_t num_before = 0;
+    while (num_before < before.size() && copy_page(before[num_before], victim_copy - (num_before + 1) * PAGE_SIZE)) {
+        num_before++;
+    }
+    size_t skipped = before.size() - num_before;
+    before.resize(num_before);
+    if (skipped > 0) {
+        memmove(run.data.get(), run.data.get() + skipped * PAGE_SIZE, (num_before + 1 + num_after) * PAGE_SIZE);
+    }
+
+    run.pages.assign(before.rbegin(), before.rend());
+    run.pages.push_back(victim);
+    run.pages.insert(run.pages.end(), after.begin(), after.end());
+    for (Page* page : run.pages) {
+        if (page != victim) pin_frame(shard, page->frame_id_);
+        page->is_dirty_ = false;
+    }
+    run.fd = victim_id.fd;
+    run.first_page_no = run.pages.front()->get_page_id().page_no;
+    run.victim = victim;
+    run.victim_id = victim_id;
+    shard.writing.insert(victim_id);
+    return run;
 }
 
 /**
- * @description: 从buffer pool获取需要的页。
- *              如果页表中存在page_id（说明该page在缓冲池中），并且pin_count++。
- *              如果页表不存在page_id（说明该page在磁盘中），则找缓冲池victim page，将其替换为磁盘中读取的page，pin_count置1。
- * @return {Page*} 若获得了需要的页则将其返回，否则返回nullptr
- * @param {PageId} page_id 需要获取的页的PageId
+ * @description: 写回完成后取消固定相邻的页面，并允许被淘汰的页面重新读入，调用者需要持有shard.latch
+ * @param {bool} succeeded 写回是否成功，失败时恢复相邻页面的脏页标记
  */
-Page* BufferPoolManager::fetch_page(PageId page_id) {
-    //Todo:
-    // 1.     从page_table_中搜寻目标页
-    // 1.1    若目标页有被page_table_记录，则将其所在frame固定(pin)，并返回目标页。
-    // 1.2    否则，尝试调用find_victim_page获得一个可用的frame，若失败则返回nullptr
-    // 2.     若获得的可用frame存储的为dirty page，则须调用updata_page将page写回到磁盘
-    // 3.     调用disk_manager_的read_page读取目标页到frame
-    // 4.     固定目标页，更新pin_count_
-    // 5.     返回目标页
-
-    std::scoped_lock lock{latch_};
-    
-    // 检查页面是否已经在内存中
-    auto it = page_table_.find(page_id);
-    if (it != page_table_.end()) {
-        frame_id_t frame_id = it->second;
-        Page* page = &pages_[frame_id];
-        replacer_->pin(frame_id);  // 在使用页面之前将其固定
-        pages_[frame_id].pin_count_++;
-        return page;
+void BufferPoolManager::finish_write_back(Shard& shard, WriteBackRun& run, bool succeeded) {
+    if (run.pages.empty()) {
+        return;
+    }
+    for (Page* page : run.pages) {
+        if (page == run.victim) continue;
+        if (!succeeded) page->is_dirty_ = true;
+        unpin_frame(shard, page);
     }
+    shard.writing.erase(run.victim_id);
+    run.pages.clear();
+    run.data.reset();
+}
 
-    // 页面不在内存中，需要从磁盘读取并放入缓冲池
+/**
+ * @description: 为page_id分配一个帧：淘汰帧中原来的页面并准备写回，帧以io_in_progress_状态、pin_count_为1加入页表
+ *              pin_count_最后设置，无锁查找在此之前看到新页面时不会固定该帧
+ *              调用者需要持有shard.latch，之后在释放分区锁的情况下完成写回和读入
+ * @return {Page*} 分配给page_id的帧，找不到可用的帧时返回nullptr
+ * @param {Shard&} shard page_id所在的分区
+ * @param {PageId} page_id 目标页
+ * @param {BufferRing*} ring 不为空时优先复用ring中的帧，并把使用的帧加入ring；ring已满时替换其中最早的帧
+ * @param {WriteBackRun*} run 返回帧中原来的脏页需要的写回
+ */
+Page* BufferPoolManager::reserve_frame(Shard& shard, PageId page_id, BufferRing* ring, WriteBackRun* run) {
     frame_id_t frame_id;
-    if (!find_victim_page(&frame_id)) {
+    bool from_ring = ring != nullptr && reuse_ring_frame(shard, *ring, &frame_id);
+    if (!from_ring && !find_victim_page(shard, &frame_id)) {
         return nullptr;  // 找不到可用的帧页
     }
-
-    Page* page = &pages_[frame_id];
-    // 2.     若获得的可用frame存储的为dirty page，则须调用updata_page将page写回到磁盘
-    if (page->is_dirty()) {
-        update_page(page, page_id, frame_id);
+    Page* page = shard.frames[frame_id];
+    if (ring != nullptr) {
+        if (ring->slots_.size() >= ring->capacity_) {
+            ring->slots_.pop_front();  // 最早的帧还给缓冲池，按普通页面淘汰
+        }
+        ring->slots_.push_back({page, page_id});
     }
+    *run = prepare_write_back(shard, page);
+
+    page->id_.store(page_id, std::memory_order_release);
+    page->is_dirty_ = false;
+    page->io_in_progress_ = true;
+    shard.replacer->pin(frame_id);
+    shard.page_table.load(std::memory_order_relaxed)->insert(page_id, page);
+    page->pin_count_.store(1, std::memory_order_release);
+    return page;
+}
 
-    // 从磁盘读取目标页到缓冲池
-    disk_manager_->read_page(page_id.fd, page_id.page_no, page->get_data(), PAGE_SIZE); //?
+/**
+ * @description: 放弃一个I/O失败的帧：从页表中移除并放回free_list，调用者需要持有shard.latch
+ *              帧同时被其他线程无锁固定时(该线程校验失败后会马上取消固定)，帧留在replacer中，之后按普通帧淘汰
+ */
+void BufferPoolManager::discard_frame(Shard& shard, Page* page) {
+    frame_id_t frame_id = page->frame_id_;
+    PageId page_id = page->get_page_id();
+    shard.page_table.load(std::memory_order_relaxed)->erase(page_id);
+    page->id_.store(PageId{page_id.fd, INVALID_PAGE_ID}, std::memory_order_release);
+    page->io_in_progress_ = false;
+    if (page->pin_count_.fetch_sub(1, std::memory_order_acq_rel) == 1 && claim_frame(page)) {
+        shard.replacer->remove(frame_id);
+        shard.free_list.push_back(frame_id);
+    }
+}
 
-    page_table_[page_id] = frame_id;
-    page->id_ = page_id;
+/**
+ * @description: 把淘汰得到的帧分配给page_id：写回帧中原来的脏页，再从磁盘读入page_id或者清零作为新页面
+ *              帧先以io_in_progress_状态加入页表，磁盘I/O在释放分区锁之后进行，其他线程访问该页面时等待I/O完成
+ * @return {Page*} 已经固定的目标页，找不到可用的帧时返回nullptr
+ * @param {Shard&} shard page_id所在的分区
+ * @param {unique_lock&} lock 已经持有的shard.latch，返回时仍然持有
+ * @param {PageId} page_id 目标页
+ * @param {bool} read_from_disk true: 从磁盘读入页面内容；false: 新页面，内容清零并标记为脏页
+ * @param {BufferRing*} ring 不为空时优先复用ring中的帧，并把使用的帧加入ring
+ */
+Page* BufferPoolManager::load_frame(Shard& shard, std::unique_lock<std::mutex>& lock, PageId page_id,
+                                    bool read_from_disk, BufferRing* ring) {
+    WriteBackRun run;
+    Page* page = reserve_frame(shard, page_id, ring, &run);
+    if (page == nullptr) {
+        return nullptr;
+    }
+    shard.replacer->record_access(page->frame_id_);
+    lock.unlock();
 
-    replacer_->pin(frame_id);
-    page->pin_count_=1;
+    bool written = false;
+    try {
+        if (!run.pages.empty()) {
+            write_page_copies(run.fd, run.first_page_no, run.data.get(), run.pages.size());
+            stats_.add(BUFFER_FOREGROUND_WRITE, run.pages.size());
+            cleaner_cv_.notify_one();  // 请求线程不得不写回脏页，说明清理线程需要加快
+        }
+        written = true;
+        if (read_from_disk) {
+            disk_manager_->read_page(page_id.fd, page_id.page_no, page->get_data(), PAGE_SIZE);
+            if (!page_checksum_ok(page_id, page->get_data())) {
+                throw PageChecksumError(page_id.fd, page_id.page_no);
+            }
+        } else {
+            // 新页面可能复用了之前释放的页面编号，磁盘上还是旧数据，因此清零并标记为脏页
+            page->reset_memory();
+        }
+    } catch (...) {
+        lock.lock();
+        finish_write_back(shard, run, written);
+        discard_frame(shard, page);
+        shard.io_cv.notify_all();
+        throw;
+    }
 
+    lock.lock();
+    finish_write_back(shard, run, true);
+    page->is_dirty_ = !read_from_disk;
+    page->io_in_progress_ = false;
+    shard.io_cv.notify_all();
     return page;
 }
 
+/**
+ * @description: 从buffer pool获取需要的页。
+ *              如果页表中存在page_id（说明该page在缓冲池中），并且pin_count++。
+ *              如果页表不存在page_id（说明该page在磁盘中），则找缓冲池victim page，将其替换为磁盘中读取的page，pin_count置1。
+ * @return {Page*} 若获得了需要的页则将其返回，否则返回nullptr
+ * @param {PageId} page_id 需要获取的页的PageId
+ * @param {BufferRing*} ring 大批量顺序读取时使用的私有帧环，页面不在缓冲池中时在ring中读入，为空时使用整个缓冲池
+ */
+Page* BufferPoolManager::fetch_page(PageId page_id, BufferRing* ring) {
+    // 0.     先不加分区锁查找并固定目标页，命中时直接返回
+    // 1.     从page_id所在分区的页表中搜寻目标页
+    // 1.1    若目标页有被页表记录，则等待其上的I/O完成后将其所在frame固定(pin)，并返回目标页。
+    // 1.2    若目标页刚被淘汰、正在写回，则等待写回完成后重新查找
+    // 2.     否则调用load_frame获得一个可用的frame并从磁盘读入目标页，磁盘I/O时不持有分区锁
+    // 2.1    若所有帧都被正在进行的预读占用，则等待预读完成后重新查找
+
+    Shard& shard = shard_of(page_id);
+    if (Page* page = try_pin_page(shard, page_id); page != nullptr) {
+        stats_.add(BUFFER_HIT);
+        return page;
+    }
+    std::unique_lock lock{shard.latch};
+
+    while (true) {
+        Page* page = shard.page_table.load(std::memory_order_relaxed)->find(page_id);
+        if (page != nullptr) {
+            if (page->io_in_progress_) {
+                stats_.add(BUFFER_PIN_WAIT);
+                shard.io_cv.wait(lock);
+                continue;
+            }
+            pin_frame(shard, page->frame_id_);  // 在使用页面之前将其固定
+            shard.replacer->record_access(page->frame_id_);
+            stats_.add(BUFFER_HIT);
+            return page;
+        }
+        if (shard.writing.count(page_id) != 0) {
+            stats_.add(BUFFER_PIN_WAIT);
+            shard.io_cv.wait(lock);
+            continue;
+        }
+
+        // 页面不在内存中，需要从磁盘读取并放入缓冲池
+        page = load_frame(shard, lock, page_id, true, ring);
+        if (page != nullptr) {
+            stats_.add(BUFFER_MISS);
+        }
+        if (page != nullptr || shard.prefetching == 0) {
+            return page;
+        }
+        stats_.add(BUFFER_PIN_WAIT);
+        shard.io_cv.wait(lock);
+    }
+}
+
 /**
  * @description: 取消固定pin_count>0的在缓冲池中的page
  * @return {bool} 如果目标页的pin_count<=0则返回false，否则返回true
@@ -116,9 +454,8 @@ Page* BufferPoolManager::fetch_page(PageId page_id) {
  * @param {bool} is_dirty 若目标page应该被标记为dirty则为true，否则为false
  */
 bool BufferPoolManager::unpin_page(PageId page_id, bool is_dirty) {
-    // Todo:
-    // 0. lock latch
-    // 1. 尝试在page_table_中搜寻page_id对应的页P
+    // 0. 调用者持有固定，pin_count_大于1时不加锁自减；否则lock 分区的latch
+    // 1. 尝试在分区的页表中搜寻page_id对应的页P
     // 1.1 P在页表中不存在 return false
     // 1.2 P在页表中存在，获取其pin_count_
     // 2.1 若pin_count_已经等于0，则返回false
@@ -126,68 +463,90 @@ bool BufferPoolManager::unpin_page(PageId page_id, bool is_dirty) {
     // 2.2.1 若自减后等于0，则调用replacer_的Unpin
     // 3 根据参数is_dirty，更改P的is_dirty_
 
-    std::scoped_lock lock{latch_};
+    Shard& shard = shard_of(page_id);
+    Page* page = shard.page_table.load(std::memory_order_acquire)->find(page_id);
+    if (page != nullptr && page->get_page_id() == page_id) {
+        int pin_count = page->pin_count_.load(std::memory_order_acquire);
+        while (pin_count > 1) {
+            if (is_dirty) {
+                page->is_dirty_ = true;  // 在放弃固定之前标记，写回时一定能看到
+            }
+            if (page->pin_count_.compare_exchange_weak(pin_count, pin_count - 1, std::memory_order_acq_rel)) {
+                return true;
+            }
+        }
+    }
+
+    // pin_count_将减为0，需要交给replacer
+    std::scoped_lock lock{shard.latch};
 
     // 检查页面是否在内存中
-    auto it = page_table_.find(page_id);
-    if (it == page_table_.end()) {
+    page = shard.page_table.load(std::memory_order_relaxed)->find(page_id);
+    if (page == nullptr) {
         return false;  // 页面不在内存中
     }
 
-    frame_id_t frame_id = it->second;
-    Page* page = &pages_[frame_id];
-
     // 检查pin_count
-    if (page->pin_count_ == 0) {
+    if (page->pin_count_ <= 0) {
         return false;  // pin_count已经为0，无法取消固定
     }
 
-    // 减少pin_count
-    page->pin_count_--;
-    if (page->pin_count_ == 0) {
-        replacer_->unpin(frame_id);
-    }
-
     // 根据参数更新is_dirty
-    if(is_dirty){
+    if (is_dirty) {
         page->is_dirty_ = true;
     }
 
+    // 减少pin_count
+    unpin_frame(shard, page);
+
     return true;
 }
 
 /**
  * @description: 将目标页写回磁盘，不考虑当前页面是否正在被使用
- * @return {bool} 成功则返回true，否则返回false(只有page_table_中没有目标页时)
+ *              写回期间页面被临时固定，磁盘I/O时不持有分区锁
+ * @return {bool} 成功则返回true，否则返回false(只有页表中没有目标页时)
  * @param {PageId} page_id 目标页的page_id，不能为INVALID_PAGE_ID
  */
 bool BufferPoolManager::flush_page(PageId page_id) {
-    // Todo:
-    // 0. lock latch
     // 1. 查找页表,尝试获取目标页P
-    // 1.1 目标页P没有被page_table_记录 ，返回false
+    // 1.1 目标页P没有被页表记录 ，返回false
     // 2. 无论P是否为脏都将其写回磁盘。
     // 3. 更新P的is_dirty_
-   
-    std::scoped_lock lock{latch_};
 
-    // 1. 在页表中查找目标页
-    auto it = page_table_.find(page_id);
-    if (it == page_table_.end() || page_id.page_no == INVALID_PAGE_ID) {
-        // 1.1 目标页不在页表中，返回false
+    if (page_id.page_no == INVALID_PAGE_ID) {
         return false;
     }
+    Shard& shard = shard_of(page_id);
+    std::unique_lock lock{shard.latch};
 
-    // 2. 获取目标页P
-    frame_id_t frame_id = it->second;
-    Page* page = &pages_[frame_id];
-
-    // 2. 无论P是否为脏页，都将其写回磁盘
-    disk_manager_->write_page(page_id.fd, page_id.page_no, page->get_data(), PAGE_SIZE);
-
-    // 3. 更新P的is_dirty_标志
+    Page* page = nullptr;
+    while (true) {
+        page = shard.page_table.load(std::memory_order_relaxed)->find(page_id);
+        if (page == nullptr) {
+            return false;
+        }
+        if (!page->io_in_progress_) {
+            pin_frame(shard, page->frame_id_);
+            break;
+        }
+        shard.io_cv.wait(lock);
+    }
     page->is_dirty_ = false;
+    lock.unlock();
+
+    // write_page_run持有共享latch复制页面，避免写入正在被修改的页面；调用者不能持有该页面的WritePageGuard
+    try {
+        write_page_run(page_id.fd, page_id.page_no, {page});
+    } catch (...) {
+        lock.lock();
+        page->is_dirty_ = true;
+        unpin_frame(shard, page);
+        throw;
+    }
 
+    lock.lock();
+    unpin_frame(shard, page);
     return true;
 }
 
@@ -197,38 +556,69 @@ bool BufferPoolManager::flush_page(PageId page_id) {
  * @param {PageId*} page_id 当成功创建一个新的page时存储其page_id
  */
 Page* BufferPoolManager::new_page(PageId* page_id) {
-    // 1.   获得一个可用的frame，若无法获得则返回nullptr
-    // 2.   在fd对应的文件分配一个新的page_id
-    // 3.   将frame的数据写回磁盘
+    // 1.   在fd对应的文件分配一个新的page_id，由此确定所在的分区
+    // 2.   获得一个可用的frame，若无法获得则归还分配的页面编号并返回nullptr
+    // 3.   将frame的数据写回磁盘，清零frame
     // 4.   固定frame，更新pin_count_
     // 5.   返回获得的page
 
-    std::scoped_lock lock{latch_};
+    PageId new_page_id = {page_id->fd, disk_manager_->allocate_page(page_id->fd)};
+    Shard& shard = shard_of(new_page_id);
+    std::unique_lock lock{shard.latch};
 
-    // 1. 获取一个可用的帧，如果不可用则返回nullptr
-    frame_id_t frame_id;
-    if (!find_victim_page(&frame_id)) {
+    Page* page = load_frame(shard, lock, new_page_id, false);
+    while (page == nullptr && shard.prefetching > 0) {
+        shard.io_cv.wait(lock);  // 所有帧都被正在进行的预读占用，预读完成后帧可以被淘汰
+        page = load_frame(shard, lock, new_page_id, false);
+    }
+    if (page == nullptr) {
+        lock.unlock();
+        disk_manager_->deallocate_page(new_page_id.fd, new_page_id.page_no);
         return nullptr;
     }
+    *page_id = new_page_id;
+    return page;
+}
 
-    // 2. 为与fd关联的文件分配一个新的page_id
-    page_id->page_no = disk_manager_->allocate_page(page_id->fd);
-
-    // 3. 将帧的数据写回磁盘
-    if (pages_[frame_id].is_dirty()) {
-        disk_manager_->write_page(pages_[frame_id].get_page_id().fd, pages_[frame_id].get_page_id().page_no, pages_[frame_id].get_data(), PAGE_SIZE);
-        pages_[frame_id].is_dirty_ = false;
-    }
+/**
+ * @description: fetch_page并返回只固定页面、不加latch的guard，guard析构时取消固定
+ * @return {BasicPageGuard} 缓冲池中所有帧都被固定时返回空的guard
+ * @param {PageId} page_id 需要获取的页的PageId
+ */
+BasicPageGuard BufferPoolManager::fetch_page_basic(PageId page_id) {
+    return BasicPageGuard(this, fetch_page(page_id));
+}
 
-    // 4. 固定帧并更新pin_count_
-    replacer_->pin(frame_id);
-    pages_[frame_id].pin_count_ = 1;
+/**
+ * @description: fetch_page并获取页面的共享latch，多个读者可以同时持有同一个页面
+ * @return {ReadPageGuard} 缓冲池中所有帧都被固定时返回空的guard
+ * @param {PageId} page_id 需要获取的页的PageId
+ * @param {BufferRing*} ring 大批量顺序读取时使用的私有帧环
+ */
+ReadPageGuard BufferPoolManager::fetch_page_read(PageId page_id, BufferRing* ring) {
+    return ReadPageGuard(this, fetch_page(page_id, ring));
+}
 
-    pages_[frame_id].id_ = *page_id;
+/**
+ * @description: fetch_page并获取页面的排他latch
+ * @return {WritePageGuard} 缓冲池中所有帧都被固定时返回空的guard
+ * @param {PageId} page_id 需要获取的页的PageId
+ */
+WritePageGuard BufferPoolManager::fetch_page_write(PageId page_id) {
+    return WritePageGuard(this, fetch_page(page_id));
+}
 
-    // 5. 返回获取到的页
-    page_table_[*page_id] = frame_id;
-    return &pages_[frame_id];
+/**
+ * @description: new_page并获取新页面的排他latch，新页面总是标记为脏页，保证其被写回磁盘
+ * @return {WritePageGuard} 创建失败时返回空的guard
+ * @param {PageId*} page_id 当成功创建一个新的page时存储其page_id
+ */
+WritePageGuard BufferPoolManager::new_page_guarded(PageId* page_id) {
+    WritePageGuard guard(this, new_page(page_id));
+    if (guard.is_valid()) {
+        guard.mark_dirty();
+    }
+    return guard;
 }
 
 /**
@@ -237,45 +627,716 @@ Page* BufferPoolManager::new_page(PageId* page_id) {
  * @param {PageId} page_id 目标页
  */
 bool BufferPoolManager::delete_page(PageId page_id) {
-    // 1.   在page_table_中查找目标页，若不存在返回true
+    // 1.   在页表中查找目标页，若不存在返回true
     // 2.   若目标页的pin_count不为0，则返回false
-    // 3.   将目标页数据写回磁盘，从页表中删除目标页，重置其元数据，将其加入free_list_，返回true
+    // 3.   将目标页数据写回磁盘，从页表中删除目标页，重置其元数据，将其加入free_list，返回true
 
-    std::scoped_lock lock{latch_};
+    Shard& shard = shard_of(page_id);
+    std::unique_lock lock{shard.latch};
 
-    // 1. 在page_table_中查找目标页，若不存在返回true
-    auto it = page_table_.find(page_id);
-    if (it == page_table_.end()) {
+    // 1. 在页表中查找目标页，若不存在返回true
+    PageTable* table = shard.page_table.load(std::memory_order_relaxed);
+    Page* page = table->find(page_id);
+    if (page == nullptr) {
         return true;
     }
 
     // 2. 若目标页的pin_count不为0，则返回false
-    frame_id_t frame_id = it->second;
-    Page* page = &pages_[frame_id];
+    frame_id_t frame_id = page->frame_id_;
     if (page->pin_count_ != 0) {
         return false;
     }
 
-    // 3. 将目标页数据写回磁盘，从页表中删除目标页，重置其元数据，将其加入free_list_
+    // 3. 将目标页数据写回磁盘，写回期间固定该页面，写回后若又被其他线程固定则不能删除
     if (page->is_dirty_) {
-        disk_manager_->write_page(page->get_page_id().fd, page->get_page_id().page_no, page->get_data(), PAGE_SIZE);
+        pin_frame(shard, frame_id);
+        page->is_dirty_ = false;
+        lock.unlock();
+        try {
+            write_page_run(page_id.fd, page_id.page_no, {page});
+        } catch (...) {
+            lock.lock();
+            page->is_dirty_ = true;
+            unpin_frame(shard, page);
+            throw;
+        }
+        lock.lock();
+        unpin_frame(shard, page);
+        if (page->is_dirty_) {
+            return false;
+        }
+    }
+    // 写回后又被其他线程固定(包括无锁固定)则不能删除
+    if (!claim_frame(page)) {
+        return false;
     }
 
-    page_table_.erase(it);
+    // 从页表中删除目标页，重置其元数据，将其加入free_list
+    table = shard.page_table.load(std::memory_order_relaxed);  // 写回期间页表可能已经换成更大的
+    table->erase(page_id);
     page->reset_memory();
-    page_id.page_no = INVALID_PAGE_ID; //?
-    replacer_->unpin(frame_id);
-    free_list_.push_back(frame_id);
+    page->is_dirty_ = false;
+    page->id_.store(PageId{page_id.fd, INVALID_PAGE_ID}, std::memory_order_release);
+    shard.replacer->remove(frame_id);  // 从replacer中移除，该帧只能通过free_list再次分配
+    shard.free_list.push_back(frame_id);
 
     return true;
 }
 
 /**
- * @description: 将buffer_pool中的所有页写回到磁盘
+ * @description: 释放目标页所在的磁盘页面，之后DiskManager::allocate_page()可以复用该页面编号
+ *              页面中的数据被直接丢弃，不写回磁盘
+ * @return {bool} 成功释放返回true，若目标页仍被固定(pin_count不为0)则不做任何操作并返回false
+ * @param {PageId} page_id 目标页
+ */
+bool BufferPoolManager::deallocate_page(PageId page_id) {
+    {
+        Shard& shard = shard_of(page_id);
+        std::scoped_lock lock{shard.latch};
+
+        PageTable* table = shard.page_table.load(std::memory_order_relaxed);
+        Page* page = table->find(page_id);
+        if (page != nullptr) {
+            frame_id_t frame_id = page->frame_id_;
+            if (!claim_frame(page)) {
+                return false;
+            }
+            table->erase(page_id);
+            page->reset_memory();
+            page->is_dirty_ = false;
+            page->id_.store(PageId{page_id.fd, INVALID_PAGE_ID}, std::memory_order_release);
+            shard.replacer->remove(frame_id);
+            shard.free_list.push_back(frame_id);
+        }
+    }
+
+    disk_manager_->deallocate_page(page_id.fd, page_id.page_no);
+    return true;
+}
+
+/**
+ * @description: 将buffer_pool中属于文件fd的所有脏页写回到磁盘，干净的页面不写
+ *              脏页按page_no排序，编号连续的脏页合并为一次pwritev顺序写入；中间隔着干净页面时分成两次写入
+ *              写回期间页面被临时固定，磁盘I/O时不持有分区锁；每个页面持有共享latch复制后再写回(见write_page_run)
+ *              先等待该文件上正在进行的读入(包括预读)和淘汰写回完成，之后调用者可以安全地关闭文件
+ *              最后写回该文件的空闲页面表
  * @param {int} fd 文件句柄
  */
 void BufferPoolManager::flush_all_pages(int fd) {
-    for (auto& pair : page_table_) {
-        flush_page(pair.first);
+    std::vector<std::pair<Shard*, Page*>> pages;
+    for (auto& shard : shards_) {
+        std::unique_lock lock{shard->latch};
+        shard->io_cv.wait(lock, [&]() {
+            bool reading = false;
+            shard->page_table.load(std::memory_order_relaxed)->for_each([&](Page* page) {
+                if (page->get_page_id().fd == fd && page->io_in_progress_) reading = true;
+            });
+            if (reading) return false;
+            for (auto& page_id : shard->writing) {
+                if (page_id.fd == fd) return false;
+            }
+            return true;
+        });
+        shard->page_table.load(std::memory_order_relaxed)->for_each([&](Page* page) {
+            PageId page_id = page->get_page_id();
+            // 正在进行I/O的帧是刚读入的页面或者新页面，不需要写回
+            if (page_id.fd == fd && page_id.page_no != INVALID_PAGE_ID && !page->io_in_progress_ && page->is_dirty_) {
+                pin_frame(*shard, page->frame_id_);
+                page->is_dirty_ = false;
+                pages.emplace_back(shard.get(), page);
+            }
+        });
+    }
+    std::sort(pages.begin(), pages.end(), [](const auto& a, const auto& b) {
+        return a.second->get_page_id().page_no < b.second->get_page_id().page_no;
+    });
+
+    auto unpin_all = [&](bool succeeded) {
+        for (auto& [shard, page] : pages) {
+            std::scoped_lock lock{shard->latch};
+            if (!succeeded) page->is_dirty_ = true;
+            unpin_frame(*shard, page);
+        }
+    };
+
+    try {
+        size_t begin = 0;
+        while (begin < pages.size()) {
+            size_t end = begin + 1;
+            while (end < pages.size() &&
+                   pages[end].second->get_page_id().page_no == pages[end - 1].second->get_page_id().page_no + 1) {
+                end++;
+            }
+            std::vector<Page*> run;
+            for (size_t i = begin; i < end; i++) {
+                run.push_back(pages[i].second);
+            }
+            write_page_run(fd, run.front()->get_page_id().page_no, run);
+            begin = end;
+        }
+    } catch (...) {
+        unpin_all(false);
+        throw;
+    }
+    unpin_all(true);
+    // 页面写回之后空闲页面表也写回，使.fsm与磁盘上的文件一致
+    disk_manager_->flush_free_page_map(fd);
+}
+
+/**
+ * @description: 把同一文件中编号连续的页面一次性写回磁盘
+ * @param {int} fd 文件句柄
+ * @param {page_id_t} first_page_no run中第一个页面的编号
+ * @param {vector<Page*>} &run 按page_no升序排列且编号连续的页面，调用者已经固定这些页面
+ *              每个页面持有共享latch复制到临时缓冲区，等待正在修改页面的线程完成，写回的是一致的副本；
+ *              同一时刻只持有一个页面的latch，调用者不能持有其中任何页面的latch
+ */
+void BufferPoolManager::write_page_run(int fd, page_id_t first_page_no, const std::vector<Page*>& run) {
+    PageCopies data = alloc_page_copies(run.size());
+    for (size_t i = 0; i < run.size(); i++) {
+        std::shared_lock page_latch{run[i]->latch_};
+        memcpy(data.get() + i * PAGE_SIZE, run[i]->get_data(), PAGE_SIZE);
+    }
+    write_page_copies(fd, first_page_no, data.get(), run.size());
+}
+
+/**
+ * @description: 把复制出来的连续页面写回磁盘
+ * @param {char*} data num_pages个连续页面的副本，开启了页面校验和时在副本上计算校验和
+ *              开启了doublewrite时，这些页面先写入doublewrite文件再原地写回；压缩存储的文件不原地写入，
+ *              新的extent同步之后才修改映射项(见CompressedFile)，不需要doublewrite
+ */
+void BufferPoolManager::write_page_copies(int fd, page_id_t first_page_no, char* data, size_t num_pages) {
+    bool checksums = disk_manager_->has_page_checksums(fd);
+    std::vector<const char*> pages;
+    pages.reserve(num_pages);
+    for (size_t i = 0; i < num_pages; i++) {
+        char* page = data + i * PAGE_SIZE;
+        if (checksums) {
+            set_page_checksum(page);
+        }
+        pages.push_back(page);
+    }
+    if (checksums) {
+        std::shared_lock lock{doublewrite_latch_};
+        if (doublewrite_ != nullptr && !disk_manager_->is_compressed(fd)) {
+            doublewrite_->write(fd, first_page_no, pages);
+            return;
+        }
+    }
+    if (num_pages == 1) {
+        disk_manager_->write_page(fd, first_page_no, data, PAGE_SIZE);
+        return;
+    }
+    disk_manager_->write_page_run(fd, first_page_no, pages);
+}
+
+/**
+ * @description: 分配num_pages个连续页面的缓冲区，按DIRECT_IO_ALIGNMENT对齐以便O_DIRECT文件直接写入
+ */
+BufferPoolManager::PageCopies BufferPoolManager::alloc_page_copies(size_t num_pages) {
+    PageCopies data{static_cast<char*>(std::aligned_alloc(DIRECT_IO_ALIGNMENT, num_pages * PAGE_SIZE)), &std::free};
+    if (data == nullptr) {
+        throw std::bad_alloc();
+    }
+    return data;
+}
+
+/**
+ * @description: 开启doublewrite：先用doublewrite文件中的副本修复写了一半的页面，之后开启了页面校验和的文件写回时都经过doublewrite文件
+ *              需要在打开数据文件、读取页面之前调用
+ * @return {size_t} 修复的页面数
+ * @param {string&} path doublewrite文件的路径
+ * @param {size_t} capacity doublewrite文件的大小(页面数)
+ */
+size_t BufferPoolManager::enable_doublewrite(const std::string& path, size_t capacity) {
+    auto doublewrite = std::make_unique<DoublewriteBuffer>(disk_manager_, path, capacity);
+    size_t repaired = doublewrite->recover();
+    std::unique_lock lock{doublewrite_latch_};
+    doublewrite_ = std::move(doublewrite);
+    return repaired;
+}
+
+/**
+ * @description: 关闭doublewrite，等待正在进行的写回完成并同步写回过的数据文件
+ */
+void BufferPoolManager::disable_doublewrite() {
+    std::unique_lock lock{doublewrite_latch_};
+    if (doublewrite_ != nullptr) {
+        doublewrite_->sync_data_files();
+        doublewrite_.reset();
+    }
+}
+
+/**
+ * @description: 经过doublewrite文件写回的批次数，没有开启doublewrite时为0
+ */
+uint64_t BufferPoolManager::get_doublewrite_batches() {
+    std::shared_lock lock{doublewrite_latch_};
+    return doublewrite_ == nullptr ? 0 : doublewrite_->get_num_batches();
+}
+
+/**
+ * @description: 校验从磁盘读入的页面，文件没有开启页面校验和时总是成功
+ */
+bool BufferPoolManager::page_checksum_ok(PageId page_id, const char* data) const {
+    return !disk_manager_->has_page_checksums(page_id.fd) || verify_page_checksum(data);
+}
+
+/**
+ * @description: 启动后台页面清理线程，每隔interval检查一次，或者在请求线程淘汰脏页时被唤醒
+ *              没有调用set_persist_lsn_provider时不检查WAL规则，写回的脏页可能包含日志还没有持久化的修改
+ * @param {size_t} clean_frames 整个缓冲池需要保持的干净可淘汰帧数(空闲帧和未被固定的干净页面)
+ * @param {milliseconds} interval 两次检查之间的间隔
+ */
+void BufferPoolManager::start_page_cleaner(size_t clean_frames, std::chrono::milliseconds interval) {
+    std::scoped_lock lock{cleaner_latch_};
+    if (cleaner_running_) {
+        return;
     }
-}
\ No newline at end of file
+    clean_frames_target_ = clean_frames;
+    cleaner_interval_ = interval;
+    cleaner_running_ = true;
+    cleaner_thread_ = std::thread(&BufferPoolManager::page_cleaner_loop, this);
+}
+
+/**
+ * @description: 停止后台页面清理线程，等待正在进行的写回完成
+ */
+void BufferPoolManager::stop_page_cleaner() {
+    {
+        std::scoped_lock lock{cleaner_latch_};
+        if (!cleaner_running_) {
+            return;
+        }
+        cleaner_running_ = false;
+    }
+    cleaner_cv_.notify_all();
+    cleaner_thread_.join();
+}
+
+/**
+ * @description: 设置查询已持久化日志lsn的函数，页面lsn大于它的脏页不会被清理线程写回(WAL规则)
+ *              需要修改页面的上层同时用Page::set_page_lsn记录页面的lsn，否则所有页面的lsn都是初始值
+ */
+void BufferPoolManager::set_persist_lsn_provider(std::function<lsn_t()> provider) {
+    std::scoped_lock lock{cleaner_latch_};
+    persist_lsn_provider_ = std::move(provider);
+}
+
+/**
+ * @description: 执行一轮清理：每个分区按帧数比例分摊clean_frames，干净可淘汰帧不足时写回未被固定的脏页
+ * @return {size_t} 本轮写回的页面数
+ * @param {size_t} clean_frames 整个缓冲池需要保持的干净可淘汰帧数
+ */
+size_t BufferPoolManager::clean_pages(size_t clean_frames) {
+    std::function<lsn_t()> persist_lsn;
+    {
+        std::scoped_lock lock{cleaner_latch_};
+        persist_lsn = persist_lsn_provider_;
+    }
+    size_t written = 0;
+    size_t pool_size = pool_size_.load();
+    for (auto& shard : shards_) {
+        size_t num_frames;
+        {
+            std::scoped_lock lock{shard->latch};  // 分区的帧数可能正在被resize修改
+            num_frames = shard->num_frames;
+        }
+        size_t target = (clean_frames * num_frames + pool_size - 1) / pool_size;
+        written += clean_shard(*shard, target, persist_lsn);
+    }
+    return written;
+}
+
+/**
+ * @description: 清理一个分区：按页面lsn从小到大写回未被固定的脏页，直到干净可淘汰帧达到clean_frames
+ *              写回期间页面被临时固定，磁盘I/O时不持有分区锁；写回失败的页面重新标记为脏页
+ * @return {size_t} 写回的页面数
+ * @param {Shard&} shard 需要清理的分区
+ * @param {size_t} clean_frames 本分区需要保持的干净可淘汰帧数
+ * @param {function} &persist_lsn 返回已经持久化的最大lsn，为空时不检查WAL规则
+ */
+size_t BufferPoolManager::clean_shard(Shard& shard, size_t clean_frames, const std::function<lsn_t()>& persist_lsn) {
+    std::unique_lock lock{shard.latch};
+
+    size_t clean = shard.free_list.size();
+    std::vector<Page*> dirty;
+    lsn_t max_lsn = persist_lsn ? persist_lsn() : 0;
+    shard.page_table.load(std::memory_order_relaxed)->for_each([&](Page* page) {
+        if (page->pin_count_ != 0 || page->io_in_progress_) {
+            return;
+        }
+        if (!page->is_dirty_) {
+            clean++;
+        } else if (!persist_lsn || page->get_page_lsn() <= max_lsn) {
+            dirty.push_back(page);  // 日志还没有持久化的页面不能写回
+        }
+    });
+    if (clean >= clean_frames) {
+        return 0;
+    }
+
+    std::sort(dirty.begin(), dirty.end(), [](Page* a, Page* b) { return a->get_page_lsn() < b->get_page_lsn(); });
+    dirty.resize(std::min(dirty.size(), clean_frames - clean));
+    for (Page* page : dirty) {
+        pin_frame(shard, page->frame_id_);
+        page->is_dirty_ = false;
+    }
+    lock.unlock();
+
+    size_t written = 0;
+    for (Page* page : dirty) {
+        PageId page_id = page->get_page_id();
+        bool succeeded = true;
+        try {
+            write_page_run(page_id.fd, page_id.page_no, {page});
+        } catch (...) {
+            succeeded = false;
+        }
+        lock.lock();
+        if (succeeded) {
+            written++;
+        } else {
+            page->is_dirty_ = true;
+        }
+        unpin_frame(shard, page);
+        lock.unlock();
+    }
+    stats_.add(BUFFER_BACKGROUND_WRITE, written);
+    return written;
+}
+
+/**
+ * @description: 后台页面清理线程的主循环
+ */
+void BufferPoolManager::page_cleaner_loop() {
+    std::unique_lock lock{cleaner_latch_};
+    while (cleaner_running_) {
+        size_t clean_frames = clean_frames_target_;
+        lock.unlock();
+        clean_pages(clean_frames);
+        lock.lock();
+        if (cleaner_running_) {
+            cleaner_cv_.wait_for(lock, cleaner_interval_);
+        }
+    }
+}
+
+/**
+ * @description: 异步预读文件fd中的页面：为不在缓冲池中的页面分配帧后立即返回，由后台预读线程批量读入
+ *              预读中的页面处于io_in_progress_状态，fetch_page会等待读入完成；预读的页面读入后不被固定
+ *              找不到可用的帧时不再预读后面的页面
+ * @return {size_t} 提交预读的页面数
+ * @param {int} fd 文件句柄
+ * @param {vector<page_id_t>} &page_nos 需要预读的页面，按扫描顺序排列
+ * @param {BufferRing*} ring 不为空时在ring中分配帧
+ */
+size_t BufferPoolManager::prefetch_pages(int fd, const std::vector<page_id_t>& page_nos, BufferRing* ring) {
+    std::vector<PrefetchEntry> entries;
+    for (page_id_t page_no : page_nos) {
+        PageId page_id{fd, page_no};
+        Shard& shard = shard_of(page_id);
+        std::scoped_lock lock{shard.latch};
+        if (shard.page_table.load(std::memory_order_relaxed)->find(page_id) != nullptr ||
+            shard.writing.count(page_id) != 0) {
+            continue;  // 已经在缓冲池中，或者刚被淘汰、正在写回
+        }
+        PrefetchEntry entry{&shard, nullptr, {}};
+        entry.page = reserve_frame(shard, page_id, ring, &entry.run);
+        if (entry.page == nullptr) {
+            break;
+        }
+        shard.prefetching++;
+        entries.push_back(std::move(entry));
+    }
+    size_t num_pages = entries.size();
+    if (num_pages == 0) {
+        return 0;
+    }
+    stats_.add(BUFFER_PREFETCH, num_pages);
+
+    {
+        std::scoped_lock lock{prefetch_latch_};
+        if (!prefetch_running_) {
+            prefetch_running_ = true;
+            prefetch_thread_ = std::thread(&BufferPoolManager::prefetch_loop, this);
+        }
+        prefetch_queue_.push_back(std::move(entries));
+    }
+    prefetch_cv_.notify_one();
+    return num_pages;
+}
+
+/**
+ * @description: 完成一批预读：先写回帧中原来的脏页，再读入目标页面
+ *              开启io_uring时所有页面一次提交，否则编号连续的页面合并为一次preadv；批量读取失败时逐页重试
+ *              读入失败的页面(例如超出文件末尾)从缓冲池中移除
+ */
+void BufferPoolManager::run_prefetch(std::vector<PrefetchEntry>& entries) {
+    std::vector<bool> written(entries.size(), true);  // 帧中原来的脏页是否写回成功
+    std::vector<bool> ok(entries.size(), true);       // 目标页面是否读入成功
+    for (size_t i = 0; i < entries.size(); i++) {
+        WriteBackRun& run = entries[i].run;
+        if (run.pages.empty()) continue;
+        try {
+            write_page_copies(run.fd, run.first_page_no, run.data.get(), run.pages.size());
+            stats_.add(BUFFER_BACKGROUND_WRITE, run.pages.size());
+        } catch (...) {
+            written[i] = ok[i] = false;
+        }
+    }
+
+    // 按(fd, page_no)排序后合并编号连续的页面
+    std::vector<size_t> order;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (ok[i]) order.push_back(i);
+    }
+    auto page_id_of = [&](size_t i) { return entries[i].page->get_page_id(); };
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        PageId x = page_id_of(a), y = page_id_of(b);
+        return x.fd != y.fd ? x.fd < y.fd : x.page_no < y.page_no;
+    });
+    auto read_one = [&](size_t i) {
+        PageId page_id = page_id_of(i);
+        try {
+            disk_manager_->read_page(page_id.fd, page_id.page_no, entries[i].page->get_data(), PAGE_SIZE);
+        } catch (...) {
+            ok[i] = false;
+        }
+    };
+    if (disk_manager_->is_async_io_enabled()) {
+        std::vector<PageIoRequest> requests;
+        for (size_t i : order) {
+            PageId page_id = page_id_of(i);
+            requests.push_back({page_id.fd, page_id.page_no, entries[i].page->get_data(), PAGE_SIZE});
+        }
+        try {
+            disk_manager_->read_pages(requests);
+        } catch (...) {
+            for (size_t i : order) read_one(i);
+        }
+    } else {
+        size_t begin = 0;
+        while (begin < order.size()) {
+            size_t end = begin + 1;
+            while (end < order.size() && page_id_of(order[end]).fd == page_id_of(order[begin]).fd &&
+                   page_id_of(order[end]).page_no == page_id_of(order[end - 1]).page_no + 1) {
+                end++;
+            }
+            std::vector<char*> run;
+            for (size_t k = begin; k < end; k++) {
+                run.push_back(entries[order[k]].page->get_data());
+            }
+            try {
+                disk_manager_->read_page_run(page_id_of(order[begin]).fd, page_id_of(order[begin]).page_no, run);
+            } catch (...) {
+                for (size_t k = begin; k < end; k++) read_one(order[k]);
+            }
+            begin = end;
+        }
+    }
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (ok[i] && !page_checksum_ok(page_id_of(i), entries[i].page->get_data())) {
+            ok[i] = false;  // 之后fetch_page重新读入时报告校验和错误
+        }
+    }
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        Shard& shard = *entries[i].shard;
+        Page* page = entries[i].page;
+        std::scoped_lock lock{shard.latch};
+        finish_write_back(shard, entries[i].run, written[i]);
+        shard.prefetching--;
+        if (ok[i]) {
+            page->io_in_progress_ = false;
+            unpin_frame(shard, page);
+        } else {
+            discard_frame(shard, page);
+        }
+        shard.io_cv.notify_all();
+    }
+}
+
+/**
+ * @description: 后台预读线程的主循环，停止前处理完所有已经提交的请求
+ */
+void BufferPoolManager::prefetch_loop() {
+    std::unique_lock lock{prefetch_latch_};
+    while (true) {
+        prefetch_cv_.wait(lock, [&] { return !prefetch_queue_.empty() || !prefetch_running_; });
+        if (prefetch_queue_.empty()) {
+            return;
+        }
+        std::vector<PrefetchEntry> entries = std::move(prefetch_queue_.front());
+        prefetch_queue_.pop_front();
+        lock.unlock();
+        run_prefetch(entries);
+        lock.lock();
+    }
+}
+
+/**
+ * @description: 停止后台预读线程，等待已经提交的预读完成
+ */
+void BufferPoolManager::stop_prefetcher() {
+    {
+        std::scoped_lock lock{prefetch_latch_};
+        if (!prefetch_running_) {
+            return;
+        }
+        prefetch_running_ = false;
+    }
+    prefetch_cv_.notify_all();
+    prefetch_thread_.join();
+}
+
+/**
+ * @description: 从分区中回收最多num_frames个帧，分区至少保留一个帧
+ *              优先回收空闲帧，之后按置换策略淘汰未被固定的页面，脏页写回后再回收；回收的帧的页面数据内存归还给操作系统，
+ *              使用MAP_HUGETLB大页时要等到整个大页的帧都被回收才能归还
+ * @return {size_t} 实际回收的帧数，剩下的页面都被固定时少于num_frames
+ * @param {Shard&} shard 需要缩小的分区
+ * @param {size_t} num_frames 需要回收的帧数
+ */
+size_t BufferPoolManager::retire_frames(Shard& shard, size_t num_frames) {
+    std::unique_lock lock{shard.latch};
+    size_t retired = 0;
+    while (retired < num_frames && shard.num_frames > 1) {
+        frame_id_t frame_id;
+        if (!find_victim_page(shard, &frame_id)) {
+            break;
+        }
+        // 被淘汰的页面已经从页表中移除，该帧既不在free_list也不在replacer中，写回期间其他线程不会使用它
+        Page* page = shard.frames[frame_id];
+        WriteBackRun run = prepare_write_back(shard, page);
+        if (!run.pages.empty()) {
+            lock.unlock();
+            bool written = true;
+            try {
+                write_page_copies(run.fd, run.first_page_no, run.data.get(), run.pages.size());
+                stats_.add(BUFFER_BACKGROUND_WRITE, run.pages.size());
+            } catch (...) {
+                written = false;
+            }
+            lock.lock();
+            finish_write_back(shard, run, written);
+            shard.io_cv.notify_all();
+            if (!written) {
+                // 写回失败，页面保留在缓冲池中
+                page->is_dirty_ = true;
+                shard.page_table.load(std::memory_order_relaxed)->insert(page->get_page_id(), page);
+                page->pin_count_.store(0, std::memory_order_release);
+                shard.replacer->record_access(frame_id);
+                shard.replacer->unpin(frame_id);
+                break;
+            }
+        }
+        page->id_.store(PageId{page->get_page_id().fd, INVALID_PAGE_ID}, std::memory_order_release);
+        page->is_dirty_ = false;
+        shard.replacer->remove(frame_id);
+        shard.retired.push_back(frame_id);
+        shard.num_frames--;
+        retired++;
+        arena_of(page)->retire_frame(page->get_data());
+    }
+    return retired;
+}
+
+// 帧的页面数据所在的arena，调用者持有resize_latch_
+FrameArena* BufferPoolManager::arena_of(Page* page) {
+    for (auto& arena : arenas_) {
+        if (page->get_data() >= arena->data() && page->get_data() < arena->data() + arena->size()) {
+            return arena.get();
+        }
+    }
+    throw InternalError("BufferPoolManager::arena_of: frame is not in any arena");
+}
+
+/**
+ * @description: 缓冲池缩小时回收了帧，但内存还没有归还给操作系统的字节数
+ *              普通映射的帧回收时立即归还；MAP_HUGETLB大页中还有正在使用的帧，或者内核不支持归还hugetlb大页时不能归还
+ * @return {size_t} 没有归还的字节数
+ */
+size_t BufferPoolManager::get_retained_memory() {
+    std::scoped_lock resize_lock{resize_latch_};
+    size_t bytes = 0;
+    for (auto& arena : arenas_) {
+        bytes += arena->retained_bytes();
+    }
+    return bytes;
+}
+
+/**
+ * @description: 在线调整缓冲池的大小，调整期间其他线程可以继续使用缓冲池，已经固定的页面地址不变
+ *              扩大时先复用之前回收的帧，不足的部分分配新的帧；缩小时优先回收空闲帧，再按置换策略淘汰页面后回收帧
+ *              被固定的页面不会被淘汰，因此缩小后的帧数可能大于pool_size，调用者可以稍后重试
+ *              后台清理线程需要保持的干净帧数按新的大小等比例调整
+ *              新的帧分配失败时缓冲池大小不变，抛出InternalError
+ * @return {size_t} 调整后的帧数
+ * @param {size_t} pool_size 目标帧数，不能小于分区数，不能超过物理内存能容纳的页面数
+ */
+size_t BufferPoolManager::resize(size_t pool_size) {
+    std::scoped_lock resize_lock{resize_latch_};
+    if (pool_size < shards_.size()) {
+        throw InternalError("BufferPoolManager::resize: pool size must be at least " + std::to_string(shards_.size()));
+    }
+    // 上限同时保证add_frames中num_frames * PAGE_SIZE不会溢出
+    long phys_pages = sysconf(_SC_PHYS_PAGES);
+    long sys_page_size = sysconf(_SC_PAGESIZE);
+    size_t max_size = phys_pages > 0 && sys_page_size > 0
+                          ? static_cast<size_t>(phys_pages) * static_cast<size_t>(sys_page_size) / PAGE_SIZE
+                          : SIZE_MAX / PAGE_SIZE;
+    if (pool_size > max_size) {
+        throw InternalError("BufferPoolManager::resize: pool size must be at most " + std::to_string(max_size) +
+                            " (physical memory)");
+    }
+
+    size_t old_size = pool_size_.load();
+    if (pool_size > old_size) {
+        size_t extra = pool_size - old_size;
+        size_t num_shards = shards_.size();
+        size_t reused = 0;
+        for (size_t i = 0; i < num_shards; ++i) {
+            Shard& shard = *shards_[i];
+            size_t count = extra / num_shards + (i < extra % num_shards ? 1 : 0);
+            std::scoped_lock lock{shard.latch};
+            for (; count > 0 && !shard.retired.empty(); count--) {
+                Page* page = shard.frames[shard.retired.back()];
+                arena_of(page)->reuse_frame(page->get_data());
+                shard.free_list.push_back(shard.retired.back());
+                shard.retired.pop_back();
+                shard.num_frames++;
+                reused++;
+            }
+        }
+        pool_size_ += reused;
+        try {
+            add_frames(extra - reused);
+        } catch (std::bad_alloc&) {
+            // add_frames在修改分区之前分配描述符和arena，失败时只保留复用的帧
+            throw InternalError("BufferPoolManager::resize: cannot allocate " + std::to_string(extra - reused) +
+                                " frames, pool size is " + std::to_string(pool_size_.load()));
+        }
+    } else if (pool_size < old_size) {
+        // 第一轮各分区按帧数比例回收；某些分区被固定的页面太多时，第二轮由其他分区补足
+        size_t shrink = old_size - pool_size;
+        size_t remaining = shrink;
+        for (int round = 0; round < 2 && remaining > 0; round++) {
+            for (auto& shard : shards_) {
+                size_t count = round == 0 ? (shrink * shard->num_frames + old_size - 1) / old_size : remaining;
+                size_t retired = retire_frames(*shard, std::min(count, remaining));
+                remaining -= retired;
+                pool_size_ -= retired;
+            }
+        }
+    }
+
+    size_t new_size = pool_size_.load();
+    {
+        std::scoped_lock lock{cleaner_latch_};
+        clean_frames_target_ = clean_frames_target_ * new_size / old_size;
+    }
+    return new_size;
+}
@@ -2,49 +2,108 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <functional>
 #include <list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include "buffer_ring.h"
 #include "disk_manager.h"
+#include "doublewrite_buffer.h"
+#include "frame_arena.h"
 #include "errors.h"
 #include "page.h"
+#include "page_guard.h"
+#include "page_table.h"
+#include "storage_stats.h"
+#include "replacer/clock_replacer.h"
+#include "replacer/lru_k_replacer.h"
 #include "replacer/lru_replacer.h"
 #include "replacer/replacer.h"
 
 class BufferPoolManager {
    private:
-    size_t pool_size_;      // buffer_pool中可容纳页面的个数，即帧的个数
-    Page *pages_;           // buffer_pool中的Page对象数组，在构造空间中申请内存空间，在析构函数中释放，大小为BUFFER_POOL_SIZE
-    std::unordered_map<PageId, frame_id_t, PageIdHash> page_table_; // 帧号和页面号的映射哈希表，用于根据页面的PageId定位该页面的帧编号
-    std::list<frame_id_t> free_list_;   // 空闲帧编号的链表
+    /**
+     * @description: 缓冲池的一个分区，PageId按哈希值分配到各个分区
+     * 每个分区有独立的页表、空闲帧链表、置换策略和锁，不同分区上的操作互不阻塞
+     * 分区内的帧编号frame_id从0开始，只在本分区内有效；缓冲池缩小时回收的帧保留编号，扩大时优先复用
+     * 命中缓冲池的fetch_page不加latch：无锁查找page_table，再用CAS固定帧(见try_pin_page)
+     */
+    struct Shard {
+        std::vector<Page *> frames;         // 本分区的帧，下标为frame_id，包括已经回收的帧
+        size_t num_frames = 0;              // 本分区正在使用的帧数，即frames中没有被回收的帧数
+        std::vector<frame_id_t> retired;    // 缩小缓冲池时回收的帧，页面数据的内存已经归还给操作系统
+        std::atomic<PageTable *> page_table{nullptr};                    // 页面号到帧的映射，修改需要持有latch，查找不需要
+        std::vector<std::unique_ptr<PageTable>> page_tables;  // 帧数增加时换用更大的页表，旧页表可能仍在被无锁查找读取，保留到析构
+        std::list<frame_id_t> free_list;                                 // 空闲帧编号的链表
+        std::unique_ptr<Replacer> replacer;                              // 本分区的置换策略
+        std::unordered_set<PageId, PageIdHash> writing;  // 已经被淘汰、正在写回磁盘的页面，写回完成前不能重新读入
+        size_t prefetching = 0;             // 已经分配了帧、等待后台预读完成的页面数，预读完成前这些帧不能被淘汰
+        std::mutex latch;                   // 保护以上数据结构，以及本分区内Page除无锁固定以外的元数据修改
+        std::condition_variable io_cv;      // 等待本分区内的磁盘I/O完成
+    };
+
+    std::atomic<size_t> pool_size_{0};  // buffer_pool中可容纳页面的个数，即正在使用的帧的个数
+    // 帧的描述符数组(元数据)，每次扩大缓冲池分配一段，析构时释放；缩小缓冲池时不释放，保证Page*一直有效
+    std::vector<std::unique_ptr<Page[]>> descriptors_;
+    // 各段帧的页面数据所在的连续内存，与descriptors_一一对应，按大页对齐(满足O_DIRECT的对齐要求)
+    std::vector<std::unique_ptr<FrameArena>> arenas_;
+    std::mutex resize_latch_;                       // 保证同一时间只有一个线程调整缓冲池大小
+    std::vector<std::unique_ptr<Shard>> shards_;    // 缓冲池的各个分区，分区数在创建时确定
     DiskManager *disk_manager_;
-    Replacer *replacer_;    // buffer_pool的置换策略，当前赛题中为LRU置换策略
-    std::mutex latch_;      // 用于共享数据结构的并发控制
+
+    // 后台页面清理线程，提前写回未被固定的脏页，使淘汰页面时不需要在请求线程上写盘
+    std::thread cleaner_thread_;
+    std::mutex cleaner_latch_;                      // 保护以下清理线程的状态
+    std::condition_variable cleaner_cv_;            // 唤醒清理线程：停止，或者请求线程淘汰了脏页
+    bool cleaner_running_ = false;
+    size_t clean_frames_target_ = 0;                // 整个缓冲池需要保持的干净可淘汰帧数
+    std::chrono::milliseconds cleaner_interval_{PAGE_CLEANER_INTERVAL};
+    std::function<lsn_t()> persist_lsn_provider_;   // 返回已经持久化的最大lsn，为空时不检查WAL规则
+
+    StatCounters<NUM_BUFFER_STATS> stats_;          // 命中、淘汰、写回等计数，见BufferStat
+
+    std::shared_mutex doublewrite_latch_;           // 写回时共享持有，开启和关闭doublewrite时独占持有
+    std::unique_ptr<DoublewriteBuffer> doublewrite_;  // 为空时直接原地写回
 
    public:
-    BufferPoolManager(size_t pool_size, DiskManager *disk_manager)
-        : pool_size_(pool_size), disk_manager_(disk_manager) {
-        // 为buffer pool分配一块连续的内存空间
-        pages_ = new Page[pool_size_];
-        // 可以被Replacer改变
-        if (REPLACER_TYPE.compare("LRU"))
-            replacer_ = new LRUReplacer(pool_size_);
-        else if (REPLACER_TYPE.compare("CLOCK"))
-            replacer_ = new LRUReplacer(pool_size_);
-        else {
-            replacer_ = new LRUReplacer(pool_size_);
-        }
-        // 初始化时，所有的page都在free_list_中
-        for (size_t i = 0; i < pool_size_; ++i) {
-            free_list_.emplace_back(static_cast<frame_id_t>(i));  // static_cast转换数据类型
+    /**
+     * @param {size_t} pool_size 帧的个数
+     * @param {DiskManager*} disk_manager
+     * @param {string} &replacer_type 置换策略，"LRU"、"CLOCK"或"LRU-K"，默认使用config.h中的REPLACER_TYPE
+     */
+    BufferPoolManager(size_t pool_size, DiskManager *disk_manager, const std::string &replacer_type = REPLACER_TYPE)
+        : disk_manager_(disk_manager) {
+        // 每个分区至少有MIN_FRAMES_PER_SHARD个帧，较小的缓冲池(如单元测试)只有一个分区
+        size_t num_shards = std::clamp<size_t>(pool_size / MIN_FRAMES_PER_SHARD, 1, BUFFER_POOL_SHARDS);
+        for (size_t i = 0; i < num_shards; ++i) {
+            auto shard = std::make_unique<Shard>();
+            shard->replacer = create_replacer(replacer_type, 0);
+            grow_page_table(*shard);
+            shards_.push_back(std::move(shard));
         }
+        // 初始化时，所有的帧都在free_list中
+        add_frames(pool_size);
     }
 
     ~BufferPoolManager() {
-        delete[] pages_;
-        delete replacer_;
+        stop_page_cleaner();
+        stop_prefetcher();
+        doublewrite_.reset();
+        shards_.clear();
     }
 
     /**
@@ -53,8 +112,10 @@ class BufferPoolManager {
      */
     static void mark_dirty(Page* page) { page->is_dirty_ = true; }
 
-   public: 
-    Page* fetch_page(PageId page_id);
+   public:
+    Page* fetch_page(PageId page_id, BufferRing* ring = nullptr);
+
+    size_t prefetch_pages(int fd, const std::vector<page_id_t>& page_nos, BufferRing* ring = nullptr);
 
     bool unpin_page(PageId page_id, bool is_dirty);
 
@@ -62,12 +123,139 @@ class BufferPoolManager {
 
     Page* new_page(PageId* page_id);
 
+    BasicPageGuard fetch_page_basic(PageId page_id);
+
+    ReadPageGuard fetch_page_read(PageId page_id, BufferRing* ring = nullptr);
+
+    WritePageGuard fetch_page_write(PageId page_id);
+
+    WritePageGuard new_page_guarded(PageId* page_id);
+
     bool delete_page(PageId page_id);
 
+    bool deallocate_page(PageId page_id);
+
     void flush_all_pages(int fd);
 
+    size_t get_num_shards() const { return shards_.size(); }
+
+    size_t get_pool_size() const { return pool_size_.load(); }
+
+    size_t resize(size_t pool_size);
+
+    size_t get_retained_memory();
+
+    void start_page_cleaner(size_t clean_frames, std::chrono::milliseconds interval = PAGE_CLEANER_INTERVAL);
+
+    void stop_page_cleaner();
+
+    size_t clean_pages(size_t clean_frames);
+
+    void set_persist_lsn_provider(std::function<lsn_t()> provider);
+
+    uint64_t get_foreground_writes() const { return stats_.get(BUFFER_FOREGROUND_WRITE); }
+
+    uint64_t get_background_writes() const { return stats_.get(BUFFER_BACKGROUND_WRITE); }
+
+    // 汇总各个线程的计数，下标为BufferStat
+    BufferPoolStats get_stats() const { return stats_.snapshot(); }
+
+    size_t enable_doublewrite(const std::string& path, size_t capacity = DOUBLEWRITE_PAGES);
+
+    void disable_doublewrite();
+
+    uint64_t get_doublewrite_batches();
+
    private:
-    bool find_victim_page(frame_id_t* frame_id);
+    // 按DIRECT_IO_ALIGNMENT对齐的连续页面副本，用于写回
+    using PageCopies = std::unique_ptr<char, decltype(&std::free)>;
+
+    // 淘汰脏页时需要写回的一段编号连续的页面
+    struct WriteBackRun {
+        int fd = -1;
+        page_id_t first_page_no = INVALID_PAGE_ID;
+        std::vector<Page*> pages;   // 按page_no升序排列，除被淘汰的页面外都被临时固定
+        PageCopies data{nullptr, &std::free};  // 准备写回时复制的pages的内容，写回的是这份副本
+        Page* victim = nullptr;     // 被淘汰的页面
+        PageId victim_id;           // 被淘汰页面原来的PageId，写回完成前记录在Shard::writing中
+    };
+
+    // 预读的一个页面：帧以io_in_progress_状态加入页表，由预读线程完成写回和读入
+    struct PrefetchEntry {
+        Shard* shard;
+        Page* page;
+        WriteBackRun run;           // 帧中原来的脏页
+    };
+
+    // 后台预读线程，第一次调用prefetch_pages时启动
+    std::thread prefetch_thread_;
+    std::mutex prefetch_latch_;                             // 保护prefetch_queue_和prefetch_running_
+    std::condition_variable prefetch_cv_;
+    std::deque<std::vector<PrefetchEntry>> prefetch_queue_;  // 等待预读线程处理的请求
+    bool prefetch_running_ = false;
+
+    /**
+     * @description: 根据置换策略的名称("LRU"/"CLOCK"/"LRU-K")创建replacer
+     */
+    static std::unique_ptr<Replacer> create_replacer(const std::string &replacer_type, size_t num_frames) {
+        if (replacer_type == "LRU") {
+            return std::make_unique<LRUReplacer>(num_frames);
+        } else if (replacer_type == "CLOCK") {
+            return std::make_unique<ClockReplacer>(num_frames);
+        } else if (replacer_type == "LRU-K") {
+            return std::make_unique<LRUKReplacer>(num_frames, LRU_K);
+        }
+        throw InternalError("Unknown replacer type: " + replacer_type);
+    }
+
+    Shard& shard_of(PageId page_id);
+
+    void add_frames(size_t num_frames);
+
+    void grow_page_table(Shard& shard);
+
+    Page* try_pin_page(Shard& shard, PageId page_id);
+
+    static bool claim_frame(Page* page);
+
+    size_t retire_frames(Shard& shard, size_t num_frames);
+
+    FrameArena* arena_of(Page* page);
+
+    bool find_victim_page(Shard& shard, frame_id_t* frame_id);
+
+    bool reuse_ring_frame(Shard& shard, BufferRing& ring, frame_id_t* frame_id);
+
+    Page* reserve_frame(Shard& shard, PageId page_id, BufferRing* ring, WriteBackRun* run);
+
+    void discard_frame(Shard& shard, Page* page);
+
+    Page* load_frame(Shard& shard, std::unique_lock<std::mutex>& lock, PageId page_id, bool read_from_disk,
+                     BufferRing* ring = nullptr);
+
+    WriteBackRun prepare_write_back(Shard& shard, Page* victim);
+
+    void finish_write_back(Shard& shard, WriteBackRun& run, bool succeeded);
+
+    void pin_frame(Shard& shard, frame_id_t frame_id);
+
+    void unpin_frame(Shard& shard, Page* page);
+
+    void write_page_run(int fd, page_id_t first_page_no, const std::vector<Page*>& run);
+
+    void write_page_copies(int fd, page_id_t first_page_no, char* data, size_t num_pages);
+
+    static PageCopies alloc_page_copies(size_t num_pages);
+
+    bool page_checksum_ok(PageId page_id, const char* data) const;
+
+    size_t clean_shard(Shard& shard, size_t clean_frames, const std::function<lsn_t()>& persist_lsn);
+
+    void page_cleaner_loop();
+
+    void run_prefetch(std::vector<PrefetchEntry>& entries);
+
+    void prefetch_loop();
 
-    void update_page(Page* page, PageId new_page_id, frame_id_t new_frame_id);
-};
\ No newline at end of file
+    void stop_prefetcher();
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <deque>
+
+#include "common/config.h"
+#include "page.h"
+
+/*
+BufferRing是大批量顺序读取（全表扫描、建索引）私有的一小组帧
+通过BufferRing读入的页面优先复用环中已经不再被固定的帧，而不是从整个缓冲池中淘汰其他页面，
+这样一次大表扫描最多只占用环大小的帧，不会把OLTP的热点页面挤出缓冲池
+一个BufferRing只能被一个线程使用
+*/
+class BufferRing {
+    friend class BufferPoolManager;
+
+   public:
+    /**
+     * @param {size_t} capacity 环中最多的帧数
+     */
+    explicit BufferRing(size_t capacity = BUFFER_RING_SIZE) : capacity_(capacity) {}
+
+    size_t size() const { return slots_.size(); }
+
+    size_t capacity() const { return capacity_; }
+
+   private:
+    // 环中的一个帧，以及环读入该帧的页面；帧中已经换成了其他页面时不再复用
+    struct Slot {
+        Page *page;
+        PageId page_id;
+    };
+
+    size_t capacity_;
+    std::deque<Slot> slots_;  // 按读入的先后顺序排列，首部最早
+};
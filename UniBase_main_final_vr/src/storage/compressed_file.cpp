@@ -0,0 +1,303 @@
+#include "storage/compressed_file.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "errors.h"
+#include "storage/page_compression.h"
+
+namespace {
+
+bool pread_all(int fd, void *buf, size_t count, off_t offset) {
+    size_t done = 0;
+    while (done < count) {
+        ssize_t n = pread(fd, static_cast<char *>(buf) + done, count - done, offset + done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += n;
+    }
+    return true;
+}
+
+void pwrite_all(int fd, const void *buf, size_t count, off_t offset) {
+    size_t done = 0;
+    while (done < count) {
+        ssize_t n = pwrite(fd, static_cast<const char *>(buf) + done, count - done, offset + done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw UnixError();
+        }
+        done += n;
+    }
+}
+
+}  // namespace
+
+/**
+ * @description: 根据文件头判断文件是否是压缩存储的表文件
+ */
+bool CompressedFile::is_compressed_file(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    uint32_t magic = 0;
+    bool ok = pread_all(fd, &magic, sizeof(magic), 0);
+    close(fd);
+    return ok && magic == MAGIC;
+}
+
+/**
+ * @description: 把空文件初始化为没有任何页面的压缩文件
+ */
+void CompressedFile::format(int fd) {
+    FileHdr hdr{};
+    hdr.magic = MAGIC;
+    pwrite_all(fd, &hdr, sizeof(hdr), 0);
+}
+
+CompressedFile::CompressedFile(int fd) : fd_(fd) {
+    if (!pread_all(fd_, &hdr_, sizeof(hdr_), 0) || hdr_.magic != MAGIC || hdr_.num_map_blocks > MAX_MAP_BLOCKS) {
+        throw InternalError("CompressedFile: bad file header");
+    }
+    // 根据文件头和映射表中使用的扇区重建空闲空间
+    std::map<uint32_t, uint32_t> used{{0, SECTORS_PER_PAGE}};
+    for (uint32_t b = 0; b < hdr_.num_map_blocks; b++) {
+        std::unique_ptr<MapEntry[]> block(new MapEntry[ENTRIES_PER_MAP_BLOCK]);
+        if (!pread_all(fd_, block.get(), PAGE_SIZE, static_cast<off_t>(hdr_.map_block_sectors[b]) * SECTOR_SIZE)) {
+            throw InternalError("CompressedFile: bad page map");
+        }
+        used[hdr_.map_block_sectors[b]] = SECTORS_PER_PAGE;
+        for (size_t i = 0; i < ENTRIES_PER_MAP_BLOCK; i++) {
+            if (block[i].length > 0) {
+                used[block[i].sector] = sectors_of(block[i].length);
+            }
+        }
+        map_blocks_.push_back(std::move(block));
+    }
+    end_sector_ = 0;
+    for (auto [sector, num_sectors] : used) {
+        if (sector > end_sector_) {
+            free_extents_[end_sector_] = sector - end_sector_;
+        }
+        end_sector_ = std::max(end_sector_, sector + num_sectors);
+    }
+}
+
+/**
+ * @description: 读取页面，解压后复制前num_bytes个字节
+ * @return {size_t} 从磁盘读取的字节数
+ */
+size_t CompressedFile::read_page(page_id_t page_no, char *data, int num_bytes) {
+    MapEntry entry{};
+    {
+        std::scoped_lock lock{latch_};
+        if (page_no >= 0 && static_cast<size_t>(page_no) < map_blocks_.size() * ENTRIES_PER_MAP_BLOCK) {
+            entry = entry_of(page_no);
+        }
+    }
+    if (entry.length == 0) {
+        throw InternalError("DiskManager::read_page Error");  // 与读到未压缩文件末尾之后一致
+    }
+    char stored[PAGE_SIZE];
+    if (!pread_all(fd_, stored, entry.length, static_cast<off_t>(entry.sector) * SECTOR_SIZE)) {
+        throw InternalError("DiskManager::read_page Error");
+    }
+    if (entry.length == PAGE_SIZE) {
+        memcpy(data, stored, num_bytes);
+    } else if (num_bytes == PAGE_SIZE) {
+        if (!decompress_block(stored, entry.length, data, PAGE_SIZE)) {
+            throw InternalError("CompressedFile: corrupted page " + std::to_string(page_no));
+        }
+    } else {
+        char page[PAGE_SIZE];
+        if (!decompress_block(stored, entry.length, page, PAGE_SIZE)) {
+            throw InternalError("CompressedFile: corrupted page " + std::to_string(page_no));
+        }
+        memcpy(data, page, num_bytes);
+    }
+    return entry.length;
+}
+
+/**
+ * @description: 压缩页面并写入新分配的extent，同步之后再修改映射项，旧的extent在下一次同步之后才能复用
+ *              num_bytes小于PAGE_SIZE时只覆盖页面的前num_bytes个字节，其余内容保持不变
+ * @return {size_t} 写入磁盘的字节数(按扇区对齐)
+ */
+size_t CompressedFile::write_page(page_id_t page_no, const char *data, int num_bytes) {
+    if (page_no < 0 || static_cast<size_t>(page_no) >= MAX_MAP_BLOCKS * ENTRIES_PER_MAP_BLOCK) {
+        throw InternalError("CompressedFile: page number out of range");
+    }
+    char page[PAGE_SIZE];
+    if (num_bytes < PAGE_SIZE) {
+        memset(page, 0, PAGE_SIZE);
+        try {
+            read_page(page_no, page, PAGE_SIZE);
+        } catch (InternalError &) {
+            // 页面还没有写入过
+        }
+        memcpy(page, data, num_bytes);
+        data = page;
+    }
+
+    // 压缩后至少要省下一个扇区，否则原样存放
+    char stored[PAGE_SIZE];
+    size_t length = compress_block(data, PAGE_SIZE, stored, PAGE_SIZE - SECTOR_SIZE);
+    if (length == 0) {
+        length = PAGE_SIZE;
+        memcpy(stored, data, PAGE_SIZE);
+    }
+    uint32_t num_sectors = sectors_of(length);
+    memset(stored + length, 0, num_sectors * SECTOR_SIZE - length);
+
+    uint32_t sector;
+    {
+        std::scoped_lock lock{latch_};
+        add_map_blocks(page_no / ENTRIES_PER_MAP_BLOCK + 1);
+        sector = allocate(num_sectors);
+    }
+    try {
+        pwrite_all(fd_, stored, num_sectors * SECTOR_SIZE, static_cast<off_t>(sector) * SECTOR_SIZE);
+        // 新的extent落盘之后才能让映射项指向它，否则崩溃后映射项可能指向没有写完的数据
+        sync_data();
+    } catch (...) {
+        std::scoped_lock lock{latch_};
+        release(sector, num_sectors);
+        throw;
+    }
+
+    std::scoped_lock lock{latch_};
+    MapEntry &entry = entry_of(page_no);
+    MapEntry old = entry;
+    entry = {sector, static_cast<uint16_t>(length), 0};
+    write_entry(page_no);
+    if (old.length > 0) {
+        pending_extents_.emplace_back(old.sector, sectors_of(old.length));
+    }
+    return num_sectors * SECTOR_SIZE;
+}
+
+/**
+ * @description: 释放页面占用的空间，页面被释放(DiskManager::deallocate_page)时调用
+ */
+void CompressedFile::discard_page(page_id_t page_no) {
+    std::scoped_lock lock{latch_};
+    if (page_no < 0 || static_cast<size_t>(page_no) >= map_blocks_.size() * ENTRIES_PER_MAP_BLOCK) {
+        return;
+    }
+    MapEntry &entry = entry_of(page_no);
+    if (entry.length == 0) {
+        return;
+    }
+    MapEntry old = entry;
+    entry = {};
+    write_entry(page_no);
+    pending_extents_.emplace_back(old.sector, sectors_of(old.length));
+}
+
+/**
+ * @description: 所有页面压缩后占用的磁盘空间(按扇区对齐)，不包括文件头和映射块
+ */
+size_t CompressedFile::get_stored_bytes() {
+    std::scoped_lock lock{latch_};
+    size_t bytes = 0;
+    for (auto &block : map_blocks_) {
+        for (size_t i = 0; i < ENTRIES_PER_MAP_BLOCK; i++) {
+            bytes += sectors_of(block[i].length) * SECTOR_SIZE;
+        }
+    }
+    return bytes;
+}
+
+CompressedFile::MapEntry &CompressedFile::entry_of(page_id_t page_no) {
+    return map_blocks_[page_no / ENTRIES_PER_MAP_BLOCK][page_no % ENTRIES_PER_MAP_BLOCK];
+}
+
+/**
+ * @description: 保证至少有num_map_blocks个映射块：新的映射块先写入全0的内容并同步，再写入文件头
+ */
+void CompressedFile::add_map_blocks(size_t num_map_blocks) {
+    while (map_blocks_.size() < num_map_blocks) {
+        std::unique_ptr<MapEntry[]> block(new MapEntry[ENTRIES_PER_MAP_BLOCK]());
+        uint32_t sector = allocate(SECTORS_PER_PAGE);
+        pwrite_all(fd_, block.get(), PAGE_SIZE, static_cast<off_t>(sector) * SECTOR_SIZE);
+        if (fdatasync(fd_) < 0) {
+            release(sector, SECTORS_PER_PAGE);
+            throw UnixError();
+        }
+        hdr_.map_block_sectors[hdr_.num_map_blocks++] = sector;
+        pwrite_all(fd_, &hdr_, sizeof(hdr_), 0);
+        map_blocks_.push_back(std::move(block));
+    }
+}
+
+void CompressedFile::write_entry(page_id_t page_no) {
+    off_t offset = static_cast<off_t>(hdr_.map_block_sectors[page_no / ENTRIES_PER_MAP_BLOCK]) * SECTOR_SIZE +
+                   page_no % ENTRIES_PER_MAP_BLOCK * sizeof(MapEntry);
+    pwrite_all(fd_, &entry_of(page_no), sizeof(MapEntry), offset);
+}
+
+/**
+ * @description: 分配num_sectors个连续的扇区，选择第一个足够大的空闲区间，没有时从文件末尾分配
+ */
+uint32_t CompressedFile::allocate(uint32_t num_sectors) {
+    for (auto it = free_extents_.begin(); it != free_extents_.end(); ++it) {
+        if (it->second >= num_sectors) {
+            uint32_t sector = it->first;
+            uint32_t rest = it->second - num_sectors;
+            free_extents_.erase(it);
+            if (rest > 0) {
+                free_extents_[sector + num_sectors] = rest;
+            }
+            return sector;
+        }
+    }
+    uint32_t sector = end_sector_;
+    end_sector_ += num_sectors;
+    return sector;
+}
+
+void CompressedFile::release(uint32_t sector, uint32_t num_sectors) {
+    auto next = free_extents_.lower_bound(sector);
+    if (next != free_extents_.end() && sector + num_sectors == next->first) {
+        num_sectors += next->second;
+        next = free_extents_.erase(next);
+    }
+    if (next != free_extents_.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == sector) {
+            sector = prev->first;
+            num_sectors += prev->second;
+            free_extents_.erase(prev);
+        }
+    }
+    if (sector + num_sectors == end_sector_) {
+        end_sector_ = sector;
+    } else {
+        free_extents_[sector] = num_sectors;
+    }
+}
+
+/**
+ * @description: 同步文件的数据，之前写入的映射项随之落盘，它们不再引用的extent可以复用
+ *              只有调用前已经在pending_extents_中的extent可以释放：之后加入的映射项可能在同步开始之后才写入
+ */
+void CompressedFile::sync_data() {
+    std::vector<std::pair<uint32_t, uint32_t>> synced;
+    {
+        std::scoped_lock lock{latch_};
+        synced.swap(pending_extents_);
+    }
+    if (fdatasync(fd_) < 0) {
+        std::scoped_lock lock{latch_};
+        pending_extents_.insert(pending_extents_.end(), synced.begin(), synced.end());
+        throw UnixError();
+    }
+    std::scoped_lock lock{latch_};
+    for (auto [sector, num_sectors] : synced) {
+        release(sector, num_sectors);
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "common/config.h"
+
+/*
+CompressedFile是压缩存储的表文件：页面写回时压缩成变长的extent，读取时解压，对上层仍然是固定大小的页面
+文件以SECTOR_SIZE为单位分配空间：
+    第0个页面大小的块为文件头，记录各个页面映射块的位置
+    页面映射块记录每个页面的extent(起始扇区和压缩后的字节数)，按需分配
+    其余空间为页面的extent，不可压缩的页面原样存放
+页面总是写到新分配的extent，fdatasync之后才修改映射项(8字节，不会写了一半)；
+旧的extent等到下一次fdatasync之后才能复用，此前修改映射项的写入可能还没有落盘，崩溃后映射项仍然指向旧的extent
+因此崩溃时页面要么是旧的内容要么是新的内容，不需要经过doublewrite；代价是每次写页面都要同步一次
+空闲空间不持久化：打开文件时根据映射表重建，等待复用的extent也随之变为空闲
+*/
+class CompressedFile {
+   public:
+    static constexpr size_t SECTOR_SIZE = 512;
+
+    static bool is_compressed_file(const std::string &path);
+
+    static void format(int fd);
+
+    // 加载fd对应文件的文件头和页面映射表，fd需要以O_RDWR打开且不使用O_DIRECT
+    explicit CompressedFile(int fd);
+
+    CompressedFile(const CompressedFile &) = delete;
+    CompressedFile &operator=(const CompressedFile &) = delete;
+
+    size_t read_page(page_id_t page_no, char *data, int num_bytes);
+
+    size_t write_page(page_id_t page_no, const char *data, int num_bytes);
+
+    void discard_page(page_id_t page_no);
+
+    size_t get_stored_bytes();
+
+   private:
+    static constexpr uint32_t MAGIC = 0x5a504255;  // "UBPZ"
+    static constexpr uint32_t SECTORS_PER_PAGE = PAGE_SIZE / SECTOR_SIZE;
+
+    // 页面映射项，length为0说明页面没有写入过，读出全0；length为PAGE_SIZE说明页面原样存放
+    struct MapEntry {
+        uint32_t sector;
+        uint16_t length;
+        uint16_t reserved;
+    };
+    static constexpr size_t ENTRIES_PER_MAP_BLOCK = PAGE_SIZE / sizeof(MapEntry);
+
+    struct FileHdr {
+        uint32_t magic;
+        uint32_t num_map_blocks;
+        uint32_t map_block_sectors[(PAGE_SIZE - 8) / sizeof(uint32_t)];  // 各个映射块的起始扇区
+    };
+    static_assert(sizeof(FileHdr) == PAGE_SIZE, "compressed file header must fill a page");
+    static constexpr size_t MAX_MAP_BLOCKS = sizeof(FileHdr::map_block_sectors) / sizeof(uint32_t);
+
+    static uint32_t sectors_of(size_t num_bytes) { return (num_bytes + SECTOR_SIZE - 1) / SECTOR_SIZE; }
+
+    MapEntry &entry_of(page_id_t page_no);
+
+    void add_map_blocks(size_t num_map_blocks);
+
+    void write_entry(page_id_t page_no);
+
+    uint32_t allocate(uint32_t num_sectors);
+
+    void release(uint32_t sector, uint32_t num_sectors);
+
+    void sync_data();
+
+    int fd_;
+    std::mutex latch_;                                    // 保护以下成员
+    FileHdr hdr_{};
+    std::vector<std::unique_ptr<MapEntry[]>> map_blocks_;
+    std::map<uint32_t, uint32_t> free_extents_;           // 空闲的扇区：起始扇区 -> 扇区数，相邻的空闲区间已经合并
+    // 映射项已经不再引用、但修改映射项的写入还没有同步的extent：起始扇区和扇区数，同步之后才加入free_extents_
+    std::vector<std::pair<uint32_t, uint32_t>> pending_extents_;
+    uint32_t end_sector_ = SECTORS_PER_PAGE;              // 已经使用的最大扇区+1，之后的空间都是空闲的
+};
@@ -4,12 +4,93 @@
 #include <assert.h>    // for assert
 #include <string.h>    // for memset
 #include <sys/stat.h>  // for stat
-#include <unistd.h>    // for lseek 
+#include <sys/uio.h>   // for pwritev
+#include <unistd.h>    // for pread/pwrite
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
 
 #include "defs.h" //跟makefile相关的，不用管
 
 DiskManager::DiskManager() { memset(fd2pageno_, 0, MAX_FD * (sizeof(std::atomic<page_id_t>) / sizeof(char))); }
 
+/**
+ * @description: 从文件的指定偏移量开始读取count个字节，遇到EINTR或读取不完整时继续读取
+ * @return {ssize_t} 实际读取的字节数，小于count说明读到了文件末尾，出错返回-1
+ */
+static ssize_t pread_full(int fd, char *buf, size_t count, off_t file_offset) {
+    size_t done = 0;
+    while (done < count) {
+        ssize_t n = pread(fd, buf + done, count - done, file_offset + done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) break;  // EOF
+        done += n;
+    }
+    return done;
+}
+
+/**
+ * @description: 向文件的指定偏移量写入count个字节，遇到EINTR或写入不完整时继续写入
+ * @return {ssize_t} 实际写入的字节数，出错返回-1
+ */
+static ssize_t pwrite_full(int fd, const char *buf, size_t count, off_t file_offset) {
+    size_t done = 0;
+    while (done < count) {
+        ssize_t n = pwrite(fd, buf + done, count - done, file_offset + done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        done += n;
+    }
+    return done;
+}
+
+static_assert(PAGE_SIZE % DIRECT_IO_ALIGNMENT == 0, "page offsets must be aligned for O_DIRECT");
+
+static int round_up_to_alignment(int num_bytes) {
+    return (num_bytes + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+}
+
+/**
+ * @description: 按DIRECT_IO_ALIGNMENT对齐的临时缓冲区，用于O_DIRECT文件上未对齐的读写
+ */
+class AlignedBuffer {
+   public:
+    explicit AlignedBuffer(int size) : buf_(static_cast<char *>(std::aligned_alloc(DIRECT_IO_ALIGNMENT, size))) {
+        if (buf_ == nullptr) throw std::bad_alloc();
+    }
+    ~AlignedBuffer() { std::free(buf_); }
+    char *get() { return buf_; }
+
+   private:
+    char *buf_;
+};
+
+/**
+ * @description: 判断以O_DIRECT打开的文件上的读写是否需要经过对齐的临时缓冲区
+ */
+bool DiskManager::needs_bounce(int fd, const char *buf, int num_bytes) const {
+    return is_direct_fd(fd) &&
+           (reinterpret_cast<uintptr_t>(buf) % DIRECT_IO_ALIGNMENT != 0 || num_bytes % DIRECT_IO_ALIGNMENT != 0);
+}
+
+/**
+ * @description: 把一次完成的I/O计入文件的统计
+ * @param {chrono::steady_clock::time_point} start 这次I/O开始的时间
+ */
+void DiskManager::record_io(int fd, bool is_write, size_t num_bytes, std::chrono::steady_clock::time_point start) {
+    FileIoStats *stats = fd >= 0 && fd < MAX_FD ? io_stats_[fd].get() : nullptr;
+    if (stats != nullptr) {
+        stats->record(is_write, num_bytes, std::chrono::steady_clock::now() - start);
+    }
+}
+
 /**
  * 已完成
  * @description: 将数据写入文件的指定磁盘页面中
@@ -19,14 +100,124 @@ DiskManager::DiskManager() { memset(fd2pageno_, 0, MAX_FD * (sizeof(std::atomic<
  * @param {int} num_bytes 要写入磁盘的数据大小
  */
 void DiskManager::write_page(int fd, page_id_t page_no, const char *offset, int num_bytes) {
-    // Todo:
-    // 1.lseek()定位到文件头，通过(fd,page_no)可以定位指定页面及其在磁盘文件中的偏移量
-    lseek(fd, page_no * PAGE_SIZE, SEEK_SET);
-    // 2.调用write()函数
-    int writeSize = write(fd, offset, num_bytes);
-    if (writeSize != num_bytes)
+    // 使用pwrite()按(fd,page_no)对应的偏移量定位写入，不修改fd共享的文件偏移量，可被多个线程同时调用
+    // 注意写入的字节数与num_bytes不等时 throw InternalError("DiskManager::write_page Error");
+    auto start = std::chrono::steady_clock::now();
+    if (CompressedFile *file = compressed_file(fd)) {
+        record_io(fd, true, file->write_page(page_no, offset, num_bytes), start);
+        return;
+    }
+    off_t file_offset = static_cast<off_t>(page_no) * PAGE_SIZE;
+    if (needs_bounce(fd, offset, num_bytes)) {
+        // O_DIRECT要求缓冲区和长度对齐，未对齐时先读出整块，覆盖前num_bytes个字节后再整块写回
+        int len = round_up_to_alignment(num_bytes);
+        AlignedBuffer bounce(len);
+        ssize_t got = pread_full(fd, bounce.get(), len, file_offset);
+        if (got < 0) throw InternalError("DiskManager::write_page Error");
+        memset(bounce.get() + got, 0, len - got);
+        memcpy(bounce.get(), offset, num_bytes);
+        if (pwrite_full(fd, bounce.get(), len, file_offset) != len)
+            throw InternalError("DiskManager::write_page Error");
+        record_io(fd, true, num_bytes, start);
+        return;
+    }
+    if (pwrite_full(fd, offset, num_bytes, file_offset) != num_bytes)
         throw InternalError("DiskManager::write_page Error");
-    // 注意write返回值与num_bytes不等时 throw InternalError("DiskManager::write_page Error");
+    record_io(fd, true, num_bytes, start);
+}
+
+/**
+ * @description: 把编号连续的多个整页一次性写入文件，使用pwritev合并为一次顺序I/O
+ * @param {int} fd 磁盘文件的文件句柄
+ * @param {page_id_t} first_page_no 第一个页面的编号，pages[i]写入first_page_no + i
+ * @param {vector<const char *>} &pages 每个页面的数据，长度均为PAGE_SIZE
+ */
+void DiskManager::write_page_run(int fd, page_id_t first_page_no, const std::vector<const char *> &pages) {
+    for (const char *page : pages) {
+        // 压缩存储的文件中每个页面写入各自的extent；O_DIRECT下存在未对齐的缓冲区时也逐页写入
+        if (is_compressed(fd) || needs_bounce(fd, page, PAGE_SIZE)) {
+            for (size_t i = 0; i < pages.size(); i++) {
+                write_page(fd, first_page_no + static_cast<page_id_t>(i), pages[i], PAGE_SIZE);
+            }
+            return;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<iovec> iov(pages.size());
+    for (size_t i = 0; i < pages.size(); i++) {
+        iov[i].iov_base = const_cast<char *>(pages[i]);
+        iov[i].iov_len = PAGE_SIZE;
+    }
+    off_t file_offset = static_cast<off_t>(first_page_no) * PAGE_SIZE;
+    size_t next = 0;
+    while (next < iov.size()) {
+        int cnt = static_cast<int>(std::min<size_t>(iov.size() - next, IOV_MAX));
+        ssize_t n = pwritev(fd, &iov[next], cnt, file_offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw InternalError("DiskManager::write_page_run Error");
+        }
+        if (n == 0) throw InternalError("DiskManager::write_page_run Error");
+        file_offset += n;
+        // 跳过已经写完的页面，写了一半的页面调整起始地址后继续写
+        while (n > 0 && static_cast<size_t>(n) >= iov[next].iov_len) {
+            n -= iov[next].iov_len;
+            next++;
+        }
+        if (n > 0) {
+            iov[next].iov_base = static_cast<char *>(iov[next].iov_base) + n;
+            iov[next].iov_len -= n;
+        }
+    }
+    record_io(fd, true, pages.size() * PAGE_SIZE, start);
+}
+
+/**
+ * @description: 把文件中编号连续的多个整页一次性读入内存，使用preadv合并为一次顺序I/O
+ * @param {int} fd 磁盘文件的文件句柄
+ * @param {page_id_t} first_page_no 第一个页面的编号，first_page_no + i读入pages[i]
+ * @param {vector<char *>} &pages 每个页面的目标缓冲区，长度均为PAGE_SIZE
+ */
+void DiskManager::read_page_run(int fd, page_id_t first_page_no, const std::vector<char *> &pages) {
+    for (char *page : pages) {
+        // 压缩存储的文件逐页读取并解压；O_DIRECT下存在未对齐的缓冲区时也逐页读取
+        if (is_compressed(fd) || needs_bounce(fd, page, PAGE_SIZE)) {
+            for (size_t i = 0; i < pages.size(); i++) {
+                read_page(fd, first_page_no + static_cast<page_id_t>(i), pages[i], PAGE_SIZE);
+            }
+            return;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<iovec> iov(pages.size());
+    for (size_t i = 0; i < pages.size(); i++) {
+        iov[i].iov_base = pages[i];
+        iov[i].iov_len = PAGE_SIZE;
+    }
+    off_t file_offset = static_cast<off_t>(first_page_no) * PAGE_SIZE;
+    size_t next = 0;
+    while (next < iov.size()) {
+        int cnt = static_cast<int>(std::min<size_t>(iov.size() - next, IOV_MAX));
+        ssize_t n = preadv(fd, &iov[next], cnt, file_offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw InternalError("DiskManager::read_page_run Error");
+        }
+        if (n == 0) throw InternalError("DiskManager::read_page_run Error");  // 读到了文件末尾之后
+        file_offset += n;
+        // 跳过已经读完的页面，读了一半的页面调整起始地址后继续读
+        while (n > 0 && static_cast<size_t>(n) >= iov[next].iov_len) {
+            n -= iov[next].iov_len;
+            next++;
+        }
+        if (n > 0) {
+            iov[next].iov_base = static_cast<char *>(iov[next].iov_base) + n;
+            iov[next].iov_len -= n;
+        }
+    }
+    record_io(fd, false, pages.size() * PAGE_SIZE, start);
 }
 
 /**
@@ -38,14 +229,27 @@ void DiskManager::write_page(int fd, page_id_t page_no, const char *offset, int
  * @param {int} num_bytes 读取的数据量大小
  */
 void DiskManager::read_page(int fd, page_id_t page_no, char *offset, int num_bytes) {
-    // Todo:
-    // 1.lseek()定位到文件头，通过(fd,page_no)可以定位指定页面及其在磁盘文件中的偏移量
-    lseek(fd, page_no * PAGE_SIZE, SEEK_SET);
-    // 2.调用read()函数
-    int readSize = read(fd, offset, num_bytes);
-    if (readSize != num_bytes)
+    // 使用pread()按(fd,page_no)对应的偏移量定位读取，不修改fd共享的文件偏移量，可被多个线程同时调用
+    // 注意读取的字节数与num_bytes不等时，throw InternalError("DiskManager::read_page Error");
+    auto start = std::chrono::steady_clock::now();
+    if (CompressedFile *file = compressed_file(fd)) {
+        record_io(fd, false, file->read_page(page_no, offset, num_bytes), start);
+        return;
+    }
+    off_t file_offset = static_cast<off_t>(page_no) * PAGE_SIZE;
+    if (needs_bounce(fd, offset, num_bytes)) {
+        // O_DIRECT要求缓冲区和长度对齐，未对齐时先读到对齐的临时缓冲区
+        int len = round_up_to_alignment(num_bytes);
+        AlignedBuffer bounce(len);
+        if (pread_full(fd, bounce.get(), len, file_offset) < num_bytes)
+            throw InternalError("DiskManager::read_page Error");
+        memcpy(offset, bounce.get(), num_bytes);
+        record_io(fd, false, num_bytes, start);
+        return;
+    }
+    if (pread_full(fd, offset, num_bytes, file_offset) != num_bytes)
         throw InternalError("DiskManager::read_page Error");
-    // 注意read返回值与num_bytes不等时，throw InternalError("DiskManager::read_page Error");
+    record_io(fd, false, num_bytes, start);
 }
 
 /**
@@ -55,12 +259,356 @@ void DiskManager::read_page(int fd, page_id_t page_no, char *offset, int num_byt
  * @param {int} fd 指定文件的文件句柄
  */
 page_id_t DiskManager::allocate_page(int fd) {
-    // 简单的自增分配策略，指定文件的页面编号加1
+    // 优先复用空闲页面中编号最小的页面，没有空闲页面时指定文件的页面编号加1
     assert(fd >= 0 && fd < MAX_FD);
+    FreePageMap *map = free_pages_[fd].get();
+    if (map == nullptr) {
+        return fd2pageno_[fd]++;
+    }
+    std::unique_lock lock{map->latch};
+    invalidate_free_page_map(*map);
+    if (!map->pages.empty()) {
+        page_id_t page_no = *map->pages.begin();
+        map->pages.erase(map->pages.begin());
+        map->num_free = map->pages.size();
+        return page_no;
+    }
     return fd2pageno_[fd]++;
 }
 
-void DiskManager::deallocate_page(__attribute__((unused)) page_id_t page_id) {}
+/**
+ * @description: 释放文件中的一个页面，之后allocate_page()会复用该页面
+ * 文件末尾连续的空闲页面不进入空闲页面表，而是直接把文件截断
+ * 调用者需要保证缓冲池中已经没有该页面(见BufferPoolManager::deallocate_page)
+ * @param {int} fd 磁盘文件的文件句柄
+ * @param {page_id_t} page_no 要释放的页面编号
+ */
+void DiskManager::deallocate_page(int fd, page_id_t page_no) {
+    assert(fd >= 0 && fd < MAX_FD);
+    FreePageMap *map = free_pages_[fd].get();
+    assert(map != nullptr);
+    std::unique_lock lock{map->latch};
+    page_id_t num_pages = fd2pageno_[fd];
+    if (page_no < 0 || page_no >= num_pages) {
+        return;
+    }
+    invalidate_free_page_map(*map);
+    auto &free_pages = map->pages;
+    free_pages.insert(page_no);
+    CompressedFile *file = compressed_file(fd);
+    if (file != nullptr) {
+        file->discard_page(page_no);
+    }
+    while (num_pages > 0 && !free_pages.empty() && *free_pages.rbegin() == num_pages - 1) {
+        free_pages.erase(std::prev(free_pages.end()));
+        num_pages--;
+    }
+    map->num_free = free_pages.size();
+    if (num_pages == fd2pageno_[fd]) {
+        return;
+    }
+    fd2pageno_[fd] = num_pages;
+    if (file != nullptr) {
+        return;  // 压缩存储的文件中页面的位置与编号无关，不截断
+    }
+    struct stat st;
+    off_t new_size = static_cast<off_t>(num_pages) * PAGE_SIZE;
+    if (fstat(fd, &st) == 0 && st.st_size > new_size && ftruncate(fd, new_size) < 0) {
+        throw UnixError();
+    }
+}
+
+/**
+ * @description: 判断页面是否已经被释放且还没有被重新分配
+ * 每次读取页面和记录时都会调用，只加该文件空闲页面表的共享锁，没有空闲页面时不加锁
+ */
+bool DiskManager::is_free_page(int fd, page_id_t page_no) {
+    FreePageMap *map = fd >= 0 && fd < MAX_FD ? free_pages_[fd].get() : nullptr;
+    if (map == nullptr || map->num_free == 0) {
+        return false;
+    }
+    std::shared_lock lock{map->latch};
+    return map->pages.count(page_no) > 0;
+}
+
+/**
+ * @description: 获得文件中空闲页面的个数（不包括已经被截断的页面）
+ */
+size_t DiskManager::get_num_free_pages(int fd) {
+    FreePageMap *map = fd >= 0 && fd < MAX_FD ? free_pages_[fd].get() : nullptr;
+    return map == nullptr ? 0 : map->num_free.load();
+}
+
+/**
+ * @description: 把文件的空闲页面表写入.fsm，与缓冲池写回文件的所有页面一起调用(见BufferPoolManager::flush_all_pages)
+ * 上次写回之后没有修改时什么都不做
+ * @param {int} fd 数据文件的文件句柄
+ */
+void DiskManager::flush_free_page_map(int fd) {
+    FreePageMap *map = fd >= 0 && fd < MAX_FD ? free_pages_[fd].get() : nullptr;
+    if (map == nullptr || map->path.empty()) {
+        return;
+    }
+    std::unique_lock lock{map->latch};
+    save_free_page_map(*map, fd);
+}
+
+/**
+ * @description: 从空闲页面表文件中恢复文件已分配的页面个数和空闲页面，文件不存在时什么都不做
+ * 空闲页面表文件的格式为：已分配的页面个数 | 空闲页面个数 | 空闲页面编号...
+ * @param {int} fd 数据文件的文件句柄
+ * @param {string} &path 数据文件所在路径
+ */
+void DiskManager::load_free_page_map(int fd, const std::string &path) {
+    if (free_pages_[fd] == nullptr) {
+        free_pages_[fd] = std::make_unique<FreePageMap>();
+    }
+    FreePageMap &map = *free_pages_[fd];
+    std::unique_lock lock{map.latch};
+    map.path = path + FREE_PAGE_MAP_SUFFIX;
+    map.pages.clear();
+    map.num_free = 0;
+    map.saved = false;
+    std::ifstream in(map.path, std::ios::binary);
+    if (!in.is_open()) {
+        return;
+    }
+    page_id_t num_pages;
+    int num_free;
+    if (!in.read(reinterpret_cast<char *>(&num_pages), sizeof(num_pages)) ||
+        !in.read(reinterpret_cast<char *>(&num_free), sizeof(num_free))) {
+        return;
+    }
+    std::set<page_id_t> free_pages;
+    for (int i = 0; i < num_free; i++) {
+        page_id_t page_no;
+        if (!in.read(reinterpret_cast<char *>(&page_no), sizeof(page_no))) {
+            return;
+        }
+        if (page_no >= 0 && page_no < num_pages) free_pages.insert(page_no);
+    }
+    fd2pageno_[fd] = num_pages;
+    map.pages = std::move(free_pages);
+    map.num_free = map.pages.size();
+    map.saved = true;
+}
+
+/**
+ * @description: 把文件已分配的页面个数和空闲页面写入空闲页面表文件，调用者需持有map.latch的排他锁
+ * 先写入临时文件再改名，崩溃时磁盘上要么是完整的新.fsm，要么没有.fsm
+ * @param {FreePageMap&} map 文件的空闲页面表
+ * @param {int} fd 数据文件的文件句柄
+ */
+void DiskManager::save_free_page_map(FreePageMap &map, int fd) {
+    if (map.saved) {
+        return;
+    }
+    std::string tmp_path = map.path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            throw UnixError();
+        }
+        page_id_t num_pages = fd2pageno_[fd];
+        int num_free = static_cast<int>(map.pages.size());
+        out.write(reinterpret_cast<const char *>(&num_pages), sizeof(num_pages));
+        out.write(reinterpret_cast<const char *>(&num_free), sizeof(num_free));
+        for (page_id_t page_no : map.pages) {
+            out.write(reinterpret_cast<const char *>(&page_no), sizeof(page_no));
+        }
+        if (!out.flush()) {
+            throw UnixError();
+        }
+    }
+    if (rename(tmp_path.c_str(), map.path.c_str()) < 0) {
+        throw UnixError();
+    }
+    map.saved = true;
+}
+
+/**
+ * @description: 空闲页面表在写回之后第一次修改时删除磁盘上的.fsm，调用者需持有map.latch的排他锁
+ * 过时的.fsm可能把已经重新分配的页面记为空闲，或者记录了过小的已分配页面个数
+ */
+void DiskManager::invalidate_free_page_map(FreePageMap &map) {
+    if (!map.saved) {
+        return;
+    }
+    if (unlink(map.path.c_str()) < 0 && errno != ENOENT) {
+        throw UnixError();
+    }
+    map.saved = false;
+}
+
+/**
+ * @description: 尝试开启io_uring异步I/O
+ * @return {bool} 是否开启成功，内核不支持io_uring时返回false，之后的异步接口退化为同步I/O
+ * @param {unsigned} queue_depth 同时在途的最大I/O请求数
+ */
+bool DiskManager::enable_async_io(unsigned queue_depth) {
+    std::scoped_lock lock{async_latch_};
+    if (ring_ != nullptr) {
+        return true;
+    }
+    auto ring = std::make_unique<IoUring>();
+    if (!ring->init(queue_depth)) {
+        return false;
+    }
+    ring_ = std::move(ring);
+    return true;
+}
+
+/**
+ * @description: 提交一个异步读页面请求，请求完成后tag会由poll_completions()返回
+ * @note 在请求完成之前，offset指向的内存必须保持有效
+ */
+void DiskManager::submit_read_page(int fd, page_id_t page_no, char *offset, int num_bytes, uint64_t tag) {
+    submit_async(false, fd, page_no, offset, num_bytes, tag, nullptr);
+}
+
+/**
+ * @description: 提交一个异步写页面请求，请求完成后tag会由poll_completions()返回
+ * @note 在请求完成之前，offset指向的内存必须保持有效且不能被修改
+ */
+void DiskManager::submit_write_page(int fd, page_id_t page_no, const char *offset, int num_bytes, uint64_t tag) {
+    submit_async(true, fd, page_no, const_cast<char *>(offset), num_bytes, tag, nullptr);
+}
+
+/**
+ * @description: 将已经排队的异步请求一次性交给内核
+ * @return {int} 本次交给内核的请求个数
+ */
+int DiskManager::submit_async_io() {
+    std::scoped_lock lock{async_latch_};
+    if (ring_ == nullptr) {
+        return 0;
+    }
+    int ret = ring_->submit(0);
+    if (ret < 0) {
+        throw InternalError("DiskManager::submit_async_io Error");
+    }
+    return ret;
+}
+
+/**
+ * @description: 获取已经完成的异步请求
+ * @return {int} 取出的请求个数
+ * @param {vector<uint64_t>*} tags 取出的请求的tag
+ * @param {size_t} min_complete 至少等待min_complete个请求完成（不超过在途请求数）
+ */
+int DiskManager::poll_completions(std::vector<uint64_t> *tags, size_t min_complete) {
+    std::scoped_lock lock{async_latch_};
+    if (ring_ != nullptr) {
+        size_t need = completed_.size() >= min_complete ? 0 : min_complete - completed_.size();
+        reap_completions(need);
+    }
+    int num = completed_.size();
+    tags->insert(tags->end(), completed_.begin(), completed_.end());
+    completed_.clear();
+    return num;
+}
+
+/**
+ * @description: 批量读取多个页面，所有请求一次提交，函数返回时全部读取完成
+ */
+void DiskManager::read_pages(const std::vector<PageIoRequest> &requests) { run_batch(false, requests); }
+
+/**
+ * @description: 批量写入多个页面，所有请求一次提交，函数返回时全部写入完成
+ */
+void DiskManager::write_pages(const std::vector<PageIoRequest> &requests) { run_batch(true, requests); }
+
+void DiskManager::run_batch(bool is_write, const std::vector<PageIoRequest> &requests) {
+    if (ring_ == nullptr) {
+        for (auto &req : requests) {
+            if (is_write) {
+                write_page(req.fd, req.page_no, req.data, req.num_bytes);
+            } else {
+                read_page(req.fd, req.page_no, req.data, req.num_bytes);
+            }
+        }
+        return;
+    }
+    auto remaining = std::make_shared<size_t>(requests.size());
+    for (auto &req : requests) {
+        submit_async(is_write, req.fd, req.page_no, req.data, req.num_bytes, 0, remaining);
+    }
+    std::scoped_lock lock{async_latch_};
+    while (*remaining > 0) {
+        reap_completions(1);
+    }
+}
+
+void DiskManager::submit_async(bool is_write, int fd, page_id_t page_no, char *data, int num_bytes, uint64_t tag,
+                               const std::shared_ptr<size_t> &batch_remaining) {
+    std::scoped_lock lock{async_latch_};
+    off_t file_offset = static_cast<off_t>(page_no) * PAGE_SIZE;
+    if (ring_ != nullptr && !needs_bounce(fd, data, num_bytes) && !is_compressed(fd)) {
+        // 在途请求数不能超过队列长度，否则完成队列可能溢出
+        while (inflight_.size() >= ring_->capacity()) {
+            reap_completions(1);
+        }
+        uint64_t seq = next_async_seq_;
+        bool ok = is_write ? ring_->prepare_write(fd, data, num_bytes, file_offset, seq)
+                           : ring_->prepare_read(fd, data, num_bytes, file_offset, seq);
+        if (ok) {
+            next_async_seq_++;
+            inflight_[seq] = {is_write, fd, file_offset, data, num_bytes, tag, batch_remaining,
+                              std::chrono::steady_clock::now()};
+            return;
+        }
+        // 提交队列中没有空位时，这个请求改为同步I/O
+    }
+    if (is_write) {
+        write_page(fd, page_no, data, num_bytes);
+    } else {
+        read_page(fd, page_no, data, num_bytes);
+    }
+    if (batch_remaining != nullptr) {
+        (*batch_remaining)--;
+    } else {
+        completed_.push_back(tag);
+    }
+}
+
+/**
+ * @description: 提交排队的请求并收割已完成的请求，调用者需持有async_latch_
+ * @param {size_t} min_complete 至少等待min_complete个请求完成
+ */
+void DiskManager::reap_completions(size_t min_complete) {
+    min_complete = std::min(min_complete, inflight_.size());
+    if (ring_->submit(min_complete) < 0) {
+        throw InternalError("DiskManager::reap_completions Error");
+    }
+    uint64_t seq;
+    int res;
+    while (ring_->peek_completion(&seq, &res)) {
+        auto it = inflight_.find(seq);
+        assert(it != inflight_.end());
+        AsyncIoSlot slot = it->second;
+        inflight_.erase(it);
+        if (res != slot.num_bytes) {
+            // 内核不支持该操作时整体改为同步I/O，读写不完整时同步补齐剩余部分
+            int done = res == -EINVAL || res == -EOPNOTSUPP ? 0 : res;
+            ssize_t rest = -1;
+            if (done >= 0) {
+                rest = slot.is_write ? pwrite_full(slot.fd, slot.data + done, slot.num_bytes - done,
+                                                   slot.file_offset + done)
+                                     : pread_full(slot.fd, slot.data + done, slot.num_bytes - done,
+                                                  slot.file_offset + done);
+            }
+            if (rest != slot.num_bytes - done) {
+                throw InternalError(slot.is_write ? "DiskManager::write_page Error" : "DiskManager::read_page Error");
+            }
+        }
+        record_io(slot.fd, slot.is_write, slot.num_bytes, slot.start);
+        if (slot.batch_remaining != nullptr) {
+            (*slot.batch_remaining)--;
+        } else {
+            completed_.push_back(slot.tag);
+        }
+    }
+}
 
 bool DiskManager::is_dir(const std::string& path) {
     struct stat st;
@@ -99,15 +647,18 @@ bool DiskManager::is_file(const std::string &path) {
  * @description: 用于创建指定路径文件
  * @return {*}
  * @param {string} &path
+ * @param {bool} compressed 是否创建压缩存储的文件(见CompressedFile)
  */
-void DiskManager::create_file(const std::string &path) {
+void DiskManager::create_file(const std::string &path, bool compressed) {
     // Todo:
     // 调用open()函数，使用O_CREAT模式
     // 注意不能重复创建相同文件
     if (!is_file(path)) {
         umask(0000);
-        int fd = open(path.c_str(), O_CREAT, 0777);
+        int fd = open(path.c_str(), O_CREAT | O_RDWR, 0777);
+        if (compressed) CompressedFile::format(fd);
         close(fd); //经过测试，如果不手动关闭的话，创建一个不存在的文件后此文件会一直处于open状态
+        unlink((path + FREE_PAGE_MAP_SUFFIX).c_str());  // 清除同名旧文件遗留的空闲页面表
     }
     else throw FileExistsError(path);
 }
@@ -122,8 +673,10 @@ void DiskManager::destroy_file(const std::string &path) {
     // 调用unlink()函数
     // 注意不能删除未关闭的文件
     if (!is_file(path)) throw FileNotFoundError(path);
-    if (path2fd_[path] == 0) //如果该文件没打开
+    if (path2fd_[path] == 0) { //如果该文件没打开
         unlink(path.c_str());
+        unlink((path + FREE_PAGE_MAP_SUFFIX).c_str());
+    }
     else throw FileNotClosedError(path);
 }
 
@@ -141,9 +694,32 @@ int DiskManager::open_file(const std::string &path) {
     // 更新文件打开列表
     if (!is_file(path)) throw FileNotFoundError(path);
     if (path2fd_[path] == 0) {
-        int fd = open(path.c_str(), O_RDWR);
+        // 日志文件按任意长度追加写，压缩存储的文件按扇区读写，都不使用O_DIRECT；文件系统不支持O_DIRECT时(如tmpfs)退回普通模式
+        bool compressed = path != LOG_FILE_NAME && CompressedFile::is_compressed_file(path);
+        bool direct = direct_io_ && path != LOG_FILE_NAME && !compressed;
+        int fd = open(path.c_str(), O_RDWR | (direct ? O_DIRECT : 0));
+        if (fd < 0 && direct && errno == EINVAL) {
+            direct = false;
+            fd = open(path.c_str(), O_RDWR);
+        }
+        if (fd < 0) throw UnixError();
+        if (compressed) {
+            try {
+                fd_compressed_[fd] = std::make_unique<CompressedFile>(fd);
+            } catch (...) {
+                close(fd);
+                throw;
+            }
+        }
         path2fd_[path] = fd;
         fd2path_[fd] = path;
+        fd_direct_[fd] = direct;
+        if (io_stats_[fd] == nullptr) {
+            io_stats_[fd] = std::make_unique<FileIoStats>();
+        } else {
+            io_stats_[fd]->reset();
+        }
+        if (path != LOG_FILE_NAME) load_free_page_map(fd, path);
         return fd;
     }
     else return path2fd_[path];
@@ -160,7 +736,19 @@ void DiskManager::close_file(int fd) {
     // 注意不能关闭未打开的文件
     // 更新文件打开列表
     if (fd2path_[fd] != "") {    //说明该文件正被打开
+        if (fd2path_[fd] != LOG_FILE_NAME) {
+            FreePageMap &map = *free_pages_[fd];
+            std::unique_lock lock{map.latch};
+            save_free_page_map(map, fd);
+            map.path.clear();
+            map.pages.clear();
+            map.num_free = 0;
+            map.saved = false;
+        }
         close(fd);
+        fd_direct_[fd] = false;
+        fd_checksums_[fd] = false;
+        fd_compressed_[fd].reset();
         path2fd_[fd2path_[fd]] = 0;
         fd2path_[fd] = "";
     }
@@ -193,6 +781,18 @@ std::string DiskManager::get_file_name(int fd) {
     return fd2path_[fd];
 }
 
+/**
+ * @description: 获得所有已经打开的文件的文件句柄，按句柄升序排列
+ */
+std::vector<int> DiskManager::get_open_fds() {
+    std::vector<int> fds;
+    for (auto &entry : fd2path_) {
+        if (!entry.second.empty()) fds.push_back(entry.first);
+    }
+    std::sort(fds.begin(), fds.end());
+    return fds;
+}
+
 /**
  * 已完成（官方）
  * @description:  获得文件名对应的文件句柄
@@ -227,9 +827,10 @@ int DiskManager::read_log(char *log_data, int size, int offset) {
 
     size = std::min(size, file_size - offset);
     if(size == 0) return 0;
-    lseek(log_fd_, offset, SEEK_SET);
-    ssize_t bytes_read = read(log_fd_, log_data, size);
+    auto start = std::chrono::steady_clock::now();
+    ssize_t bytes_read = pread_full(log_fd_, log_data, size, offset);
     assert(bytes_read == size);
+    record_io(log_fd_, false, bytes_read, start);
     return bytes_read;
 }
 
@@ -246,9 +847,11 @@ void DiskManager::write_log(char *log_data, int size) {
     }
 
     // write from the file_end
+    auto start = std::chrono::steady_clock::now();
     lseek(log_fd_, 0, SEEK_END);
     ssize_t bytes_write = write(log_fd_, log_data, size);
     if (bytes_write != size) {
         throw UnixError();
     }
+    record_io(log_fd_, true, size, start);
 }
\ No newline at end of file
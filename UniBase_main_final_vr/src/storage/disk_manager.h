@@ -5,13 +5,33 @@
 #include <unistd.h>    
 
 #include <atomic>
+#include <chrono>
+#include <deque>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "common/config.h"
 #include "errors.h"  
+#include "storage/compressed_file.h"
+#include "storage/io_uring_backend.h"
+#include "storage/storage_stats.h"
+
+/**
+ * @description: 批量页面I/O请求，用于DiskManager::read_pages/write_pages
+ */
+struct PageIoRequest {
+    int fd;             // 磁盘文件的文件句柄
+    page_id_t page_no;  // 读写的页面编号
+    char *data;         // 读取的目标缓冲区/要写入的数据
+    int num_bytes;      // 读写的数据大小
+};
 
 /**
  * @description: DiskManager的作用主要是根据上层的需要对磁盘文件进行操作
@@ -26,9 +46,53 @@ class DiskManager {
 
     void read_page(int fd, page_id_t page_no, char *offset, int num_bytes);
 
+    void write_page_run(int fd, page_id_t first_page_no, const std::vector<const char *> &pages);
+
+    void read_page_run(int fd, page_id_t first_page_no, const std::vector<char *> &pages);
+
     page_id_t allocate_page(int fd);
 
-    void deallocate_page(page_id_t page_id);
+    void deallocate_page(int fd, page_id_t page_no);
+
+    bool is_free_page(int fd, page_id_t page_no);
+
+    size_t get_num_free_pages(int fd);
+
+    void flush_free_page_map(int fd);
+
+    /*异步页面I/O操作，未开启io_uring时退化为同步I/O*/
+    bool enable_async_io(unsigned queue_depth);
+
+    bool is_async_io_enabled() const { return ring_ != nullptr; }
+
+    void submit_read_page(int fd, page_id_t page_no, char *offset, int num_bytes, uint64_t tag);
+
+    void submit_write_page(int fd, page_id_t page_no, const char *offset, int num_bytes, uint64_t tag);
+
+    int submit_async_io();
+
+    int poll_completions(std::vector<uint64_t> *tags, size_t min_complete);
+
+    void read_pages(const std::vector<PageIoRequest> &requests);
+
+    void write_pages(const std::vector<PageIoRequest> &requests);
+
+    /*O_DIRECT模式，只对之后打开的表和索引文件生效*/
+    void set_direct_io(bool enable) { direct_io_ = enable; }
+
+    bool is_direct_io() const { return direct_io_; }
+
+    bool is_direct_fd(int fd) const { return fd >= 0 && fd < MAX_FD && fd_direct_[fd]; }
+
+    /*页面校验和，只对打开的文件生效，关闭文件时清除；由表和索引文件在打开后开启，缓冲池写回时计算、读入时校验*/
+    void set_page_checksums(int fd, bool enable) { fd_checksums_[fd] = enable; }
+
+    bool has_page_checksums(int fd) const { return fd >= 0 && fd < MAX_FD && fd_checksums_[fd]; }
+
+    /*压缩存储的文件，由文件头识别，打开时自动开启；页面读写时透明地解压和压缩*/
+    bool is_compressed(int fd) const { return compressed_file(fd) != nullptr; }
+
+    CompressedFile *compressed_file(int fd) const { return fd >= 0 && fd < MAX_FD ? fd_compressed_[fd].get() : nullptr; }
 
     /*目录操作*/
     bool is_dir(const std::string &path);
@@ -40,7 +104,7 @@ class DiskManager {
     /*文件操作*/
     bool is_file(const std::string &path);
 
-    void create_file(const std::string &path);
+    void create_file(const std::string &path, bool compressed = false);
 
     void destroy_file(const std::string &path);
 
@@ -52,6 +116,8 @@ class DiskManager {
 
     std::string get_file_name(int fd);
 
+    std::vector<int> get_open_fds();
+
     int get_file_fd(const std::string &file_name);
 
     /*日志操作*/
@@ -77,13 +143,77 @@ class DiskManager {
      */
     page_id_t get_fd2pageno(int fd) { return fd2pageno_[fd]; }
 
+    /**
+     * @description: 获得文件从打开以来的I/O统计
+     * @return {const FileIoStats*} 文件没有通过open_file打开过时返回nullptr
+     * @param {int} fd 文件句柄
+     */
+    const FileIoStats *get_io_stats(int fd) const { return fd >= 0 && fd < MAX_FD ? io_stats_[fd].get() : nullptr; }
+
     static constexpr int MAX_FD = 8192;
 
+    static constexpr const char *FREE_PAGE_MAP_SUFFIX = ".fsm";  // 空闲页面表文件的后缀
+
    private:
+    bool needs_bounce(int fd, const char *buf, int num_bytes) const;
+
+    void record_io(int fd, bool is_write, size_t num_bytes, std::chrono::steady_clock::time_point start);
+
     // 文件打开列表，用于记录文件是否被打开
     std::unordered_map<std::string, int> path2fd_;  //<Page文件磁盘路径,Page fd>哈希表
     std::unordered_map<int, std::string> fd2path_;  //<Page fd,Page文件磁盘路径>哈希表
 
     int log_fd_ = -1;                             // WAL日志文件的文件句柄，默认为-1，代表未打开日志文件
+    bool direct_io_ = false;                      // 打开表和索引文件时是否使用O_DIRECT
+    bool fd_direct_[MAX_FD]{};                    // 文件是否以O_DIRECT方式打开
+    std::atomic<bool> fd_checksums_[MAX_FD]{};    // 文件的页面是否带有校验和
+    std::unique_ptr<CompressedFile> fd_compressed_[MAX_FD];  // 压缩存储的文件，其他文件为nullptr
     std::atomic<page_id_t> fd2pageno_[MAX_FD]{};  // 文件中已经分配的页面个数，初始值为0
+    std::unique_ptr<FileIoStats> io_stats_[MAX_FD];  // 文件的I/O统计，第一次打开时分配，重新打开时清零
+
+    // 空闲页面表，记录一个打开的文件中已经释放、可以被allocate_page()复用的页面
+    // 打开文件时从"<文件名>.fsm"中恢复，写回文件的所有页面(flush_free_page_map)和关闭文件时写回
+    // 磁盘上的.fsm只在与内存一致时存在：写回之后第一次修改时删除，崩溃后空闲页面只是不能复用，
+    // 而不会把已经重新分配的页面当作空闲页面
+    struct FreePageMap {
+        std::string path;                       // .fsm文件的路径
+        std::shared_mutex latch;                // 保护pages和saved，分配和释放页面时为排他锁
+        std::set<page_id_t> pages;
+        std::atomic<size_t> num_free{0};        // pages的大小，为0时is_free_page不加锁
+        bool saved = false;                     // 磁盘上的.fsm与pages一致
+    };
+
+    void load_free_page_map(int fd, const std::string &path);
+
+    void save_free_page_map(FreePageMap &map, int fd);
+
+    void invalidate_free_page_map(FreePageMap &map);
+
+    // 每个文件的空闲页面表，第一次打开时分配，之后不再释放，查询时不需要全局锁
+    std::unique_ptr<FreePageMap> free_pages_[MAX_FD];
+
+    // 已经提交给io_uring但还没有完成的异步请求
+    struct AsyncIoSlot {
+        bool is_write;
+        int fd;
+        off_t file_offset;
+        char *data;
+        int num_bytes;
+        uint64_t tag;       // 上层指定的标识，完成后放入completed_
+        std::shared_ptr<size_t> batch_remaining;    // 属于read_pages/write_pages的请求，完成后计数减一，不放入completed_
+        std::chrono::steady_clock::time_point start;  // 提交时间，用于统计I/O延迟
+    };
+
+    void submit_async(bool is_write, int fd, page_id_t page_no, char *data, int num_bytes, uint64_t tag,
+                      const std::shared_ptr<size_t> &batch_remaining);
+
+    void reap_completions(size_t min_complete);
+
+    void run_batch(bool is_write, const std::vector<PageIoRequest> &requests);
+
+    std::unique_ptr<IoUring> ring_;                     // 为nullptr说明没有开启异步I/O
+    std::mutex async_latch_;                            // 保护ring_、inflight_和completed_
+    std::unordered_map<uint64_t, AsyncIoSlot> inflight_;
+    std::deque<uint64_t> completed_;                    // 已经完成但还没有被poll_completions()取走的请求
+    uint64_t next_async_seq_ = 0;
 };
\ No newline at end of file
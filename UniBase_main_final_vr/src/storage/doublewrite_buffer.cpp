@@ -0,0 +1,265 @@
+#include "storage/doublewrite_buffer.h"
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <map>
+
+#include "storage/page_checksum.h"
+
+namespace {
+
+// 从offset开始把iov中的数据全部写入fd，处理部分写入
+void pwritev_all(int fd, std::vector<iovec> iov, off_t offset) {
+    size_t next = 0;
+    while (next < iov.size()) {
+        int cnt = static_cast<int>(std::min<size_t>(iov.size() - next, IOV_MAX));
+        ssize_t n = pwritev(fd, &iov[next], cnt, offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw UnixError();
+        }
+        offset += n;
+        while (n > 0 && static_cast<size_t>(n) >= iov[next].iov_len) {
+            n -= iov[next].iov_len;
+            next++;
+        }
+        if (n > 0) {
+            iov[next].iov_base = static_cast<char *>(iov[next].iov_base) + n;
+            iov[next].iov_len -= n;
+        }
+    }
+}
+
+// 从offset开始读取最多len个字节，返回实际读到的字节数(遇到文件末尾时较少)
+size_t pread_all(int fd, char *buf, size_t len, off_t offset) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pread(fd, buf + done, len - done, offset + done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw UnixError();
+        }
+        if (n == 0) break;
+        done += n;
+    }
+    return done;
+}
+
+}  // namespace
+
+DoublewriteBuffer::DoublewriteBuffer(DiskManager *disk_manager, const std::string &path, size_t capacity)
+    : disk_manager_(disk_manager), path_(path), capacity_(capacity) {
+    if (capacity_ < 2) {
+        throw InternalError("DoublewriteBuffer: capacity must be at least 2 pages");
+    }
+    dw_fd_ = open(path.c_str(), O_RDWR | O_CREAT, 0600);
+    if (dw_fd_ < 0) {
+        throw UnixError();
+    }
+}
+
+DoublewriteBuffer::~DoublewriteBuffer() {
+    try {
+        sync_data_files();
+    } catch (...) {
+        // 析构时无法报告错误，下次启动时recover()仍然可以使用doublewrite文件中的副本
+    }
+    close(dw_fd_);
+}
+
+/**
+ * @description: 修复写了一半的页面：同一个页面只看序号最大的完整记录，数据文件中的页面校验和不正确时用记录中的副本覆盖
+ *              在数据文件被打开使用之前调用；记录中出现的数据文件全部同步之后清空doublewrite文件，
+ *              这些记录不会在之后的恢复中再被使用，新的记录从doublewrite文件开头写入
+ * @return {size_t} 修复的页面数
+ */
+size_t DoublewriteBuffer::recover() {
+    std::scoped_lock lock{latch_};
+    off_t size = lseek(dw_fd_, 0, SEEK_END);
+    if (size < 0) {
+        throw UnixError();
+    }
+    size_t num_slots = static_cast<size_t>(size) / PAGE_SIZE;
+    std::vector<char> buf(num_slots * PAGE_SIZE);
+    num_slots = pread_all(dw_fd_, buf.data(), buf.size(), 0) / PAGE_SIZE;
+
+    // 扫描所有完整的记录；同一个页面可能出现在多条记录中
+    std::map<std::pair<std::string, page_id_t>, std::pair<uint64_t, const char *>> newest;
+    uint64_t max_seq = 0;
+    for (size_t slot = 0; slot < num_slots;) {
+        RecordHdr hdr;
+        memcpy(&hdr, &buf[slot * PAGE_SIZE], sizeof(hdr));
+        bool valid = hdr.magic == RecordHdr::MAGIC && hdr.num_pages > 0 && slot + 1 + hdr.num_pages <= num_slots &&
+                     memchr(hdr.file_name, '\0', sizeof(hdr.file_name)) != nullptr;
+        if (valid) {
+            RecordHdr unsigned_hdr = hdr;
+            unsigned_hdr.checksum = 0;
+            uint32_t crc = crc32c(&unsigned_hdr, sizeof(unsigned_hdr));
+            valid = crc32c(&buf[(slot + 1) * PAGE_SIZE], hdr.num_pages * PAGE_SIZE, crc) == hdr.checksum;
+        }
+        if (!valid) {
+            slot++;
+            continue;
+        }
+        for (uint32_t i = 0; i < hdr.num_pages; i++) {
+            auto &copy = newest[{hdr.file_name, hdr.first_page_no + static_cast<page_id_t>(i)}];
+            if (hdr.seq > copy.first) {
+                copy = {hdr.seq, &buf[(slot + 1 + i) * PAGE_SIZE]};
+            }
+        }
+        max_seq = std::max(max_seq, hdr.seq);
+        slot += 1 + hdr.num_pages;
+    }
+
+    size_t repaired = 0;
+    std::vector<char> page(PAGE_SIZE);
+    auto it = newest.begin();
+    while (it != newest.end()) {
+        const std::string &file_name = it->first.first;
+        int fd = open(file_name.c_str(), O_RDWR);
+        for (; it != newest.end() && it->first.first == file_name; ++it) {
+            if (fd < 0) continue;  // 文件已经被删除
+            off_t offset = static_cast<off_t>(it->first.second) * PAGE_SIZE;
+            size_t n = pread_all(fd, page.data(), PAGE_SIZE, offset);
+            memset(page.data() + n, 0, PAGE_SIZE - n);
+            if (verify_page_checksum(page.data())) continue;
+            pwritev_all(fd, {iovec{const_cast<char *>(it->second.second), PAGE_SIZE}}, offset);
+            repaired++;
+        }
+        if (fd >= 0) {
+            // 没有修复的页面也可能是崩溃前尚未同步的原地写入，清空doublewrite文件之前都要同步
+            if (fdatasync(fd) < 0) {
+                close(fd);
+                throw UnixError();
+            }
+            close(fd);
+        }
+    }
+    truncate_file();
+    next_seq_ = max_seq + 1;
+    return repaired;
+}
+
+/**
+ * @description: 经过doublewrite文件写回一批编号连续的页面，超过doublewrite文件大小的批次拆成多条记录
+ * @param {int} fd 数据文件的文件句柄
+ * @param {page_id_t} first_page_no 第一个页面的编号
+ * @param {vector<const char*>} &pages 已经计算好校验和的页面
+ */
+void DoublewriteBuffer::write(int fd, page_id_t first_page_no, const std::vector<const char *> &pages) {
+    size_t max_pages = capacity_ - 1;
+    for (size_t begin = 0; begin < pages.size(); begin += max_pages) {
+        size_t end = std::min(pages.size(), begin + max_pages);
+        write_record(fd, first_page_no + static_cast<page_id_t>(begin),
+                     std::vector<const char *>(pages.begin() + begin, pages.begin() + end));
+    }
+}
+
+/**
+ * @description: 写入一条记录：分配doublewrite文件中的位置，顺序写入记录头和页面副本并同步，再原地写入数据文件
+ */
+void DoublewriteBuffer::write_record(int fd, page_id_t first_page_no, const std::vector<const char *> &pages) {
+    std::string file_name = disk_manager_->get_file_name(fd);
+    if (file_name.size() >= RecordHdr::MAX_FILE_NAME) {
+        throw InternalError("DoublewriteBuffer: file name too long: " + file_name);
+    }
+
+    size_t slot;
+    uint64_t seq;
+    {
+        std::unique_lock lock{latch_};
+        while (next_slot_ + 1 + pages.size() > capacity_) {
+            // 从头覆盖之前，之前的记录对应的原地写入必须已经完成并持久化
+            if (inflight_ > 0) {
+                inflight_cv_.wait(lock);
+                continue;
+            }
+            sync_written_files();
+            truncate_file();
+        }
+        slot = next_slot_;
+        next_slot_ += 1 + pages.size();
+        seq = next_seq_++;
+        inflight_++;
+        written_files_.insert(file_name);
+    }
+
+    auto finish = [&]() {
+        std::scoped_lock lock{latch_};
+        inflight_--;
+        inflight_cv_.notify_all();
+    };
+    try {
+        std::vector<char> hdr_page(PAGE_SIZE, 0);
+        RecordHdr hdr{};
+        hdr.magic = RecordHdr::MAGIC;
+        hdr.num_pages = static_cast<uint32_t>(pages.size());
+        hdr.seq = seq;
+        hdr.first_page_no = first_page_no;
+        strncpy(hdr.file_name, file_name.c_str(), sizeof(hdr.file_name) - 1);
+        uint32_t crc = crc32c(&hdr, sizeof(hdr));
+        std::vector<iovec> iov{{hdr_page.data(), PAGE_SIZE}};
+        for (const char *page : pages) {
+            crc = crc32c(page, PAGE_SIZE, crc);
+            iov.push_back({const_cast<char *>(page), PAGE_SIZE});
+        }
+        hdr.checksum = crc;
+        memcpy(hdr_page.data(), &hdr, sizeof(hdr));
+
+        pwritev_all(dw_fd_, iov, static_cast<off_t>(slot) * PAGE_SIZE);
+        if (fdatasync(dw_fd_) < 0) {
+            throw UnixError();
+        }
+        disk_manager_->write_page_run(fd, first_page_no, pages);
+    } catch (...) {
+        finish();
+        throw;
+    }
+    finish();
+    num_batches_.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @description: 等待正在进行的原地写入完成，并同步原地写入过的数据文件，关闭数据库之前调用
+ */
+void DoublewriteBuffer::sync_data_files() {
+    std::unique_lock lock{latch_};
+    inflight_cv_.wait(lock, [&]() { return inflight_ == 0; });
+    sync_written_files();
+}
+
+/**
+ * @description: 同步written_files_中的数据文件，调用者需要持有latch_
+ *              数据文件可能已经被关闭，因此按路径重新打开；已经被删除的文件不需要同步
+ */
+void DoublewriteBuffer::sync_written_files() {
+    for (const std::string &file_name : written_files_) {
+        int fd = open(file_name.c_str(), O_RDONLY);
+        if (fd < 0) {
+            if (errno == ENOENT) continue;
+            throw UnixError();
+        }
+        int rc = fdatasync(fd);
+        close(fd);
+        if (rc < 0) {
+            throw UnixError();
+        }
+    }
+    written_files_.clear();
+}
+
+/**
+ * @description: 清空doublewrite文件并从开头写入新的记录，调用者需要持有latch_，并且已经同步了记录对应的数据文件
+ *              只把next_slot_置0时，文件后部残留的旧记录在恢复时仍然有效，可能把页面改回旧的副本
+ */
+void DoublewriteBuffer::truncate_file() {
+    if (ftruncate(dw_fd_, 0) < 0 || fsync(dw_fd_) < 0) {
+        throw UnixError();
+    }
+    next_slot_ = 0;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "disk_manager.h"
+
+/*
+DoublewriteBuffer防止页面写了一半(torn page)：设备的原子写入单位可能小于PAGE_SIZE，原地写入时崩溃会留下新旧混合的页面
+一批页面先作为一条记录顺序写入doublewrite文件并同步，再写回各自在数据文件中的位置；每批只多一次顺序写和一次同步
+重启时recover()检查记录中的每个页面，数据文件中校验和不正确的页面用记录中的副本修复
+doublewrite文件循环使用：剩余空间放不下一批时，等待之前的原地写入完成并同步这些数据文件，清空doublewrite文件后从开头写入
+只用于开启了页面校验和的文件，否则无法判断页面是否写了一半
+*/
+class DoublewriteBuffer {
+   public:
+    /**
+     * @param {DiskManager*} disk_manager 数据文件的读写
+     * @param {string&} path doublewrite文件的路径，不存在时创建
+     * @param {size_t} capacity doublewrite文件的大小(页面数)，每条记录另外占用一个页面的记录头
+     */
+    DoublewriteBuffer(DiskManager *disk_manager, const std::string &path, size_t capacity);
+
+    ~DoublewriteBuffer();
+
+    DoublewriteBuffer(const DoublewriteBuffer &) = delete;
+    DoublewriteBuffer &operator=(const DoublewriteBuffer &) = delete;
+
+    size_t recover();
+
+    void write(int fd, page_id_t first_page_no, const std::vector<const char *> &pages);
+
+    void sync_data_files();
+
+    // 经过doublewrite文件写入的批次数
+    uint64_t get_num_batches() const { return num_batches_.load(std::memory_order_relaxed); }
+
+   private:
+    // doublewrite文件中一条记录的记录头，占用一个页面，之后是num_pages个页面副本
+    struct RecordHdr {
+        static constexpr uint32_t MAGIC = 0x44424c57;  // "DBLW"
+        static constexpr size_t MAX_FILE_NAME = 256;
+
+        uint32_t magic;
+        uint32_t num_pages;
+        uint64_t seq;                     // 记录的序号，同一个页面有多条记录时序号大的较新
+        page_id_t first_page_no;          // 页面在数据文件中的起始页号，页面编号连续
+        uint32_t checksum;                // 记录头(本字段为0)和所有页面副本的CRC32C
+        char file_name[MAX_FILE_NAME];    // 数据文件的路径
+    };
+    static_assert(sizeof(RecordHdr) <= PAGE_SIZE, "doublewrite record header must fit in a page");
+
+    void write_record(int fd, page_id_t first_page_no, const std::vector<const char *> &pages);
+
+    void sync_written_files();
+
+    void truncate_file();
+
+    DiskManager *disk_manager_;
+    std::string path_;
+    int dw_fd_ = -1;                      // doublewrite文件的文件句柄
+    size_t capacity_;
+
+    std::mutex latch_;                    // 保护以下成员
+    std::condition_variable inflight_cv_;
+    size_t next_slot_ = 0;                // 下一条记录在doublewrite文件中的起始页面
+    uint64_t next_seq_ = 1;
+    size_t inflight_ = 0;                 // 已经写入doublewrite文件、正在原地写入的批次数
+    std::set<std::string> written_files_; // 上次清空以来原地写入过的数据文件，清空之前需要同步
+    std::atomic<uint64_t> num_batches_{0};
+};
@@ -0,0 +1,97 @@
+#include "frame_arena.h"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+FrameArena::FrameArena(size_t size) : used_(size) {
+    size_ = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    if (size_ == 0) {
+        size_ = HUGE_PAGE_SIZE;
+    }
+
+    if (ENABLE_HUGE_PAGES) {
+        void *addr = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (addr != MAP_FAILED) {
+            data_ = static_cast<char *>(addr);
+            huge_tlb_ = true;
+            retired_.assign(size_ / HUGE_PAGE_SIZE, 0);
+            released_.assign(size_ / HUGE_PAGE_SIZE, false);
+            return;
+        }
+    }
+
+    // 多映射一个大页的长度，截掉首尾使起始地址按HUGE_PAGE_SIZE对齐，透明大页只能用于对齐的2MB区域
+    size_t length = size_ + HUGE_PAGE_SIZE;
+    void *addr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    uintptr_t begin = reinterpret_cast<uintptr_t>(addr);
+    uintptr_t aligned = (begin + HUGE_PAGE_SIZE - 1) & ~(static_cast<uintptr_t>(HUGE_PAGE_SIZE) - 1);
+    size_t head = aligned - begin;
+    size_t tail = length - head - size_;
+    if (head > 0) {
+        munmap(addr, head);
+    }
+    if (tail > 0) {
+        munmap(reinterpret_cast<void *>(aligned + size_), tail);
+    }
+    data_ = reinterpret_cast<char *>(aligned);
+
+    if (ENABLE_HUGE_PAGES) {
+        madvise(data_, size_, MADV_HUGEPAGE);  // 内核不支持透明大页时失败，仍然使用普通页面
+    }
+}
+
+bool FrameArena::retire_frame(char *addr) {
+    if (!huge_tlb_) {
+        return madvise(addr, PAGE_SIZE, MADV_DONTNEED) == 0;
+    }
+
+    std::scoped_lock lock{latch_};
+    size_t huge_page = (addr - data_) / HUGE_PAGE_SIZE;
+    size_t begin = huge_page * HUGE_PAGE_SIZE;
+    size_t num_frames = (std::min(used_, begin + HUGE_PAGE_SIZE) - begin) / PAGE_SIZE;
+    retained_ += PAGE_SIZE;
+    if (++retired_[huge_page] < num_frames) {
+        return false;
+    }
+    // 5.18之前的内核不支持对hugetlb映射使用MADV_DONTNEED，此时大页留到arena析构时释放
+    if (madvise(data_ + begin, HUGE_PAGE_SIZE, MADV_DONTNEED) != 0) {
+        return false;
+    }
+    released_[huge_page] = true;
+    retained_ -= num_frames * PAGE_SIZE;
+    return true;
+}
+
+void FrameArena::reuse_frame(char *addr) {
+    if (!huge_tlb_) {
+        return;
+    }
+
+    std::scoped_lock lock{latch_};
+    size_t huge_page = (addr - data_) / HUGE_PAGE_SIZE;
+    retired_[huge_page]--;
+    if (released_[huge_page]) {
+        // 访问这个帧时内核重新分配整个大页，大页中其他回收的帧又占用内存
+        released_[huge_page] = false;
+        retained_ += retired_[huge_page] * PAGE_SIZE;
+    } else {
+        retained_ -= PAGE_SIZE;
+    }
+}
+
+size_t FrameArena::retained_bytes() {
+    std::scoped_lock lock{latch_};
+    return retained_;
+}
+
+FrameArena::~FrameArena() {
+    if (data_ != nullptr) {
+        munmap(data_, size_);
+    }
+}
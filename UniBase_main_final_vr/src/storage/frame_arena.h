@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include "common/config.h"
+
+/*
+FrameArena是缓冲池所有帧的页面数据所在的一块连续内存，按HUGE_PAGE_SIZE对齐
+开启ENABLE_HUGE_PAGES时优先使用MAP_HUGETLB映射系统预留的2MB大页；没有预留大页时退回普通匿名映射，
+并通过madvise(MADV_HUGEPAGE)请求透明大页，减少大缓冲池占用的TLB项
+匿名映射的内存在第一次访问时才由内核分配并清零，因此创建缓冲池时不需要逐页清零，启动时间与缓冲池大小无关
+*/
+class FrameArena {
+   public:
+    /**
+     * @param {size_t} size 需要的字节数，向上取整到HUGE_PAGE_SIZE
+     */
+    explicit FrameArena(size_t size);
+
+    ~FrameArena();
+
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    char *data() const { return data_; }
+
+    size_t size() const { return size_; }
+
+    // 是否由MAP_HUGETLB预留的大页支持
+    bool is_huge_tlb() const { return huge_tlb_; }
+
+    /**
+     * @description: 缓冲池缩小时回收一个帧，把它的内存归还给操作系统，映射保持不变，再次访问时由内核重新分配并清零
+     *              MAP_HUGETLB的映射只能按整个大页归还，大页中的帧全部被回收之后才归还这个大页
+     * @return {bool} 内存是否已经归还；大页中还有正在使用的帧，或者内核不支持归还hugetlb大页时返回false
+     * @param {char*} addr 帧的起始地址，按PAGE_SIZE对齐
+     */
+    bool retire_frame(char *addr);
+
+    // 之前回收的帧重新使用，与retire_frame成对调用
+    void reuse_frame(char *addr);
+
+    // 已经回收但内存还没有归还给操作系统的字节数
+    size_t retained_bytes();
+
+   private:
+    char *data_ = nullptr;
+    size_t size_ = 0;        // 映射的字节数
+    bool huge_tlb_ = false;
+    size_t used_ = 0;        // 帧占用的字节数，最后一个大页可能没有用满
+
+    // 以下只用于MAP_HUGETLB的映射，下标为大页的编号
+    std::mutex latch_;                  // 不同分区的帧可能位于同一个大页中
+    std::vector<size_t> retired_;       // 每个大页中已经回收的帧数
+    std::vector<bool> released_;        // 大页是否已经归还给操作系统
+    size_t retained_ = 0;               // 没有归还的大页中已经回收的字节数
+};
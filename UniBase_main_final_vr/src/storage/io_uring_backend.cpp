@@ -0,0 +1,184 @@
+#include "storage/io_uring_backend.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define UNIBASE_HAVE_IO_URING 1
+#else
+#define UNIBASE_HAVE_IO_URING 0
+#endif
+
+#if UNIBASE_HAVE_IO_URING
+
+IoUring::~IoUring() {
+    if (sqes_ != nullptr) munmap(sqes_, sq_entries_ * sizeof(io_uring_sqe));
+    if (cq_ptr_ != nullptr && cq_ptr_ != sq_ptr_) munmap(cq_ptr_, cq_ring_size_);
+    if (sq_ptr_ != nullptr) munmap(sq_ptr_, sq_ring_size_);
+    if (ring_fd_ >= 0) close(ring_fd_);
+}
+
+/**
+ * @description: 创建io_uring实例并映射提交/完成队列
+ * @return {bool} 内核不支持或者被禁用(ENOSYS/EPERM等)时返回false，此时上层应使用同步I/O
+ * @param {unsigned} entries 提交队列的长度
+ */
+bool IoUring::init(unsigned entries) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (fd < 0) {
+        return false;
+    }
+    ring_fd_ = fd;
+    sq_entries_ = params.sq_entries;
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+
+    void *sq_ptr = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                        IORING_OFF_SQ_RING);
+    if (sq_ptr == MAP_FAILED) {
+        close(fd);
+        ring_fd_ = -1;
+        return false;
+    }
+    sq_ptr_ = sq_ptr;
+    if (single_mmap) {
+        cq_ptr_ = sq_ptr_;
+    } else {
+        void *cq_ptr = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                            IORING_OFF_CQ_RING);
+        if (cq_ptr == MAP_FAILED) {
+            munmap(sq_ptr_, sq_ring_size_);
+            sq_ptr_ = nullptr;
+            close(fd);
+            ring_fd_ = -1;
+            return false;
+        }
+        cq_ptr_ = cq_ptr;
+    }
+    void *sqes = mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        if (cq_ptr_ != sq_ptr_) munmap(cq_ptr_, cq_ring_size_);
+        munmap(sq_ptr_, sq_ring_size_);
+        sq_ptr_ = cq_ptr_ = nullptr;
+        close(fd);
+        ring_fd_ = -1;
+        return false;
+    }
+    sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+    char *sq = static_cast<char *>(sq_ptr_);
+    sq_head_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    char *cq = static_cast<char *>(cq_ptr_);
+    cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    return true;
+}
+
+bool IoUring::prepare_read(int fd, char *buf, unsigned len, off_t offset, uint64_t user_data) {
+    return prepare(IORING_OP_READ, fd, buf, len, offset, user_data);
+}
+
+bool IoUring::prepare_write(int fd, const char *buf, unsigned len, off_t offset, uint64_t user_data) {
+    return prepare(IORING_OP_WRITE, fd, buf, len, offset, user_data);
+}
+
+/**
+ * @description: 向提交队列中放入一个请求，但不通知内核，需要调用submit()
+ * @return {bool} 提交队列已满时返回false
+ */
+bool IoUring::prepare(uint8_t opcode, int fd, const char *buf, unsigned len, off_t offset, uint64_t user_data) {
+    unsigned tail = *sq_tail_;
+    unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (tail - head >= sq_entries_) {
+        return false;
+    }
+    unsigned idx = tail & *sq_mask_;
+    io_uring_sqe *sqe = &sqes_[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buf);
+    sqe->len = len;
+    sqe->off = static_cast<uint64_t>(offset);
+    sqe->user_data = user_data;
+    sq_array_[idx] = idx;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    to_submit_++;
+    return true;
+}
+
+/**
+ * @description: 把提交队列中的请求交给内核处理
+ * @return {int} 本次提交的请求个数，出错返回-errno
+ * @param {unsigned} wait_nr 至少等待wait_nr个请求完成后才返回
+ */
+int IoUring::submit(unsigned wait_nr) {
+    unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+    while (true) {
+        int ret = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd_, to_submit_, wait_nr, flags, nullptr, 0));
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            return -errno;
+        }
+        to_submit_ -= std::min<unsigned>(to_submit_, ret);
+        return ret;
+    }
+}
+
+/**
+ * @description: 从完成队列中取出一个已经完成的请求
+ * @return {bool} 完成队列为空时返回false
+ * @param {uint64_t*} user_data 请求提交时指定的标识
+ * @param {int*} res 请求的返回值，与pread/pwrite相同，出错时为-errno
+ */
+bool IoUring::peek_completion(uint64_t *user_data, int *res) {
+    unsigned head = *cq_head_;
+    unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+        return false;
+    }
+    io_uring_cqe *cqe = &cqes_[head & *cq_mask_];
+    *user_data = cqe->user_data;
+    *res = cqe->res;
+    __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+#else  // !UNIBASE_HAVE_IO_URING
+
+IoUring::~IoUring() = default;
+
+bool IoUring::init(unsigned entries) { return false; }
+
+bool IoUring::prepare_read(int fd, char *buf, unsigned len, off_t offset, uint64_t user_data) { return false; }
+
+bool IoUring::prepare_write(int fd, const char *buf, unsigned len, off_t offset, uint64_t user_data) { return false; }
+
+bool IoUring::prepare(uint8_t opcode, int fd, const char *buf, unsigned len, off_t offset, uint64_t user_data) {
+    return false;
+}
+
+int IoUring::submit(unsigned wait_nr) { return -ENOSYS; }
+
+bool IoUring::peek_completion(uint64_t *user_data, int *res) { return false; }
+
+#endif
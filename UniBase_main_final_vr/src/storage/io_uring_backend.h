@@ -0,0 +1,58 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstdint>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/**
+ * @description: 对Linux io_uring接口的最小封装，直接使用系统调用，不依赖liburing
+ * 只支持DiskManager需要的定位读写(IORING_OP_READ/IORING_OP_WRITE)，本身不加锁，由调用者保证互斥
+ */
+class IoUring {
+   public:
+    IoUring() = default;
+
+    ~IoUring();
+
+    IoUring(const IoUring &) = delete;
+    IoUring &operator=(const IoUring &) = delete;
+
+    bool init(unsigned entries);
+
+    bool is_ready() const { return ring_fd_ >= 0; }
+
+    unsigned capacity() const { return sq_entries_; }
+
+    bool prepare_read(int fd, char *buf, unsigned len, off_t offset, uint64_t user_data);
+
+    bool prepare_write(int fd, const char *buf, unsigned len, off_t offset, uint64_t user_data);
+
+    int submit(unsigned wait_nr);
+
+    bool peek_completion(uint64_t *user_data, int *res);
+
+   private:
+    bool prepare(uint8_t opcode, int fd, const char *buf, unsigned len, off_t offset, uint64_t user_data);
+
+    int ring_fd_ = -1;
+    unsigned sq_entries_ = 0;
+    unsigned to_submit_ = 0;    // 已经放入提交队列但还没有通知内核的请求个数
+
+    void *sq_ptr_ = nullptr;    // 提交队列映射的内存
+    void *cq_ptr_ = nullptr;    // 完成队列映射的内存（IORING_FEAT_SINGLE_MMAP时与sq_ptr_相同）
+    size_t sq_ring_size_ = 0;
+    size_t cq_ring_size_ = 0;
+    io_uring_sqe *sqes_ = nullptr;
+
+    unsigned *sq_head_ = nullptr;
+    unsigned *sq_tail_ = nullptr;
+    unsigned *sq_mask_ = nullptr;
+    unsigned *sq_array_ = nullptr;
+    unsigned *cq_head_ = nullptr;
+    unsigned *cq_tail_ = nullptr;
+    unsigned *cq_mask_ = nullptr;
+    io_uring_cqe *cqes_ = nullptr;
+};
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <atomic>
+#include <cstring>
+#include <shared_mutex>
+
 #include "common/config.h"
 
 /**
@@ -19,62 +23,108 @@ struct PageId {
         return "{fd: " + std::to_string(fd) + " page_no: " + std::to_string(page_no) + "}"; 
     }
 
-    inline int64_t Get() const {
-        return (static_cast<int64_t>(fd << 16) | page_no);
+    // fd和page_no各占32位拼成的64位键，不同的PageId对应不同的键
+    inline uint64_t key() const {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(fd)) << 32) | static_cast<uint32_t>(page_no);
     }
 };
 
+/**
+ * @description: 64位混合哈希(splitmix64的finalizer)，输入的每一位都会影响输出的每一位
+ */
+inline uint64_t mix_hash64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
 // PageId的自定义哈希算法, 用于构建unordered_map<PageId, frame_id_t, PageIdHash>
 struct PageIdHash {
-    size_t operator()(const PageId &x) const { return (x.fd << 16) | x.page_no; }
+    size_t operator()(const PageId &x) const { return mix_hash64(x.key()); }
 };
 
+// 没有指定PageIdHash的unordered容器使用同样的哈希
 template <>
 struct std::hash<PageId> {
-    size_t operator()(const PageId &obj) const { return std::hash<int64_t>()(obj.Get()); }
+    size_t operator()(const PageId &obj) const { return PageIdHash()(obj); }
 };
 
 /**
  * @description: Page类声明, Page是RMDB数据块的单位、是负责数据操作Record模块的操作对象，
  * Page对象在磁盘上有文件存储, 若在Buffer中则有帧偏移, 并非特指Buffer或Disk上的数据
+ * Page只是帧的描述符，页面数据在BufferPoolManager的FrameArena中；描述符按缓存行对齐，
+ * 常用的元数据集中在第一个缓存行，相邻帧的描述符不会共享缓存行
  */
-class Page {
+class alignas(CACHE_LINE_SIZE) Page {
     friend class BufferPoolManager;
 
    public:
     
-    Page() { reset_memory(); }
+    Page() = default;
 
     ~Page() = default;
 
-    PageId get_page_id() const { return id_; }
+    PageId get_page_id() const { return id_.load(std::memory_order_acquire); }
 
     inline char *get_data() { return data_; }
 
-    bool is_dirty() const { return is_dirty_; }
+    bool is_dirty() const { return is_dirty_.load(); }
 
     static constexpr size_t OFFSET_PAGE_START = 0;
     static constexpr size_t OFFSET_LSN = 0;
-    static constexpr size_t OFFSET_PAGE_HDR = 4;
+    static constexpr size_t OFFSET_CHECKSUM = 4;  // 页面的CRC32C，只有开启了校验和的文件使用(见page_checksum.h)
+    static constexpr size_t OFFSET_PAGE_HDR = 8;
+
+    // 表和索引文件头中的魔数和格式版本；第1版的文件头没有这两个字段，页头紧跟lsn从偏移4开始，
+    // 第2版在lsn之后加入校验和，页头从OFFSET_PAGE_HDR开始；版本不同的文件拒绝打开
+    static constexpr uint32_t FILE_MAGIC = 0x55424442;  // "UBDB"
+    static constexpr int FILE_FORMAT_VERSION = 2;
 
     inline lsn_t get_page_lsn() { return *reinterpret_cast<lsn_t *>(get_data() + OFFSET_LSN) ; }
 
     inline void set_page_lsn(lsn_t page_lsn) { memcpy(get_data() + OFFSET_LSN, &page_lsn, sizeof(lsn_t)); }
 
+    /** 页面内容的读写latch，一般通过ReadPageGuard/WritePageGuard获取，持有latch时页面必须被固定 */
+    void r_latch() { latch_.lock_shared(); }
+
+    void r_unlatch() { latch_.unlock_shared(); }
+
+    void w_latch() { latch_.lock(); }
+
+    void w_unlatch() { latch_.unlock(); }
+
    private:
     void reset_memory() { memset(data_, OFFSET_PAGE_START, PAGE_SIZE); }  // 将data_的PAGE_SIZE个字节填充为0
 
-    /** page的唯一标识符 */
-    PageId id_;
+    /** pin_count_为负表示帧中没有可以固定的页面：帧是空闲的、已经被回收，或者正在被分配给另一个页面 */
+    static constexpr int NOT_RESIDENT = -1;
+
+    /** page的唯一标识符，无锁固定页面时需要读取，因此是原子变量 */
+    std::atomic<PageId> id_{PageId{-1, INVALID_PAGE_ID}};
 
     /** The actual data that is stored within a page.
-     *  该页面在bufferPool中的偏移地址
+     *  该页面在bufferPool中的偏移地址，指向BufferPoolManager的FrameArena中按大页对齐分配的连续内存
      */
-    char data_[PAGE_SIZE] = {};
+    char *data_ = nullptr;
+
+    /** The pin count of this page. 命中缓冲池时不加分区锁，通过CAS递增；其他修改在分区锁内进行 */
+    std::atomic<int> pin_count_{NOT_RESIDENT};
+
+    /** 帧在所属分区内的编号，缓冲池扩大或缩小时帧描述符的地址和编号保持不变 */
+    frame_id_t frame_id_ = INVALID_FRAME_ID;
 
     /** 脏页判断 */
-    bool is_dirty_ = false;
+    std::atomic<bool> is_dirty_{false};
+
+    /** 帧上正在进行磁盘读写(读入该页面或写回被淘汰的旧页面)，其他线程需要等待I/O完成后才能使用 */
+    std::atomic<bool> io_in_progress_{false};
+
+    /** 不加分区锁固定页面后置位，页面下一次被取消固定到0时再把这次访问交给replacer */
+    std::atomic<bool> referenced_{false};
 
-    /** The pin count of this page. */
-    int pin_count_ = 0;
+    /** 保护页面内容：读取时持有共享latch，修改时持有排他latch；与pin_count_等帧的元信息无关 */
+    std::shared_mutex latch_;
 };
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include "storage/page_checksum.h"
+
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+#include "storage/page.h"
+
+namespace {
+
+constexpr uint32_t CRC32C_POLY = 0x82F63B78;  // 0x1EDC6F41按位反转
+
+struct Crc32cTable {
+    uint32_t entries[256];
+
+    Crc32cTable() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ (crc & 1 ? CRC32C_POLY : 0);
+            }
+            entries[i] = crc;
+        }
+    }
+};
+
+const Crc32cTable crc32c_table;
+
+uint32_t crc32c_software(const unsigned char *data, size_t len, uint32_t crc) {
+    for (size_t i = 0; i < len; i++) {
+        crc = crc32c_table.entries[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) uint32_t crc32c_sse42(const unsigned char *data, size_t len, uint32_t crc) {
+    uint64_t crc64 = crc;
+    for (; len >= sizeof(uint64_t); data += sizeof(uint64_t), len -= sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = static_cast<uint32_t>(crc64);
+    for (; len > 0; data++, len--) {
+        crc = _mm_crc32_u8(crc, *data);
+    }
+    return crc;
+}
+
+const bool has_sse42 = [] {
+    __builtin_cpu_init();  // 静态初始化可能早于CPU特性检测的初始化
+    return __builtin_cpu_supports("sse4.2") != 0;
+}();
+#else
+const bool has_sse42 = false;
+#endif
+
+}  // namespace
+
+uint32_t crc32c(const void *data, size_t len, uint32_t crc) {
+    auto bytes = static_cast<const unsigned char *>(data);
+    crc = ~crc;
+#if defined(__x86_64__)
+    if (has_sse42) {
+        return ~crc32c_sse42(bytes, len, crc);
+    }
+#endif
+    return ~crc32c_software(bytes, len, crc);
+}
+
+bool crc32c_hardware_enabled() { return has_sse42; }
+
+/**
+ * @description: 计算页面的校验和，不包括校验和字段
+ */
+uint32_t compute_page_checksum(const char *page) {
+    uint32_t crc = crc32c(page, Page::OFFSET_CHECKSUM);
+    size_t rest = Page::OFFSET_CHECKSUM + sizeof(uint32_t);
+    return crc32c(page + rest, PAGE_SIZE - rest, crc);
+}
+
+/**
+ * @description: 把页面的校验和写入页头，在页面写回磁盘之前调用
+ */
+void set_page_checksum(char *page) {
+    uint32_t checksum = compute_page_checksum(page);
+    memcpy(page + Page::OFFSET_CHECKSUM, &checksum, sizeof(checksum));
+}
+
+/**
+ * @description: 校验从磁盘读入的页面；全零的页面(文件中分配了但从未写回的页面)视为有效
+ * @return {bool} 校验和与页面内容一致时返回true
+ */
+bool verify_page_checksum(const char *page) {
+    uint32_t stored;
+    memcpy(&stored, page + Page::OFFSET_CHECKSUM, sizeof(stored));
+    if (stored == compute_page_checksum(page)) {
+        return true;
+    }
+    if (stored != 0) {
+        return false;
+    }
+    for (size_t i = 0; i < PAGE_SIZE; i++) {
+        if (page[i] != 0) return false;
+    }
+    return true;
+}
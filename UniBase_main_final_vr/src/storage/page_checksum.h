@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+页面校验和：CRC32C(Castagnoli多项式)，支持SSE4.2的x86-64处理器上使用crc32指令，否则查表计算
+表和索引文件的每个页面在写回磁盘时计算校验和，存放在页头Page::OFFSET_CHECKSUM处(紧跟页面lsn)，
+缓冲池从磁盘读入页面时校验；计算时跳过校验和字段本身
+*/
+
+/**
+ * @description: 计算CRC32C，可以分段计算：把上一段的结果作为crc传入
+ * @return {uint32_t} data[0, len)的CRC32C
+ * @param {const void*} data 数据
+ * @param {size_t} len 字节数
+ * @param {uint32_t} crc 前面数据的CRC32C，第一段为0
+ */
+uint32_t crc32c(const void *data, size_t len, uint32_t crc = 0);
+
+// 当前进程是否使用crc32指令计算
+bool crc32c_hardware_enabled();
+
+uint32_t compute_page_checksum(const char *page);
+
+void set_page_checksum(char *page);
+
+bool verify_page_checksum(const char *page);
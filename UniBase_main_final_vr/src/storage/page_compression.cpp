@@ -0,0 +1,130 @@
+#include "storage/page_compression.h"
+
+#include <cstring>
+
+namespace {
+
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t MAX_OFFSET = 65535;
+constexpr int HASH_BITS = 12;
+
+uint32_t load32(const char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint32_t hash32(uint32_t v) { return (v * 2654435761u) >> (32 - HASH_BITS); }
+
+// 写入长度的扩展字节：len已经减去了标记字节中的15
+bool put_length(size_t len, char *dst, size_t capacity, size_t *op) {
+    while (len >= 255) {
+        if (*op >= capacity) return false;
+        dst[(*op)++] = static_cast<char>(255);
+        len -= 255;
+    }
+    if (*op >= capacity) return false;
+    dst[(*op)++] = static_cast<char>(len);
+    return true;
+}
+
+bool get_length(const unsigned char *src, size_t src_len, size_t *ip, size_t *len) {
+    unsigned char b;
+    do {
+        if (*ip >= src_len) return false;
+        b = src[(*ip)++];
+        *len += b;
+    } while (b == 255);
+    return true;
+}
+
+/**
+ * @description: 写入一个序列：字面量src[lit_begin, lit_end)，match_len为0时是最后一个只有字面量的序列
+ */
+bool put_sequence(const char *src, size_t lit_begin, size_t lit_end, size_t offset, size_t match_len, char *dst,
+                  size_t capacity, size_t *op) {
+    size_t lit_len = lit_end - lit_begin;
+    if (*op >= capacity) return false;
+    size_t token = *op;
+    (*op)++;
+    unsigned char lit_nibble = lit_len < 15 ? lit_len : 15;
+    unsigned char match_nibble = 0;
+    if (match_len > 0) {
+        match_nibble = match_len - MIN_MATCH < 15 ? match_len - MIN_MATCH : 15;
+    }
+    dst[token] = static_cast<char>(lit_nibble << 4 | match_nibble);
+    if (lit_len >= 15 && !put_length(lit_len - 15, dst, capacity, op)) return false;
+    if (*op + lit_len > capacity) return false;
+    memcpy(dst + *op, src + lit_begin, lit_len);
+    *op += lit_len;
+    if (match_len == 0) return true;
+    if (*op + 2 > capacity) return false;
+    dst[(*op)++] = static_cast<char>(offset & 0xff);
+    dst[(*op)++] = static_cast<char>(offset >> 8);
+    return match_len - MIN_MATCH < 15 || put_length(match_len - MIN_MATCH - 15, dst, capacity, op);
+}
+
+}  // namespace
+
+size_t compress_block(const char *src, size_t src_len, char *dst, size_t dst_capacity) {
+    // 哈希表记录最近一次出现每个4字节序列的位置+1，0表示没有出现过
+    uint32_t table[1 << HASH_BITS] = {};
+    size_t ip = 0;
+    size_t anchor = 0;
+    size_t op = 0;
+    while (ip + MIN_MATCH <= src_len) {
+        uint32_t seq = load32(src + ip);
+        uint32_t &slot = table[hash32(seq)];
+        size_t ref = slot;
+        slot = static_cast<uint32_t>(ip + 1);
+        if (ref == 0 || ip - (ref - 1) > MAX_OFFSET || load32(src + ref - 1) != seq) {
+            // 连续没有找到匹配时加大步长，不可压缩的数据不会拖慢太多
+            ip += 1 + ((ip - anchor) >> 5);
+            continue;
+        }
+        ref--;
+        size_t len = MIN_MATCH;
+        while (ip + len < src_len && src[ref + len] == src[ip + len]) {
+            len++;
+        }
+        if (!put_sequence(src, anchor, ip, ip - ref, len, dst, dst_capacity, &op)) {
+            return 0;
+        }
+        ip += len;
+        anchor = ip;
+    }
+    if (!put_sequence(src, anchor, src_len, 0, 0, dst, dst_capacity, &op)) {
+        return 0;
+    }
+    return op;
+}
+
+bool decompress_block(const char *src, size_t src_len, char *dst, size_t dst_len) {
+    const unsigned char *in = reinterpret_cast<const unsigned char *>(src);
+    size_t ip = 0;
+    size_t op = 0;
+    while (ip < src_len) {
+        unsigned char token = in[ip++];
+        size_t lit_len = token >> 4;
+        if (lit_len == 15 && !get_length(in, src_len, &ip, &lit_len)) return false;
+        if (ip + lit_len > src_len || op + lit_len > dst_len) return false;
+        memcpy(dst + op, src + ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+        if (op == dst_len) {
+            return ip == src_len;  // 最后一个序列
+        }
+        if (ip + 2 > src_len) return false;
+        size_t offset = in[ip] | static_cast<size_t>(in[ip + 1]) << 8;
+        ip += 2;
+        size_t match_len = token & 0x0f;
+        if (match_len == 15 && !get_length(in, src_len, &ip, &match_len)) return false;
+        match_len += MIN_MATCH;
+        if (offset == 0 || offset > op || op + match_len > dst_len) return false;
+        // 距离可能小于长度，逐字节复制
+        for (size_t i = 0; i < match_len; i++, op++) {
+            dst[op] = dst[op - offset];
+        }
+    }
+    return op == dst_len && dst_len == 0;
+}
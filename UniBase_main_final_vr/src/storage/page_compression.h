@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+页面压缩：LZ77风格的字节对齐编码，用于压缩存储的表文件(见CompressedFile)，不依赖外部库
+压缩后的数据是一串序列，每个序列为：
+    标记字节(高4位为字面量长度，低4位为匹配长度-4，等于15时后面跟扩展长度字节，每个字节255表示继续)
+    字面量 | 匹配距离(2字节，小端) | 匹配长度的扩展字节
+最后一个序列只有字面量，解压出完整的输入后结束；匹配距离可以小于匹配长度，用于表示重复的字节(如大片的0)
+*/
+
+/**
+ * @description: 压缩src[0, src_len)
+ * @return {size_t} 压缩后的字节数，压缩结果超过dst_capacity时返回0
+ * @param {const char*} src 要压缩的数据
+ * @param {size_t} src_len 要压缩的字节数
+ * @param {char*} dst 压缩结果
+ * @param {size_t} dst_capacity dst的大小
+ */
+size_t compress_block(const char *src, size_t src_len, char *dst, size_t dst_capacity);
+
+/**
+ * @description: 解压compress_block()的结果，解压后的数据必须正好是dst_len个字节
+ * @return {bool} src格式不正确或者解压后的长度不等于dst_len时返回false
+ */
+bool decompress_block(const char *src, size_t src_len, char *dst, size_t dst_len);
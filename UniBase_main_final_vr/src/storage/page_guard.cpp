@@ -0,0 +1,55 @@
+#include "page_guard.h"
+
+#include "buffer_pool_manager.h"
+
+BasicPageGuard::BasicPageGuard(BufferPoolManager *bpm, Page *page, PageLatchMode mode)
+    : bpm_(bpm), page_(page), mode_(mode) {
+    if (page_ == nullptr) {
+        mode_ = PageLatchMode::NONE;
+        return;
+    }
+    if (mode_ == PageLatchMode::SHARED) {
+        page_->r_latch();
+    } else if (mode_ == PageLatchMode::EXCLUSIVE) {
+        page_->w_latch();
+    }
+}
+
+BasicPageGuard::BasicPageGuard(BasicPageGuard &&that) noexcept
+    : bpm_(that.bpm_), page_(that.page_), mode_(that.mode_), is_dirty_(that.is_dirty_) {
+    that.page_ = nullptr;
+    that.mode_ = PageLatchMode::NONE;
+    that.is_dirty_ = false;
+}
+
+BasicPageGuard &BasicPageGuard::operator=(BasicPageGuard &&that) noexcept {
+    if (this != &that) {
+        drop();
+        bpm_ = that.bpm_;
+        page_ = that.page_;
+        mode_ = that.mode_;
+        is_dirty_ = that.is_dirty_;
+        that.page_ = nullptr;
+        that.mode_ = PageLatchMode::NONE;
+        that.is_dirty_ = false;
+    }
+    return *this;
+}
+
+/**
+ * @description: 先释放页面latch再取消固定，取消固定后页面可能被其他线程淘汰
+ */
+void BasicPageGuard::drop() {
+    if (page_ == nullptr) {
+        return;
+    }
+    if (mode_ == PageLatchMode::SHARED) {
+        page_->r_unlatch();
+    } else if (mode_ == PageLatchMode::EXCLUSIVE) {
+        page_->w_unlatch();
+    }
+    bpm_->unpin_page(page_->get_page_id(), is_dirty_);
+    page_ = nullptr;
+    mode_ = PageLatchMode::NONE;
+    is_dirty_ = false;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "page.h"
+
+class BufferPoolManager;
+
+// guard持有的页面latch
+enum class PageLatchMode { NONE, SHARED, EXCLUSIVE };
+
+/*
+BasicPageGuard在析构时自动取消固定(unpin)它持有的页面，并释放页面latch
+guard只能移动不能复制；移动到BasicPageGuard中的ReadPageGuard/WritePageGuard仍然持有原来的latch
+脏页标记由mark_dirty()或WritePageGuard::get_data()设置，unpin时传给缓冲池
+fetch_page失败(缓冲池中所有帧都被固定)时得到空的guard，is_valid()返回false
+*/
+class BasicPageGuard {
+   public:
+    BasicPageGuard() = default;
+
+    /**
+     * @param {BufferPoolManager*} bpm 页面所在的缓冲池
+     * @param {Page*} page 已经被固定的页面，为空时得到空的guard
+     * @param {PageLatchMode} mode 需要获取的页面latch
+     */
+    BasicPageGuard(BufferPoolManager *bpm, Page *page, PageLatchMode mode = PageLatchMode::NONE);
+
+    BasicPageGuard(const BasicPageGuard &) = delete;
+    BasicPageGuard &operator=(const BasicPageGuard &) = delete;
+
+    BasicPageGuard(BasicPageGuard &&that) noexcept;
+    BasicPageGuard &operator=(BasicPageGuard &&that) noexcept;
+
+    ~BasicPageGuard() { drop(); }
+
+    /**
+     * @description: 提前释放latch并取消固定页面，之后guard为空
+     */
+    void drop();
+
+    bool is_valid() const { return page_ != nullptr; }
+
+    Page *get_page() const { return page_; }
+
+    PageId get_page_id() const { return page_->get_page_id(); }
+
+    const char *get_data() const { return page_->get_data(); }
+
+    void mark_dirty() { is_dirty_ = true; }
+
+   protected:
+    BufferPoolManager *bpm_ = nullptr;
+    Page *page_ = nullptr;
+    PageLatchMode mode_ = PageLatchMode::NONE;
+    bool is_dirty_ = false;
+};
+
+/* 持有页面共享latch的guard，多个线程可以同时读取同一个页面 */
+class ReadPageGuard : public BasicPageGuard {
+   public:
+    ReadPageGuard() = default;
+
+    ReadPageGuard(BufferPoolManager *bpm, Page *page) : BasicPageGuard(bpm, page, PageLatchMode::SHARED) {}
+};
+
+/* 持有页面排他latch的guard，通过get_data()获取可修改的页面数据时标记为脏页 */
+class WritePageGuard : public BasicPageGuard {
+   public:
+    WritePageGuard() = default;
+
+    WritePageGuard(BufferPoolManager *bpm, Page *page) : BasicPageGuard(bpm, page, PageLatchMode::EXCLUSIVE) {}
+
+    char *get_data() {
+        is_dirty_ = true;
+        return page_->get_data();
+    }
+};
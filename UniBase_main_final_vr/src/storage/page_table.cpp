@@ -0,0 +1,61 @@
+#include "storage/page_table.h"
+
+#include <cassert>
+
+PageTable::PageTable(size_t capacity) : mask_(capacity - 1), slots_(new Slot[capacity]) {
+    assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+}
+
+/**
+ * @description: 插入一个不在表中的页面，调用者需要持有分区锁
+ *              先写入帧再发布键，无锁查找看到键时帧已经写好
+ */
+void PageTable::insert(PageId page_id, Page *page) {
+    uint64_t key = page_id.key();
+    assert(key != EMPTY_KEY && size_ < capacity());
+    size_t pos = home_of(key);
+    while (slots_[pos].key.load(std::memory_order_relaxed) != EMPTY_KEY) {
+        assert(slots_[pos].key.load(std::memory_order_relaxed) != key);
+        pos = (pos + 1) & mask_;
+    }
+    slots_[pos].page.store(page, std::memory_order_relaxed);
+    slots_[pos].key.store(key, std::memory_order_release);
+    size_++;
+}
+
+/**
+ * @description: 从表中删除页面，调用者需要持有分区锁
+ *              删除后把同一探测序列中后面的元素前移填补空位；移动期间无锁查找可能漏掉被移动的页面
+ * @return {bool} 页面是否在表中
+ */
+bool PageTable::erase(PageId page_id) {
+    uint64_t key = page_id.key();
+    if (key == EMPTY_KEY) {
+        return false;
+    }
+    size_t hole = home_of(key);
+    while (true) {
+        uint64_t slot_key = slots_[hole].key.load(std::memory_order_relaxed);
+        if (slot_key == key) break;
+        if (slot_key == EMPTY_KEY) return false;
+        hole = (hole + 1) & mask_;
+    }
+
+    size_t pos = hole;
+    while (true) {
+        pos = (pos + 1) & mask_;
+        uint64_t slot_key = slots_[pos].key.load(std::memory_order_relaxed);
+        if (slot_key == EMPTY_KEY) break;
+        // 元素的起始位置在循环区间(hole, pos]之内时不能前移，否则从起始位置开始的探测会先遇到空位
+        size_t home = home_of(slot_key);
+        bool stays = hole < pos ? (home > hole && home <= pos) : (home > hole || home <= pos);
+        if (stays) continue;
+        slots_[hole].page.store(slots_[pos].page.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        slots_[hole].key.store(slot_key, std::memory_order_release);
+        hole = pos;
+    }
+    slots_[hole].key.store(EMPTY_KEY, std::memory_order_release);
+    slots_[hole].page.store(nullptr, std::memory_order_relaxed);
+    size_--;
+    return true;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "page.h"
+
+/*
+PageTable是缓冲池一个分区的页表：容量固定、线性探测的开放寻址哈希表，从PageId映射到页面所在帧的描述符
+插入和删除由调用者持有分区锁串行执行；查找不加锁，可以与插入和删除并发进行
+与修改并发时，无锁查找可能漏掉存在的页面，也可能返回已经换成其他页面的帧，
+调用者固定帧之后需要校验帧中的页面(见BufferPoolManager::try_pin_page)，校验失败时再持有分区锁查找
+删除时把后面的元素前移(backward shift)，不使用墓碑，删除再多表也不会退化
+*/
+class PageTable {
+   public:
+    /**
+     * @param {size_t} capacity 槽的个数，必须是2的幂；调用者保证页面数不超过容量的一半
+     */
+    explicit PageTable(size_t capacity);
+
+    PageTable(const PageTable &) = delete;
+    PageTable &operator=(const PageTable &) = delete;
+
+    /**
+     * @description: 查找页面所在的帧，不需要持有分区锁
+     * @return {Page*} 页面不在表中时返回nullptr；并发修改时结果只能作为提示
+     */
+    Page *find(PageId page_id) const {
+        uint64_t key = page_id.key();
+        size_t pos = mix_hash64(key) & mask_;
+        for (size_t probes = 0; probes <= mask_; probes++) {
+            uint64_t slot_key = slots_[pos].key.load(std::memory_order_acquire);
+            if (slot_key == key) {
+                return slots_[pos].page.load(std::memory_order_acquire);
+            }
+            if (slot_key == EMPTY_KEY) {
+                return nullptr;
+            }
+            pos = (pos + 1) & mask_;
+        }
+        return nullptr;
+    }
+
+    void insert(PageId page_id, Page *page);
+
+    bool erase(PageId page_id);
+
+    // 遍历表中所有的页面，调用者需要持有分区锁
+    template <typename Func>
+    void for_each(Func &&func) const {
+        for (size_t pos = 0; pos <= mask_; pos++) {
+            if (slots_[pos].key.load(std::memory_order_relaxed) != EMPTY_KEY) {
+                func(slots_[pos].page.load(std::memory_order_relaxed));
+            }
+        }
+    }
+
+    size_t size() const { return size_; }
+
+    size_t capacity() const { return mask_ + 1; }
+
+   private:
+    // fd和page_no都为-1的键，不会是任何页面的键
+    static constexpr uint64_t EMPTY_KEY = ~0ULL;
+
+    struct Slot {
+        std::atomic<uint64_t> key{EMPTY_KEY};
+        std::atomic<Page *> page{nullptr};
+    };
+
+    size_t home_of(uint64_t key) const { return mix_hash64(key) & mask_; }
+
+    size_t mask_;
+    size_t size_ = 0;
+    std::unique_ptr<Slot[]> slots_;
+};
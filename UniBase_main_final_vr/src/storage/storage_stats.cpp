@@ -0,0 +1,55 @@
+#include "storage/storage_stats.h"
+
+#include <cmath>
+
+/**
+ * @description: 记录一次I/O的延迟
+ */
+void LatencyHistogram::record(std::chrono::nanoseconds latency) {
+    uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+    size_t bucket = 0;
+    while (us > 0 && bucket < NUM_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::count() const {
+    uint64_t sum = 0;
+    for (auto &bucket : buckets_) {
+        sum += bucket.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+uint64_t LatencyHistogram::percentile_us(double p) const {
+    uint64_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(std::ceil(p * total));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; i++) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return i == 0 ? 1 : uint64_t{1} << i;
+        }
+    }
+    return uint64_t{1} << (NUM_BUCKETS - 1);
+}
+
+void LatencyHistogram::reset() {
+    for (auto &bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void FileIoStats::reset() {
+    reads = 0;
+    read_bytes = 0;
+    writes = 0;
+    write_bytes = 0;
+    read_latency.reset();
+    write_latency.reset();
+}
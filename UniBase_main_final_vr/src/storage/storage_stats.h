@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "common/config.h"
+
+/*
+缓冲池和磁盘I/O的统计信息，开销足够小，可以在生产环境中一直开启
+StatCounters把计数分散到STAT_COUNTER_SLOTS个按缓存行对齐的槽中，每个线程固定累加到自己的槽，
+热路径上只有一次无竞争的relaxed原子加法；读取时才把所有槽的计数汇总
+*/
+
+// 缓冲池的计数器编号
+enum BufferStat : size_t {
+    BUFFER_HIT = 0,             // fetch_page命中缓冲池
+    BUFFER_MISS,                // fetch_page需要从磁盘读入页面
+    BUFFER_EVICTION,            // 通过置换策略淘汰了页面
+    BUFFER_FOREGROUND_WRITE,    // 请求线程淘汰脏页时写回的页面数
+    BUFFER_BACKGROUND_WRITE,    // 清理线程、预读线程和缩小缓冲池时写回的页面数
+    BUFFER_PIN_WAIT,            // 固定页面前等待该页面上的I/O完成的次数
+    BUFFER_PREFETCH,            // 提交预读的页面数
+    NUM_BUFFER_STATS
+};
+
+template <size_t N>
+class StatCounters {
+   public:
+    void add(size_t stat, uint64_t delta = 1) {
+        slots_[thread_slot()].counters[stat].fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    // 汇总所有线程的计数，与正在进行的add()之间不保证一致的快照
+    uint64_t get(size_t stat) const {
+        uint64_t sum = 0;
+        for (auto &slot : slots_) {
+            sum += slot.counters[stat].load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+    std::array<uint64_t, N> snapshot() const {
+        std::array<uint64_t, N> values{};
+        for (size_t i = 0; i < N; i++) {
+            values[i] = get(i);
+        }
+        return values;
+    }
+
+   private:
+    struct alignas(CACHE_LINE_SIZE) Slot {
+        std::atomic<uint64_t> counters[N]{};
+    };
+
+    // 线程第一次计数时按顺序分配一个槽，线程数超过槽数时多个线程共享一个槽
+    static size_t thread_slot() {
+        static std::atomic<size_t> next_slot{0};
+        thread_local size_t slot = next_slot.fetch_add(1, std::memory_order_relaxed) % STAT_COUNTER_SLOTS;
+        return slot;
+    }
+
+    Slot slots_[STAT_COUNTER_SLOTS];
+};
+
+using BufferPoolStats = std::array<uint64_t, NUM_BUFFER_STATS>;
+
+/**
+ * @description: I/O延迟的直方图，第i个桶统计延迟在[2^(i-1), 2^i)微秒之间的请求，第0个桶统计不到1微秒的请求
+ */
+class LatencyHistogram {
+   public:
+    static constexpr size_t NUM_BUCKETS = 24;   // 最后一个桶统计所有不小于2^22微秒(约4秒)的请求
+
+    void record(std::chrono::nanoseconds latency);
+
+    uint64_t count() const;
+
+    // 延迟的p分位数(0 < p <= 1)的上界，单位为微秒，没有记录时返回0
+    uint64_t percentile_us(double p) const;
+
+    void reset();
+
+   private:
+    std::atomic<uint64_t> buckets_[NUM_BUCKETS]{};
+};
+
+/**
+ * @description: 一个文件上的页面I/O统计，每次系统调用或者io_uring请求完成时累加一次
+ * 文件I/O本身需要微秒级的时间，这里直接使用relaxed原子计数，不需要按线程分散
+ */
+struct FileIoStats {
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> read_bytes{0};
+    std::atomic<uint64_t> writes{0};
+    std::atomic<uint64_t> write_bytes{0};
+    LatencyHistogram read_latency;
+    LatencyHistogram write_latency;
+
+    void record(bool is_write, size_t num_bytes, std::chrono::nanoseconds latency) {
+        if (is_write) {
+            writes.fetch_add(1, std::memory_order_relaxed);
+            write_bytes.fetch_add(num_bytes, std::memory_order_relaxed);
+            write_latency.record(latency);
+        } else {
+            reads.fetch_add(1, std::memory_order_relaxed);
+            read_bytes.fetch_add(num_bytes, std::memory_order_relaxed);
+            read_latency.record(latency);
+        }
+    }
+
+    void reset();
+};
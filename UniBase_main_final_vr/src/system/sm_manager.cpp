@@ -93,6 +93,10 @@ void SmManager::open_db(const std::string &db_name)
     { // 进入名为db_name的目录
         throw UnixError();
     }
+    if (ENABLE_DOUBLEWRITE)
+    { // 在读取任何页面之前修复上次崩溃时写了一半的页面
+        buffer_pool_manager_->enable_doublewrite(DOUBLEWRITE_FILE_NAME);
+    }
     std::ifstream ifs(DB_META_NAME);
     if (!ifs.is_open())
     { // 检查文件是否成功打开
@@ -120,6 +124,7 @@ void SmManager::close_db()
     flush_meta();
     db_.name_.clear();
     db_.tabs_.clear();
+    buffer_pool_manager_->disable_doublewrite();
     if (chdir("..") < 0)
     {
         throw UnixError();
@@ -149,6 +154,83 @@ void SmManager::show_tables(Context *context)
     outfile.close();
 }
 
+/**
+ * @description: 显示缓冲池的命中、淘汰、写回等计数，以及每个打开的表和索引文件的I/O统计
+ *              统计结果与数据无关，不写入output.txt
+ * @param {Context*} context
+ */
+void SmManager::show_buffer_stats(Context *context)
+{
+    BufferPoolStats stats = buffer_pool_manager_->get_stats();
+    uint64_t lookups = stats[BUFFER_HIT] + stats[BUFFER_MISS];
+    std::string hit_ratio = lookups == 0 ? "-" : std::to_string(stats[BUFFER_HIT] * 100 / lookups) + "%";
+    std::vector<std::vector<std::string>> pool_rows = {
+        {"pool_size", std::to_string(buffer_pool_manager_->get_pool_size())},
+        {"hits", std::to_string(stats[BUFFER_HIT])},
+        {"misses", std::to_string(stats[BUFFER_MISS])},
+        {"hit_ratio", hit_ratio},
+        {"evictions", std::to_string(stats[BUFFER_EVICTION])},
+        {"fg_writebacks", std::to_string(stats[BUFFER_FOREGROUND_WRITE])},
+        {"bg_writebacks", std::to_string(stats[BUFFER_BACKGROUND_WRITE])},
+        {"pin_waits", std::to_string(stats[BUFFER_PIN_WAIT])},
+        {"prefetches", std::to_string(stats[BUFFER_PREFETCH])},
+    };
+    RecordPrinter pool_printer(2);
+    pool_printer.print_separator(context);
+    pool_printer.print_record({"Metric", "Value"}, context);
+    pool_printer.print_separator(context);
+    for (auto &row : pool_rows)
+    {
+        pool_printer.print_record(row, context);
+    }
+    pool_printer.print_separator(context);
+
+    // 每个文件的读写次数、字节数和延迟分位数(微秒，直方图桶的上界)
+    std::vector<std::string> captions = {"File", "Reads", "Read KB", "Read p50 us", "Read p99 us",
+                                         "Writes", "Write KB", "Write p50 us", "Write p99 us"};
+    RecordPrinter io_printer(captions.size());
+    io_printer.print_separator(context);
+    io_printer.print_record(captions, context);
+    io_printer.print_separator(context);
+    for (int fd : disk_manager_->get_open_fds())
+    {
+        const FileIoStats *io = disk_manager_->get_io_stats(fd);
+        if (io == nullptr)
+        {
+            continue;
+        }
+        io_printer.print_record({disk_manager_->get_file_name(fd), std::to_string(io->reads.load()),
+                                 std::to_string(io->read_bytes.load() / 1024),
+                                 std::to_string(io->read_latency.percentile_us(0.5)),
+                                 std::to_string(io->read_latency.percentile_us(0.99)),
+                                 std::to_string(io->writes.load()), std::to_string(io->write_bytes.load() / 1024),
+                                 std::to_string(io->write_latency.percentile_us(0.5)),
+                                 std::to_string(io->write_latency.percentile_us(0.99))},
+                                context);
+    }
+    io_printer.print_separator(context);
+}
+
+/**
+ * @description: 在线调整缓冲池的帧数，显示调整后的帧数，以及缩小时回收但没有归还给操作系统的内存
+ * @param {int} pool_size 目标帧数，必须为正数，上限由BufferPoolManager::resize检查
+ * @param {Context*} context
+ */
+void SmManager::resize_buffer_pool(int pool_size, Context *context)
+{
+    if (pool_size <= 0) {
+        throw InternalError("Invalid buffer pool size: " + std::to_string(pool_size));
+    }
+    size_t new_size = buffer_pool_manager_->resize(static_cast<size_t>(pool_size));
+    RecordPrinter printer(2);
+    printer.print_separator(context);
+    printer.print_record({"Metric", "Value"}, context);
+    printer.print_separator(context);
+    printer.print_record({"pool_size", std::to_string(new_size)}, context);
+    printer.print_record({"retained_bytes", std::to_string(buffer_pool_manager_->get_retained_memory())}, context);
+    printer.print_separator(context);
+}
+
 /**
  * @description: 显示表的元数据
  * @param {string&} tab_name 表名称
@@ -179,8 +261,10 @@ void SmManager::desc_table(const std::string &tab_name, Context *context)
  * @param {string&} tab_name 表的名称
  * @param {vector<ColDef>&} col_defs 表的字段
  * @param {Context*} context
+ * @param {bool} compressed 表的数据文件是否压缩存储
  */
-void SmManager::create_table(const std::string &tab_name, const std::vector<ColDef> &col_defs, Context *context)
+void SmManager::create_table(const std::string &tab_name, const std::vector<ColDef> &col_defs, Context *context,
+                             bool compressed)
 {
     if (db_.is_table(tab_name))
     {
@@ -203,7 +287,7 @@ void SmManager::create_table(const std::string &tab_name, const std::vector<ColD
     }
     // Create & open record file
     int record_size = curr_offset; // record_size就是col meta所占的大小（表的元数据也是以记录的形式进行存储的）
-    rm_manager_->create_file(tab_name, record_size);
+    rm_manager_->create_file(tab_name, record_size, compressed);
     db_.tabs_[tab_name] = tab;
     // fhs_[tab_name] = rm_manager_->open_file(tab_name);
     fhs_.emplace(tab_name, rm_manager_->open_file(tab_name));
@@ -290,20 +374,25 @@ void SmManager::create_index(const std::string &tab_name, const std::vector<std:
         auto ih = ix_manager_->open_index(tab_name, col_indices);
 
         // Index all records into index
+        // 抽取所有记录的key排序后自底向上构建B+树，不逐条调用insert_entry
         auto file_handle = fhs_.at(tab_name).get();
+        IxEntrySorter sorter(ih.get(), index_name);
+        std::string composite_key;
         for (RmScan rm_scan(file_handle); !rm_scan.is_end(); rm_scan.next())
         {
-            auto rec = file_handle->get_record(rm_scan.rid(), context);
-
-            // Construct a composite key
-            std::string composite_key;
-            for (const auto &col : cols)
+            // Construct a composite key，直接从页面中的记录提取，提取完后释放页面
+            composite_key.clear();
             {
-                composite_key.append(rec->data + col.offset, col.len);
+                auto rec = file_handle->get_record_view(rm_scan.rid(), context);
+                for (const auto &col : cols)
+                {
+                    composite_key.append(rec.data + col.offset, col.len);
+                }
             }
 
-            ih->insert_entry(composite_key.data(), rm_scan.rid(), context->txn_);
+            sorter.add(composite_key.data(), rm_scan.rid());
         }
+        IxBulkLoader(ih.get()).load(sorter);
 
         // Store index handle
         ihs_.emplace(index_name, std::move(ih));
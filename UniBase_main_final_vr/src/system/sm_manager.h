@@ -58,9 +58,14 @@ public:
 
     void show_tables(Context *context);
 
+    void show_buffer_stats(Context *context);
+
+    void resize_buffer_pool(int pool_size, Context *context);
+
     void desc_table(const std::string &tab_name, Context *context);
 
-    void create_table(const std::string &tab_name, const std::vector<ColDef> &col_defs, Context *context);
+    void create_table(const std::string &tab_name, const std::vector<ColDef> &col_defs, Context *context,
+                      bool compressed = false);
 
     void drop_table(const std::string &tab_name, Context *context);
 
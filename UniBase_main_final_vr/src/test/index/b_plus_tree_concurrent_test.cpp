@@ -54,11 +54,11 @@ class BPlusTreeConcurrentTest : public ::testing::Test {
             }
         }
         sm_->create_db(TEST_DB_NAME);
-        // assert(disk_manager_->is_dir(TEST_DB_NAME));
+        assert(disk_manager_->is_dir(TEST_DB_NAME));
         // 进入测试目录
-        // if (chdir(TEST_DB_NAME.c_str()) < 0) {
-        //     throw UnixError();
-        // }
+        if (chdir(TEST_DB_NAME.c_str()) < 0) {
+            throw UnixError();
+        }
         // 如果测试文件存在，则先删除原文件（最后留下来的文件存的是最后一个测试点的数据）
         // if (ix_manager_->exists(TEST_FILE_NAME, TEST_COL)) {
         //     ix_manager_->destroy_index(TEST_FILE_NAME, TEST_COL);
@@ -462,4 +462,52 @@ TEST_F(BPlusTreeConcurrentTest, MixScaleTest) {
         scan.next();
     }
     EXPECT_EQ(size, keys.size() - delete_keys.size());
-}
\ No newline at end of file
+}
+
+/**
+ * @brief 32个线程并发插入、删除和查找：每个线程负责key % thread_num相同的一组key
+ * 先并发插入1~50000，再由一半线程删除各自的偶数key，另一半线程查找各自的奇数key并插入新的key
+ * order较小，树更高，分裂和合并频繁发生；结束后检查树的结构、叶子链表和扫描结果
+ */
+TEST_F(BPlusTreeConcurrentTest, MixedOperationTest) {
+    const int64_t scale = 50000;
+    const int thread_num = 32;
+    const int order = 16;
+
+    assert(order > 2 && order <= ih_->file_hdr_->btree_order_);
+    ih_->file_hdr_->btree_order_ = order;
+    IxIndexHandle *ih = ih_.get();
+
+    LaunchParallelTest(thread_num, [ih](uint64_t thread_itr) {
+        Transaction transaction(thread_itr);
+        for (int64_t key = thread_itr + 1; key <= scale; key += thread_num) {
+            Rid rid = {.page_no = 0, .slot_no = static_cast<int>(key)};
+            ih->insert_entry((const char *)&key, rid, &transaction);
+        }
+    });
+
+    LaunchParallelTest(thread_num, [ih](uint64_t thread_itr) {
+        Transaction transaction(thread_itr);
+        std::vector<Rid> rids;
+        for (int64_t key = thread_itr + 1; key <= scale; key += thread_num) {
+            if (key % 2 == 0) {
+                EXPECT_TRUE(ih->delete_entry((const char *)&key, &transaction));
+                continue;
+            }
+            rids.clear();
+            EXPECT_TRUE(ih->get_value((const char *)&key, &rids, &transaction));
+            EXPECT_EQ(rids.size(), 1);
+            EXPECT_EQ(rids[0].slot_no, key);
+            int64_t new_key = key + scale;
+            Rid rid = {.page_no = 0, .slot_no = static_cast<int>(new_key)};
+            ih->insert_entry((const char *)&new_key, rid, &transaction);
+        }
+    });
+
+    std::multimap<int, Rid> mock;
+    for (int key = 1; key <= scale; key += 2) {
+        mock.insert({key, Rid{.page_no = 0, .slot_no = key}});
+        mock.insert({key + static_cast<int>(scale), Rid{.page_no = 0, .slot_no = key + static_cast<int>(scale)}});
+    }
+    check_all(ih, mock);
+}
@@ -288,6 +288,33 @@ public:
         buffer_pool_manager_->unpin_page(node->get_page_id(), false);
     }
 
+    /**
+     * @brief dfs遍历整个树，检查除根结点之外的结点都不小于最小大小，内部的根结点至少有两个孩子
+     *
+     * @param ih 树
+     * @param now_page_no 当前遍历到的结点
+     */
+    void check_min_size(const IxIndexHandle *ih, int now_page_no)
+    {
+        IxNodeHandle *node = ih->fetch_node(now_page_no);
+        if (now_page_no != ih->file_hdr_->root_page_)
+        {
+            EXPECT_GE(node->get_size(), node->get_min_size()) << "page " << now_page_no;
+        }
+        else if (!node->is_leaf_page())
+        {
+            EXPECT_GE(node->get_size(), 2);
+        }
+        if (!node->is_leaf_page())
+        {
+            for (int i = 0; i < node->get_size(); i++)
+            {
+                check_min_size(ih, node->value_at(i));
+            }
+        }
+        buffer_pool_manager_->unpin_page(node->get_page_id(), false);
+    }
+
     /**
      * @brief
      *
@@ -461,4 +488,181 @@ TEST_F(BPlusTreeTests, LargeScaleTest)
         scan.next();
     }
     EXPECT_EQ(current_key, keys.size() + 1);
-}
\ No newline at end of file
+}
+/**
+ * @brief 用IxBulkLoader自底向上构建B+树，排序缓冲区很小以测试有序段的归并，之后继续插入
+ * 重复的key只保留rid最小的键值对
+ */
+TEST_F(BPlusTreeTests, BulkLoadTest)
+{
+    const int scale = 20000;
+    const int order = 8;
+    const double fill_factor = 0.7;
+
+    assert(order > 2 && order <= ih_->file_hdr_->btree_order_);
+    ih_->file_hdr_->btree_order_ = order;
+
+    std::vector<int> keys;
+    for (int key = 0; key < scale; key++)
+    {
+        keys.push_back(key);
+    }
+    std::shuffle(keys.begin(), keys.end(), std::default_random_engine(0));
+
+    std::multimap<int, Rid> mock;
+    IxEntrySorter sorter(ih_.get(), "bulk_load", 1000 * (sizeof(int) + sizeof(Rid)));
+    for (int key : keys)
+    {
+        Rid rid = {.page_no = key, .slot_no = 1};
+        sorter.add((const char *)&key, rid);
+        if (key % 3 == 0)
+        {
+            rid.slot_no = 0;
+            sorter.add((const char *)&key, rid);
+        }
+        mock.insert({key, rid});
+    }
+    IxBulkLoader(ih_.get(), fill_factor).load(sorter);
+    ASSERT_GT(sorter.get_num_runs(), 1);
+    check_all(ih_.get(), mock);
+    check_min_size(ih_.get(), ih_->file_hdr_->root_page_);
+
+    for (int key = scale; key < scale + 2000; key++)
+    {
+        Rid rid = {.page_no = key, .slot_no = 1};
+        ih_->insert_entry((const char *)&key, rid, txn_.get());
+        mock.insert({key, rid});
+    }
+    check_all(ih_.get(), mock);
+}
+
+/**
+ * @brief 批量构建时每层的最后一个结点不足最小大小：与左兄弟放得下时合并(可能逐层向上合并并降低树高)，否则平分
+ * 每个键值对数量和填充比例使用一个新建的索引，结点页面在测试结束前不会被其他文件复用
+ */
+TEST_F(BPlusTreeTests, BulkLoadLastNodeTest)
+{
+    const int order = 8;
+    const std::vector<double> fill_factors = {0.7, 1.0};
+    const std::vector<int> scales = {1, 6, 8, 9, 26, 28, 33, 56, 131, 157, 641};
+
+    std::vector<std::unique_ptr<IxIndexHandle>> handles;
+    for (double fill_factor : fill_factors)
+    {
+        for (int scale : scales)
+        {
+            std::string filename = "bulk_last_" + std::to_string(handles.size());
+            std::vector<ColMeta> index_cols = {{filename, "col1", TYPE_INT, 4, 0, true}};
+            ix_manager_->create_index(filename, index_cols);
+            handles.push_back(ix_manager_->open_index(filename, index_cols));
+            IxIndexHandle *ih = handles.back().get();
+            ih->file_hdr_->btree_order_ = order;
+
+            std::multimap<int, Rid> mock;
+            IxEntrySorter sorter(ih, "bulk_last", 1000 * (sizeof(int) + sizeof(Rid)));
+            for (int key = 0; key < scale; key++)
+            {
+                Rid rid = {.page_no = key, .slot_no = 1};
+                sorter.add((const char *)&key, rid);
+                mock.insert({key, rid});
+            }
+            IxBulkLoader(ih, fill_factor).load(sorter);
+            SCOPED_TRACE("fill_factor=" + std::to_string(fill_factor) + ", scale=" + std::to_string(scale));
+            check_all(ih, mock);
+            check_min_size(ih, ih->file_hdr_->root_page_);
+        }
+    }
+    for (auto &ih : handles)
+    {
+        ix_manager_->close_index(ih.get());
+    }
+}
+
+/**
+ * @brief 特化的key比较函数与逐个字段调用ix_compare的结果一致
+ */
+TEST(IxKeyComparatorTest, MatchesColumnwiseCompare)
+{
+    struct Shape
+    {
+        std::vector<ColType> types;
+        std::vector<int> lens;
+        IxKeyComparator::Kind kind;
+    };
+    const std::vector<Shape> shapes = {
+        {{TYPE_INT}, {4}, IxKeyComparator::Kind::INT},
+        {{TYPE_FLOAT}, {4}, IxKeyComparator::Kind::FLOAT},
+        {{TYPE_STRING, TYPE_STRING}, {3, 5}, IxKeyComparator::Kind::STRING},
+        {{TYPE_INT, TYPE_INT}, {4, 4}, IxKeyComparator::Kind::INT_INT},
+        {{TYPE_INT, TYPE_FLOAT, TYPE_STRING}, {4, 4, 2}, IxKeyComparator::Kind::GENERIC},
+    };
+
+    std::default_random_engine engine(0);
+    std::uniform_int_distribution<int> small(-3, 3);
+    for (auto &shape : shapes)
+    {
+        IxKeyComparator key_cmp(shape.types, shape.lens);
+        ASSERT_EQ(key_cmp.get_kind(), shape.kind);
+
+        // 每个字段只取很少的几个值，使得比较经常需要看后面的字段
+        auto random_key = [&]()
+        {
+            std::string key;
+            for (size_t i = 0; i < shape.types.size(); i++)
+            {
+                if (shape.types[i] == TYPE_INT)
+                {
+                    int value = small(engine) * 1000000000;
+                    key.append((const char *)&value, sizeof(int));
+                }
+                else if (shape.types[i] == TYPE_FLOAT)
+                {
+                    float value = small(engine) * 0.5f;
+                    key.append((const char *)&value, sizeof(float));
+                }
+                else
+                {
+                    for (int j = 0; j < shape.lens[i]; j++)
+                    {
+                        key.push_back(static_cast<char>(small(engine) * 40));
+                    }
+                }
+            }
+            return key;
+        };
+        for (int round = 0; round < 1000; round++)
+        {
+            std::string a = random_key();
+            std::string b = random_key();
+            int expected = ix_compare(a.data(), b.data(), shape.types, shape.lens);
+            int result = key_cmp(a.data(), b.data());
+            ASSERT_EQ((result > 0) - (result < 0), (expected > 0) - (expected < 0));
+        }
+    }
+}
+
+/**
+ * @brief 测试索引文件的格式版本：第1版的文件头(从tot_len开始，没有魔数和版本)打开时报错
+ */
+TEST_F(BPlusTreeTests, FormatVersionTest)
+{
+    EXPECT_EQ(ih_->file_hdr_->magic_, Page::FILE_MAGIC);
+    EXPECT_EQ(ih_->file_hdr_->format_version_, Page::FILE_FORMAT_VERSION);
+    ix_manager_->close_index(ih_.get());
+
+    std::string ix_name = ix_manager_->get_index_name(TEST_FILE_NAME, TEST_COL);
+    char hdr[PAGE_SIZE];
+    char old_hdr[PAGE_SIZE];
+    int fd = disk_manager_->open_file(ix_name);
+    disk_manager_->read_page(fd, IX_FILE_HDR_PAGE, hdr, PAGE_SIZE);
+    size_t new_fields = sizeof(uint32_t) + sizeof(int);
+    memcpy(old_hdr, hdr + new_fields, PAGE_SIZE - new_fields);
+    disk_manager_->write_page(fd, IX_FILE_HDR_PAGE, old_hdr, PAGE_SIZE);
+    disk_manager_->close_file(fd);
+    EXPECT_THROW(ix_manager_->open_index(TEST_FILE_NAME, TEST_COL), FileFormatError);
+
+    fd = disk_manager_->open_file(ix_name);
+    disk_manager_->write_page(fd, IX_FILE_HDR_PAGE, hdr, PAGE_SIZE);
+    disk_manager_->close_file(fd);
+    ih_ = ix_manager_->open_index(TEST_FILE_NAME, TEST_COL);
+}
@@ -1,7 +1,12 @@
 #include "storage/buffer_pool_manager.h"
+#include "storage/page_checksum.h"
+#include "storage/page_table.h"
 
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstring>
+#include <random>
 #include <ctime>
 #include <string>
 #include <thread>
@@ -132,6 +137,1010 @@ TEST_F(BufferPoolManagerTest, SimpleTest) {
     disk_manager_->close_file(fd);
 }
 
+/**
+ * @brief 测试使用CLOCK和LRU-K置换策略的缓冲池，被淘汰的脏页能够正确写回并重新读入
+ * @note 生成测试文件CLOCK_test、LRU-K_test
+ */
+TEST_F(BufferPoolManagerTest, ReplacerTypeTest) {
+    EXPECT_THROW(BufferPoolManager(10, disk_manager_.get(), "FIFO"), InternalError);
+
+    for (const std::string replacer_type : {"CLOCK", "LRU-K"}) {
+        const std::string filename = replacer_type + "_test";
+        const size_t buffer_pool_size = 10;
+        auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager_.get(), replacer_type);
+        disk_manager_->create_file(filename);
+        int fd = disk_manager_->open_file(filename);
+
+        // Scenario: 写入三倍于缓冲池大小的页面，迫使置换策略淘汰并写回脏页
+        const int num_pages = buffer_pool_size * 3;
+        std::vector<page_id_t> page_nos;
+        for (int i = 0; i < num_pages; ++i) {
+            PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+            auto *page = bpm->new_page(&page_id);
+            ASSERT_NE(nullptr, page);
+            page_nos.push_back(page_id.page_no);
+            snprintf(page->get_data(), PAGE_SIZE, "page %d", i);
+            EXPECT_EQ(true, bpm->unpin_page(page_id, true));
+        }
+
+        // Scenario: 所有页面都可以重新读入，内容不变
+        for (int i = 0; i < num_pages; ++i) {
+            auto *page = bpm->fetch_page(PageId{fd, page_nos[i]});
+            ASSERT_NE(nullptr, page);
+            EXPECT_EQ("page " + std::to_string(i), std::string(page->get_data()));
+            EXPECT_EQ(true, bpm->unpin_page(PageId{fd, page_nos[i]}, false));
+        }
+
+        bpm->flush_all_pages(fd);
+
+        disk_manager_->close_file(fd);
+    }
+}
+
+/**
+ * @brief 测试释放页面：被固定的页面不能释放，释放后的页面编号被new_page()复用且内容被清零
+ * @note 生成测试文件deallocate_test
+ */
+TEST_F(BufferPoolManagerTest, DeallocatePageTest) {
+    const std::string filename = "deallocate_test";
+
+    const size_t buffer_pool_size = 10;
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager);
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+
+    PageId tmp_page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+    for (int i = 0; i < 5; ++i) {
+        Page *page = bpm->new_page(&tmp_page_id);
+        ASSERT_NE(nullptr, page);
+        EXPECT_EQ(i, tmp_page_id.page_no);
+        snprintf(page->get_data(), PAGE_SIZE, "page%d", i);
+    }
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_EQ(true, bpm->unpin_page(PageId{fd, i}, true));
+    }
+
+    // 被固定的页面不能释放
+    ASSERT_NE(nullptr, bpm->fetch_page(PageId{fd, 2}));
+    EXPECT_EQ(false, bpm->deallocate_page(PageId{fd, 2}));
+    EXPECT_EQ(false, disk_manager_->is_free_page(fd, 2));
+    EXPECT_EQ(true, bpm->unpin_page(PageId{fd, 2}, false));
+
+    // 释放后再分配得到同一个页面编号，且内容不会残留
+    EXPECT_EQ(true, bpm->deallocate_page(PageId{fd, 2}));
+    EXPECT_EQ(true, disk_manager_->is_free_page(fd, 2));
+    Page *page = bpm->new_page(&tmp_page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(2, tmp_page_id.page_no);
+    EXPECT_EQ(0, page->get_data()[0]);
+    EXPECT_EQ(true, bpm->unpin_page(tmp_page_id, true));
+
+    // 释放最后一个页面时文件被截断
+    bpm->flush_all_pages(fd);
+    EXPECT_EQ(true, bpm->deallocate_page(PageId{fd, 4}));
+    EXPECT_EQ(4, disk_manager_->get_fd2pageno(fd));
+    EXPECT_EQ(4 * PAGE_SIZE, disk_manager_->get_file_size(filename));
+
+    page = bpm->fetch_page(PageId{fd, 3});
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(0, strcmp(page->get_data(), "page3"));
+    EXPECT_EQ(true, bpm->unpin_page(PageId{fd, 3}, false));
+
+    disk_manager_->close_file(fd);
+}
+
+/**
+ * @brief 测试flush_all_pages()和淘汰时合并写回相邻脏页，写回的内容应与缓冲池中一致
+ * @note 生成测试文件flush_run_test
+ */
+TEST_F(BufferPoolManagerTest, FlushRunTest) {
+    const std::string filename = "flush_run_test";
+
+    const size_t buffer_pool_size = 16;
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager);
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+
+    // 页面数是缓冲池大小的4倍，前面的页面在淘汰时连同相邻脏页一起写回
+    const int num_pages = 64;
+    PageId tmp_page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+    for (int i = 0; i < num_pages; ++i) {
+        Page *page = bpm->new_page(&tmp_page_id);
+        ASSERT_NE(nullptr, page);
+        EXPECT_EQ(i, tmp_page_id.page_no);
+        snprintf(page->get_data(), PAGE_SIZE, "page%d", i);
+        EXPECT_EQ(true, bpm->unpin_page(tmp_page_id, true));
+    }
+    // 缓冲池中的页面再修改一次，由flush_all_pages()写回
+    for (int i = num_pages - static_cast<int>(buffer_pool_size); i < num_pages; ++i) {
+        Page *page = bpm->fetch_page(PageId{fd, i});
+        ASSERT_NE(nullptr, page);
+        snprintf(page->get_data(), PAGE_SIZE, "flushed%d", i);
+        EXPECT_EQ(true, bpm->unpin_page(PageId{fd, i}, true));
+    }
+    bpm->flush_all_pages(fd);
+
+    char buf[PAGE_SIZE];
+    char expected[PAGE_SIZE];
+    for (int i = 0; i < num_pages; ++i) {
+        disk_manager_->read_page(fd, i, buf, PAGE_SIZE);
+        if (i >= num_pages - static_cast<int>(buffer_pool_size)) {
+            snprintf(expected, PAGE_SIZE, "flushed%d", i);
+        } else {
+            snprintf(expected, PAGE_SIZE, "page%d", i);
+        }
+        EXPECT_EQ(0, strcmp(buf, expected));
+    }
+
+    // 缓冲池中的页面都已干净，只修改中间的一页；绕过缓冲池改写两侧的磁盘页面，干净的页面不应被再次写回
+    const int dirty_no = num_pages - 8;
+    for (int i : {dirty_no - 1, dirty_no + 1}) {
+        snprintf(buf, PAGE_SIZE, "disk%d", i);
+        disk_manager_->write_page(fd, i, buf, PAGE_SIZE);
+    }
+    Page *page = bpm->fetch_page(PageId{fd, dirty_no});
+    ASSERT_NE(nullptr, page);
+    snprintf(page->get_data(), PAGE_SIZE, "dirty%d", dirty_no);
+    EXPECT_EQ(true, bpm->unpin_page(PageId{fd, dirty_no}, true));
+    bpm->flush_all_pages(fd);
+
+    for (int i = dirty_no - 1; i <= dirty_no + 1; ++i) {
+        disk_manager_->read_page(fd, i, buf, PAGE_SIZE);
+        snprintf(expected, PAGE_SIZE, i == dirty_no ? "dirty%d" : "disk%d", i);
+        EXPECT_EQ(0, strcmp(buf, expected));
+    }
+
+    disk_manager_->close_file(fd);
+}
+
+/**
+ * @brief 测试BufferRing：通过ring顺序读取大量页面只占用ring中的帧，缓冲池中的热点页面不被淘汰
+ * @note 生成测试文件buffer_ring_test
+ */
+TEST_F(BufferPoolManagerTest, BufferRingTest) {
+    const std::string filename = "buffer_ring_test";
+
+    const size_t buffer_pool_size = 32;
+    const int hot_pages = 16;
+    const int num_pages = 256;
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+    {
+        auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager);
+        PageId tmp_page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+        for (int i = 0; i < num_pages; ++i) {
+            Page *page = bpm->new_page(&tmp_page_id);
+            ASSERT_NE(nullptr, page);
+            snprintf(page->get_data(), PAGE_SIZE, "page%d", i);
+            EXPECT_EQ(true, bpm->unpin_page(tmp_page_id, true));
+        }
+        bpm->flush_all_pages(fd);
+    }
+
+    auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager);
+    // 热点页面在内存中被修改但不标记为脏页，只要页面一直留在缓冲池中，再次读取就能看到修改
+    auto touch_hot_pages = [&]() {
+        for (int i = 0; i < hot_pages; ++i) {
+            Page *page = bpm->fetch_page(PageId{fd, i});
+            ASSERT_NE(nullptr, page);
+            snprintf(page->get_data(), PAGE_SIZE, "hot%d", i);
+            EXPECT_EQ(true, bpm->unpin_page(PageId{fd, i}, false));
+        }
+    };
+    auto count_resident_hot_pages = [&]() {
+        int resident = 0;
+        char expected[PAGE_SIZE];
+        for (int i = 0; i < hot_pages; ++i) {
+            Page *page = bpm->fetch_page(PageId{fd, i});
+            snprintf(expected, PAGE_SIZE, "hot%d", i);
+            resident += strcmp(page->get_data(), expected) == 0;
+            bpm->unpin_page(PageId{fd, i}, false);
+        }
+        return resident;
+    };
+    auto scan = [&](BufferRing *ring) {
+        char expected[PAGE_SIZE];
+        for (int i = hot_pages; i < num_pages; ++i) {
+            Page *page = bpm->fetch_page(PageId{fd, i}, ring);
+            ASSERT_NE(nullptr, page);
+            snprintf(expected, PAGE_SIZE, "page%d", i);
+            EXPECT_EQ(0, strcmp(page->get_data(), expected));
+            EXPECT_EQ(true, bpm->unpin_page(PageId{fd, i}, false));
+        }
+    };
+
+    // Scenario: 通过ring扫描，热点页面全部保留，ring最多占用其容量的帧
+    touch_hot_pages();
+    BufferRing ring(4);
+    scan(&ring);
+    EXPECT_LE(ring.size(), ring.capacity());
+    EXPECT_EQ(hot_pages, count_resident_hot_pages());
+
+    // Scenario: 不使用ring扫描，热点页面被挤出缓冲池
+    touch_hot_pages();
+    scan(nullptr);
+    EXPECT_EQ(0, count_resident_hot_pages());
+
+    disk_manager_->close_file(fd);
+}
+
+/**
+ * @brief 测试异步预读：预读的页面内容正确且不会一直被固定，已在缓冲池中的页面不重复预读，读取失败的页面被移除
+ * @note 生成测试文件prefetch_test
+ */
+TEST_F(BufferPoolManagerTest, PrefetchTest) {
+    const std::string filename = "prefetch_test";
+
+    const size_t buffer_pool_size = 32;
+    const int num_pages = 64;
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+    std::vector<page_id_t> page_nos;
+    {
+        auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager);
+        PageId tmp_page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+        for (int i = 0; i < num_pages; ++i) {
+            Page *page = bpm->new_page(&tmp_page_id);
+            ASSERT_NE(nullptr, page);
+            snprintf(page->get_data(), PAGE_SIZE, "page%d", i);
+            page_nos.push_back(tmp_page_id.page_no);
+            EXPECT_EQ(true, bpm->unpin_page(tmp_page_id, true));
+        }
+        bpm->flush_all_pages(fd);
+    }
+
+    auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager);
+    auto check_pages = [&](int begin, int end) {
+        char expected[PAGE_SIZE];
+        for (int i = begin; i < end; ++i) {
+            Page *page = bpm->fetch_page(PageId{fd, page_nos[i]});
+            ASSERT_NE(nullptr, page);
+            snprintf(expected, PAGE_SIZE, "page%d", i);
+            EXPECT_EQ(0, strcmp(page->get_data(), expected));
+            EXPECT_EQ(true, bpm->unpin_page(PageId{fd, page_nos[i]}, false));
+        }
+    };
+
+    // Scenario: 预读前一半页面，fetch_page等待预读完成后读到正确的内容
+    std::vector<page_id_t> first_half(page_nos.begin(), page_nos.begin() + buffer_pool_size);
+    EXPECT_EQ(buffer_pool_size, bpm->prefetch_pages(fd, first_half));
+    check_pages(0, buffer_pool_size);
+
+    // Scenario: 已经在缓冲池中的页面不再预读
+    EXPECT_EQ(0, bpm->prefetch_pages(fd, first_half));
+
+    // Scenario: 预读完成后帧不再被固定，读取后一半页面可以淘汰它们
+    check_pages(buffer_pool_size, num_pages);
+
+    // Scenario: 超出文件末尾的页面读取失败，帧被归还，不影响后续读取
+    EXPECT_EQ(1, bpm->prefetch_pages(fd, {page_nos.back() + 1000}));
+    std::vector<page_id_t> second_half(page_nos.begin() + buffer_pool_size, page_nos.end());
+    bpm->prefetch_pages(fd, second_half);
+    check_pages(0, num_pages);
+
+    // 关闭文件前flush_all_pages等待预读完成
+    bpm->flush_all_pages(fd);
+    disk_manager_->close_file(fd);
+}
+
+/**
+ * @brief 测试页面guard：析构时自动取消固定并传递脏页标记，读guard之间共享、与写guard互斥
+ * @note 生成测试文件page_guard_test
+ */
+TEST_F(BufferPoolManagerTest, PageGuardTest) {
+    const std::string filename = "page_guard_test";
+
+    const size_t buffer_pool_size = 4;
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager);
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+
+    // Scenario: 通过WritePageGuard修改的页面被淘汰后能重新读入
+    PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+    {
+        WritePageGuard guard = bpm->new_page_guarded(&page_id);
+        ASSERT_TRUE(guard.is_valid());
+        snprintf(guard.get_data(), PAGE_SIZE, "guarded");
+    }
+    for (size_t i = 0; i < buffer_pool_size * 4; ++i) {
+        PageId tmp_page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+        ASSERT_TRUE(bpm->new_page_guarded(&tmp_page_id).is_valid());
+    }
+    {
+        ReadPageGuard guard = bpm->fetch_page_read(page_id);
+        ASSERT_TRUE(guard.is_valid());
+        EXPECT_EQ(0, strcmp(guard.get_data(), "guarded"));
+    }
+
+    // Scenario: guard释放后页面不再被固定，可以删除；移动后的guard只释放一次
+    {
+        ReadPageGuard guard = bpm->fetch_page_read(page_id);
+        EXPECT_EQ(false, bpm->delete_page(page_id));
+        BasicPageGuard moved = std::move(guard);
+        EXPECT_FALSE(guard.is_valid());
+        EXPECT_EQ(false, bpm->delete_page(page_id));
+    }
+    EXPECT_EQ(true, bpm->delete_page(page_id));
+    EXPECT_EQ(false, bpm->unpin_page(page_id, false));
+
+    // Scenario: 多个读guard可以同时持有同一个页面，写guard等待所有读guard释放
+    ReadPageGuard reader1 = bpm->fetch_page_read(page_id);
+    ReadPageGuard reader2 = bpm->fetch_page_read(page_id);
+    std::atomic<bool> written{false};
+    std::thread writer([&]() {
+        WritePageGuard guard = bpm->fetch_page_write(page_id);
+        snprintf(guard.get_data(), PAGE_SIZE, "written");
+        written = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(written);
+    EXPECT_EQ(0, strcmp(reader2.get_data(), "guarded"));
+    reader1.drop();
+    reader2.drop();
+    writer.join();
+    EXPECT_TRUE(written);
+    EXPECT_EQ(0, strcmp(bpm->fetch_page_read(page_id).get_data(), "written"));
+
+    // Scenario: 写回等待持有写guard的线程修改完成，写入磁盘的是修改完成后的页面
+    {
+        WritePageGuard guard = bpm->fetch_page_write(page_id);
+        snprintf(guard.get_data(), PAGE_SIZE, "half");
+        std::atomic<bool> flushed{false};
+        std::thread flusher([&]() {
+            bpm->flush_all_pages(fd);
+            flushed = true;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        EXPECT_FALSE(flushed);
+        snprintf(guard.get_data(), PAGE_SIZE, "complete");
+        guard.drop();
+        flusher.join();
+        char buf[PAGE_SIZE];
+        disk_manager_->read_page(fd, page_id.page_no, buf, PAGE_SIZE);
+        EXPECT_EQ(0, strcmp(buf, "complete"));
+    }
+
+    bpm->flush_all_pages(fd);
+    disk_manager_->close_file(fd);
+}
+
+/**
+ * @brief 测试帧内存：arena按大页对齐且由内核清零，帧描述符按缓存行对齐，创建默认大小的缓冲池不需要逐页初始化
+ *        回收的帧的内存归还给操作系统，MAP_HUGETLB大页中的帧全部回收之后才归还
+ * @note 生成测试文件frame_arena_test
+ */
+TEST_F(BufferPoolManagerTest, FrameArenaTest) {
+    const std::string filename = "frame_arena_test";
+
+    FrameArena arena(PAGE_SIZE * 3);
+    EXPECT_EQ(HUGE_PAGE_SIZE, arena.size());
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(arena.data()) % HUGE_PAGE_SIZE);
+    for (size_t i = 0; i < arena.size(); i += PAGE_SIZE) {
+        EXPECT_EQ(0, arena.data()[i]);
+    }
+    EXPECT_EQ(0, sizeof(Page) % CACHE_LINE_SIZE);
+
+    arena.data()[0] = 1;
+    bool released_first = arena.retire_frame(arena.data());
+    arena.retire_frame(arena.data() + PAGE_SIZE);
+    bool released_all = arena.retire_frame(arena.data() + 2 * PAGE_SIZE);
+    if (arena.is_huge_tlb()) {
+        EXPECT_FALSE(released_first);
+        EXPECT_EQ(released_all ? 0 : 3 * PAGE_SIZE, arena.retained_bytes());
+    } else {
+        EXPECT_TRUE(released_first);
+        EXPECT_TRUE(released_all);
+        EXPECT_EQ(0, arena.retained_bytes());
+    }
+    if (released_all) {
+        EXPECT_EQ(0, arena.data()[0]);
+    }
+    arena.reuse_frame(arena.data());
+    EXPECT_EQ(arena.is_huge_tlb() ? 2 * PAGE_SIZE : 0, arena.retained_bytes());
+    arena.reuse_frame(arena.data() + PAGE_SIZE);
+    arena.reuse_frame(arena.data() + 2 * PAGE_SIZE);
+    EXPECT_EQ(0, arena.retained_bytes());
+
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    auto bpm = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager);
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+    PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+    Page *page = bpm->new_page(&page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(page->get_data()) % DIRECT_IO_ALIGNMENT);
+    EXPECT_EQ(0, page->get_data()[0]);
+    EXPECT_EQ(true, bpm->unpin_page(page_id, false));
+
+    bpm->flush_all_pages(fd);
+    disk_manager_->close_file(fd);
+}
+
+/**
+ * @brief 测试在线调整缓冲池大小：缩小时脏页先写回，被固定的页面不被回收且地址不变；扩大时复用回收的帧；
+ *        多个线程读取页面的同时反复调整大小，读到的内容始终正确
+ * @note 生成测试文件resize_test
+ */
+TEST_F(BufferPoolManagerTest, ResizeTest) {
+    const std::string filename = "resize_test";
+
+    const size_t buffer_pool_size = 8;
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager);
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+
+    std::vector<page_id_t> page_nos;
+    PageId tmp_page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+    for (size_t i = 0; i < buffer_pool_size; ++i) {
+        Page *page = bpm->new_page(&tmp_page_id);
+        ASSERT_NE(nullptr, page);
+        snprintf(page->get_data(), PAGE_SIZE, "page%zu", i);
+        page_nos.push_back(tmp_page_id.page_no);
+        EXPECT_EQ(true, bpm->unpin_page(tmp_page_id, true));
+    }
+    auto check_page = [&](size_t i) {
+        char expected[PAGE_SIZE];
+        Page *page = bpm->fetch_page(PageId{fd, page_nos[i]});
+        ASSERT_NE(nullptr, page);
+        snprintf(expected, PAGE_SIZE, "page%zu", i);
+        EXPECT_EQ(0, strcmp(page->get_data(), expected));
+        EXPECT_EQ(true, bpm->unpin_page(PageId{fd, page_nos[i]}, false));
+    };
+
+    // Scenario: 缩小缓冲池，被淘汰的脏页写回磁盘，被固定的页面保留在原来的帧中
+    Page *pinned = bpm->fetch_page(PageId{fd, page_nos[0]});
+    ASSERT_NE(nullptr, pinned);
+    EXPECT_EQ(2, bpm->resize(2));
+    EXPECT_EQ(2, bpm->get_pool_size());
+    EXPECT_EQ(0, strcmp(pinned->get_data(), "page0"));
+    for (size_t i = 0; i < buffer_pool_size; ++i) {
+        check_page(i);
+    }
+
+    // Scenario: 所有帧都被固定时无法继续缩小，也无法创建新页面
+    Page *pinned2 = bpm->fetch_page(PageId{fd, page_nos[1]});
+    ASSERT_NE(nullptr, pinned2);
+    EXPECT_EQ(2, bpm->resize(1));
+    EXPECT_EQ(nullptr, bpm->new_page(&tmp_page_id));
+
+    // Scenario: 扩大缓冲池之后可以创建新页面，已经固定的页面不受影响
+    EXPECT_EQ(16, bpm->resize(16));
+    for (int i = 0; i < 14; ++i) {
+        Page *page = bpm->new_page(&tmp_page_id);
+        ASSERT_NE(nullptr, page);
+        EXPECT_EQ(true, bpm->unpin_page(tmp_page_id, false));
+    }
+    EXPECT_EQ(0, strcmp(pinned->get_data(), "page0"));
+    EXPECT_EQ(true, bpm->unpin_page(PageId{fd, page_nos[0]}, false));
+    EXPECT_EQ(true, bpm->unpin_page(PageId{fd, page_nos[1]}, false));
+    EXPECT_THROW(bpm->resize(0), InternalError);
+    // 超过物理内存的帧数被拒绝，缓冲池大小不变
+    EXPECT_THROW(bpm->resize(SIZE_MAX), InternalError);
+    EXPECT_THROW(bpm->resize(SIZE_MAX / PAGE_SIZE + 1), InternalError);
+    EXPECT_EQ(16, bpm->get_pool_size());
+
+    // Scenario: 多个分区的缓冲池在被并发读取时反复扩大和缩小
+    bpm->flush_all_pages(fd);
+    bpm = std::make_unique<BufferPoolManager>(MIN_FRAMES_PER_SHARD * 4, disk_manager);
+    ASSERT_EQ(4, bpm->get_num_shards());
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> readers;
+    for (int tid = 0; tid < 4; ++tid) {
+        readers.emplace_back([&, tid]() {
+            std::mt19937 rng(tid);
+            while (!stop.load()) {
+                check_page(rng() % buffer_pool_size);
+            }
+        });
+    }
+    // 每个分区至少保留8个帧，多于读线程同时固定的页面数
+    for (size_t size : {32, 512, 64, 256, 32, 1024}) {
+        EXPECT_EQ(size, bpm->resize(size));
+    }
+    stop = true;
+    for (auto &reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(1024, bpm->get_pool_size());
+
+    bpm->flush_all_pages(fd);
+    disk_manager_->close_file(fd);
+}
+
+/**
+ * @brief 测试缓冲池的统计计数：命中、未命中、淘汰和写回，多个线程的计数汇总后不丢失
+ * @note 生成测试文件stats_test
+ */
+TEST_F(BufferPoolManagerTest, StatsTest) {
+    const std::string filename = "stats_test";
+
+    const size_t buffer_pool_size = 4;
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager);
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+
+    std::vector<page_id_t> page_nos;
+    PageId tmp_page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+    for (size_t i = 0; i < buffer_pool_size; ++i) {
+        ASSERT_NE(nullptr, bpm->new_page(&tmp_page_id));
+        page_nos.push_back(tmp_page_id.page_no);
+        EXPECT_EQ(true, bpm->unpin_page(tmp_page_id, true));
+    }
+    BufferPoolStats stats = bpm->get_stats();
+    EXPECT_EQ(0, stats[BUFFER_HIT]);
+    EXPECT_EQ(0, stats[BUFFER_MISS]);
+    EXPECT_EQ(0, stats[BUFFER_EVICTION]);
+
+    // Scenario: 页面都在缓冲池中，fetch_page全部命中
+    for (page_id_t page_no : page_nos) {
+        ASSERT_NE(nullptr, bpm->fetch_page(PageId{fd, page_no}));
+        EXPECT_EQ(true, bpm->unpin_page(PageId{fd, page_no}, false));
+    }
+    EXPECT_EQ(buffer_pool_size, bpm->get_stats()[BUFFER_HIT]);
+
+    // Scenario: 新页面淘汰一个脏页，之后读回被淘汰的页面时未命中
+    ASSERT_NE(nullptr, bpm->new_page(&tmp_page_id));
+    EXPECT_EQ(true, bpm->unpin_page(tmp_page_id, false));
+    stats = bpm->get_stats();
+    EXPECT_EQ(1, stats[BUFFER_EVICTION]);
+    EXPECT_LE(1, stats[BUFFER_FOREGROUND_WRITE]);
+    bpm->flush_all_pages(fd);
+    for (page_id_t page_no : page_nos) {
+        ASSERT_NE(nullptr, bpm->fetch_page(PageId{fd, page_no}));
+        EXPECT_EQ(true, bpm->unpin_page(PageId{fd, page_no}, false));
+    }
+    stats = bpm->get_stats();
+    EXPECT_LE(1, stats[BUFFER_MISS]);
+    EXPECT_EQ(2 * buffer_pool_size, stats[BUFFER_HIT] + stats[BUFFER_MISS]);
+    EXPECT_EQ(1 + stats[BUFFER_MISS], stats[BUFFER_EVICTION]);
+    EXPECT_LE(stats[BUFFER_MISS], disk_manager_->get_io_stats(fd)->reads.load());
+
+    // Scenario: 多个线程并发访问同一个页面，各线程的计数汇总后与访问次数相等
+    const int num_threads = 8;
+    const int num_fetches = 1000;
+    uint64_t hits_before = stats[BUFFER_HIT] + stats[BUFFER_MISS];
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < num_threads; ++tid) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < num_fetches; ++i) {
+                Page *page = bpm->fetch_page(PageId{fd, page_nos[0]});
+                ASSERT_NE(nullptr, page);
+                bpm->unpin_page(PageId{fd, page_nos[0]}, false);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    stats = bpm->get_stats();
+    EXPECT_EQ(hits_before + num_threads * num_fetches, stats[BUFFER_HIT] + stats[BUFFER_MISS]);
+
+    bpm->flush_all_pages(fd);
+    disk_manager_->close_file(fd);
+}
+
+/**
+ * @brief 测试页表：随机插入、查找和删除，与unordered_map的结果对比；容量很小，探测序列会绕回表头
+ *        默认的std::hash<PageId>不再把fd和page_no重叠在一起
+ */
+TEST_F(BufferPoolManagerTest, PageTableTest) {
+    const size_t capacity = 64;
+    std::vector<Page> pages(capacity / 2);
+    PageTable table(capacity);
+    std::unordered_map<PageId, Page *, PageIdHash> mock;
+    std::mt19937 rng(2024);
+
+    for (int op = 0; op < 100000; op++) {
+        PageId page_id = {.fd = static_cast<int>(rng() % 4), .page_no = static_cast<page_id_t>(rng() % 64)};
+        auto it = mock.find(page_id);
+        if (it == mock.end() && mock.size() < pages.size() && rng() % 2 == 0) {
+            Page *page = &pages[rng() % pages.size()];
+            table.insert(page_id, page);
+            mock[page_id] = page;
+        } else if (it != mock.end() && rng() % 2 == 0) {
+            EXPECT_TRUE(table.erase(page_id));
+            mock.erase(it);
+        } else {
+            EXPECT_EQ(it == mock.end() ? nullptr : it->second, table.find(page_id));
+        }
+        ASSERT_EQ(mock.size(), table.size());
+    }
+    for (auto &[page_id, page] : mock) {
+        EXPECT_EQ(page, table.find(page_id));
+    }
+    EXPECT_FALSE(table.erase(PageId{.fd = 5, .page_no = 0}));
+    EXPECT_EQ(nullptr, table.find(PageId{.fd = 5, .page_no = 0}));
+
+    // 默认的std::hash<PageId>与PageIdHash一致：fd左移16位后与page_no重叠的PageId哈希值不同
+    PageId a = {.fd = 1, .page_no = 0};
+    PageId b = {.fd = 0, .page_no = 1 << 16};
+    EXPECT_EQ(PageIdHash()(a), std::hash<PageId>()(a));
+    EXPECT_NE(std::hash<PageId>()(a), std::hash<PageId>()(b));
+}
+
+/**
+ * @brief 测试不加分区锁的命中：多个线程反复读取热点页面，同时另一个线程顺序读取冷页面不断淘汰帧，
+ *        期间缓冲池扩大，页表换成更大的；读到的页面内容必须正确，结束后所有页面都没有被固定
+ * @note 生成测试文件lock_free_hit_test
+ */
+TEST_F(BufferPoolManagerTest, LockFreeHitTest) {
+    const std::string filename = "lock_free_hit_test";
+    const int buffer_pool_size = 64;
+    const int hot_pages = 8;
+    const int num_pages = 512;
+    const int num_readers = 8;
+    const int num_fetches = 20000;
+
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    auto bpm = std::make_unique<BufferPoolManager>(static_cast<size_t>(buffer_pool_size), disk_manager);
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+
+    for (int i = 0; i < num_pages; i++) {
+        PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+        Page *page = bpm->new_page(&page_id);
+        ASSERT_NE(nullptr, page);
+        memcpy(page->get_data(), &page_id.page_no, sizeof(page_id.page_no));
+        EXPECT_EQ(true, bpm->unpin_page(page_id, true));
+    }
+    bpm->flush_all_pages(fd);
+
+    std::atomic<int> errors{0};
+    std::atomic<bool> done{false};
+    auto check = [&](page_id_t page_no) {
+        PageId page_id = {.fd = fd, .page_no = page_no};
+        Page *page = bpm->fetch_page(page_id);
+        while (page == nullptr) {
+            std::this_thread::yield();
+            page = bpm->fetch_page(page_id);
+        }
+        page_id_t stamp;
+        memcpy(&stamp, page->get_data(), sizeof(stamp));
+        if (stamp != page_no || !(page->get_page_id() == page_id)) errors++;
+        // 多次固定同一个页面，除最后一次以外的取消固定不需要分区锁
+        Page *again = bpm->fetch_page(page_id);
+        if (again != page) errors++;
+        if (!bpm->unpin_page(page_id, false)) errors++;
+        if (!bpm->unpin_page(page_id, false)) errors++;
+    };
+
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < num_readers; tid++) {
+        threads.emplace_back([&, tid]() {
+            std::mt19937 rng(tid);
+            for (int i = 0; i < num_fetches; i++) {
+                check(static_cast<page_id_t>(rng() % hot_pages));
+            }
+        });
+    }
+    std::thread scanner([&]() {
+        for (page_id_t page_no = hot_pages; !done; page_no = page_no + 1 < num_pages ? page_no + 1 : hot_pages) {
+            check(page_no);
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    bpm->resize(buffer_pool_size * 8);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    done = true;
+    scanner.join();
+    EXPECT_EQ(0, errors.load());
+
+    BufferPoolStats stats = bpm->get_stats();
+    EXPECT_GE(stats[BUFFER_HIT], static_cast<uint64_t>(num_readers * num_fetches));
+
+    // 所有页面都已经取消固定，都可以删除
+    for (int i = 0; i < num_pages; i++) {
+        EXPECT_EQ(true, bpm->delete_page(PageId{.fd = fd, .page_no = i}));
+    }
+    disk_manager_->close_file(fd);
+}
+
+/**
+ * @brief 测试CRC32C：标准测试向量、分段计算，以及计算一个页面校验和的耗时
+ */
+TEST_F(BufferPoolManagerTest, ChecksumTest) {
+    EXPECT_EQ(0xE3069283u, crc32c("123456789", 9));
+    EXPECT_EQ(0u, crc32c("", 0));
+    char zeros[32] = {};
+    EXPECT_EQ(0x8A9136AAu, crc32c(zeros, sizeof(zeros)));
+
+    std::vector<char> page(PAGE_SIZE);
+    std::mt19937 rng(7);
+    for (auto &c : page) c = static_cast<char>(rng());
+    for (size_t split : {size_t{1}, size_t{7}, size_t{100}, size_t{PAGE_SIZE - 3}}) {
+        EXPECT_EQ(crc32c(page.data(), PAGE_SIZE), crc32c(page.data() + split, PAGE_SIZE - split, crc32c(page.data(), split)));
+    }
+
+    set_page_checksum(page.data());
+    EXPECT_TRUE(verify_page_checksum(page.data()));
+    page[PAGE_SIZE - 1] ^= 0x10;
+    EXPECT_FALSE(verify_page_checksum(page.data()));
+    std::fill(page.begin(), page.end(), 0);
+    EXPECT_TRUE(verify_page_checksum(page.data()));  // 从未写回的页面
+
+    const int rounds = 20000;
+    uint32_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        page[i % PAGE_SIZE]++;
+        sink += compute_page_checksum(page.data());
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / rounds;
+    std::cout << (crc32c_hardware_enabled() ? "sse4.2" : "software") << " page checksum: " << ns << " ns/page"
+              << " (" << sink % 2 << ")" << std::endl;
+}
+
+/**
+ * @brief 测试页面校验和：开启校验和的文件写回时计算，读入时校验；
+ *        直接修改磁盘上的页面后，fetch_page和预读都能发现损坏，其他页面不受影响
+ * @note 生成测试文件checksum_test
+ */
+TEST_F(BufferPoolManagerTest, PageCorruptionTest) {
+    const std::string filename = "checksum_test";
+    const int num_pages = 32;
+    const page_id_t corrupted = 5;
+
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+    disk_manager_->set_page_checksums(fd, true);
+    {
+        auto bpm = std::make_unique<BufferPoolManager>(static_cast<size_t>(16), disk_manager);
+        for (int i = 0; i < num_pages; i++) {
+            PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+            Page *page = bpm->new_page(&page_id);
+            ASSERT_NE(nullptr, page);
+            snprintf(page->get_data() + Page::OFFSET_PAGE_HDR, PAGE_SIZE - Page::OFFSET_PAGE_HDR, "page%d", i);
+            EXPECT_EQ(true, bpm->unpin_page(page_id, true));
+        }
+        bpm->flush_all_pages(fd);
+    }
+
+    // 所有页面在磁盘上都带有正确的校验和
+    char buf[PAGE_SIZE];
+    for (int i = 0; i < num_pages; i++) {
+        disk_manager_->read_page(fd, i, buf, PAGE_SIZE);
+        EXPECT_TRUE(verify_page_checksum(buf));
+    }
+    // 翻转一个页面中的一位，模拟位衰减
+    disk_manager_->read_page(fd, corrupted, buf, PAGE_SIZE);
+    buf[PAGE_SIZE / 2] ^= 0x04;
+    disk_manager_->write_page(fd, corrupted, buf, PAGE_SIZE);
+
+    auto bpm = std::make_unique<BufferPoolManager>(static_cast<size_t>(16), disk_manager);
+    EXPECT_THROW(bpm->fetch_page(PageId{fd, corrupted}), PageChecksumError);
+    EXPECT_THROW(bpm->fetch_page(PageId{fd, corrupted}), PageChecksumError);  // 损坏的页面没有留在缓冲池中
+    for (int i = 0; i < num_pages; i++) {
+        if (i == corrupted) continue;
+        Page *page = bpm->fetch_page(PageId{fd, i});
+        ASSERT_NE(nullptr, page);
+        EXPECT_EQ("page" + std::to_string(i), std::string(page->get_data() + Page::OFFSET_PAGE_HDR));
+        EXPECT_EQ(true, bpm->unpin_page(PageId{fd, i}, false));
+    }
+
+    // 预读时发现的损坏在之后的fetch_page中报告
+    bpm = std::make_unique<BufferPoolManager>(static_cast<size_t>(16), disk_manager);
+    EXPECT_EQ(3, bpm->prefetch_pages(fd, {corrupted - 1, corrupted, corrupted + 1}));
+    Page *page = bpm->fetch_page(PageId{fd, corrupted + 1});  // 等待预读完成
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page" + std::to_string(corrupted + 1), std::string(page->get_data() + Page::OFFSET_PAGE_HDR));
+    EXPECT_EQ(true, bpm->unpin_page(PageId{fd, corrupted + 1}, false));
+    EXPECT_THROW(bpm->fetch_page(PageId{fd, corrupted}), PageChecksumError);
+
+    // 修改并重新写回后校验和恢复正确
+    {
+        auto writer = std::make_unique<BufferPoolManager>(static_cast<size_t>(16), disk_manager);
+        disk_manager_->set_page_checksums(fd, false);
+        page = writer->fetch_page(PageId{fd, corrupted});
+        ASSERT_NE(nullptr, page);
+        disk_manager_->set_page_checksums(fd, true);
+        snprintf(page->get_data() + Page::OFFSET_PAGE_HDR, PAGE_SIZE - Page::OFFSET_PAGE_HDR, "repaired");
+        EXPECT_EQ(true, writer->unpin_page(PageId{fd, corrupted}, true));
+        writer->flush_all_pages(fd);
+    }
+    bpm = std::make_unique<BufferPoolManager>(static_cast<size_t>(16), disk_manager);
+    page = bpm->fetch_page(PageId{fd, corrupted});
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("repaired", std::string(page->get_data() + Page::OFFSET_PAGE_HDR));
+    EXPECT_EQ(true, bpm->unpin_page(PageId{fd, corrupted}, false));
+
+    bpm.reset();
+    disk_manager_->close_file(fd);
+    EXPECT_FALSE(disk_manager_->has_page_checksums(fd));
+}
+
+/**
+ * @brief 测试doublewrite：写回的页面先进入doublewrite文件，原地写入写了一半的页面在恢复时用副本修复
+ * @note 生成测试文件doublewrite_test和doublewrite_test.dblwr
+ */
+TEST_F(BufferPoolManagerTest, DoublewriteTest) {
+    const std::string filename = "doublewrite_test";
+    const std::string dw_filename = "doublewrite_test.dblwr";
+    const int num_pages = 32;
+    const size_t dw_pages = 8;  // 小于页面数，写回过程中doublewrite文件会清空后从头写入
+    const page_id_t torn = num_pages - 1;
+
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+    disk_manager_->set_page_checksums(fd, true);
+    {
+        auto bpm = std::make_unique<BufferPoolManager>(static_cast<size_t>(64), disk_manager);
+        EXPECT_EQ(0, bpm->enable_doublewrite(dw_filename, dw_pages));
+        for (int i = 0; i < num_pages; i++) {
+            PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+            Page *page = bpm->new_page(&page_id);
+            ASSERT_NE(nullptr, page);
+            snprintf(page->get_data() + Page::OFFSET_PAGE_HDR, PAGE_SIZE - Page::OFFSET_PAGE_HDR, "page%d", i);
+            EXPECT_EQ(true, bpm->unpin_page(page_id, true));
+        }
+        bpm->flush_all_pages(fd);
+        // 每条记录最多dw_pages-1个页面
+        EXPECT_GE(bpm->get_doublewrite_batches(), (num_pages + dw_pages - 2) / (dw_pages - 1));
+        bpm->disable_doublewrite();
+        EXPECT_EQ(0, bpm->get_doublewrite_batches());
+    }
+
+    // 模拟原地写入只完成了前半个页面：后半个页面还是旧的内容
+    char buf[PAGE_SIZE];
+    disk_manager_->read_page(fd, torn, buf, PAGE_SIZE);
+    EXPECT_TRUE(verify_page_checksum(buf));
+    memset(buf + PAGE_SIZE / 2, 0, PAGE_SIZE / 2);
+    buf[PAGE_SIZE - 1] = 1;
+    disk_manager_->write_page(fd, torn, buf, PAGE_SIZE);
+    disk_manager_->read_page(fd, torn, buf, PAGE_SIZE);
+    EXPECT_FALSE(verify_page_checksum(buf));
+
+    {
+        DoublewriteBuffer doublewrite(disk_manager, dw_filename, dw_pages);
+        EXPECT_EQ(1, doublewrite.recover());
+        EXPECT_EQ(0, doublewrite.recover());  // 修复之后页面的校验和正确
+    }
+    disk_manager_->read_page(fd, torn, buf, PAGE_SIZE);
+    EXPECT_TRUE(verify_page_checksum(buf));
+
+    auto bpm = std::make_unique<BufferPoolManager>(static_cast<size_t>(64), disk_manager);
+    for (int i = 0; i < num_pages; i++) {
+        Page *page = bpm->fetch_page(PageId{fd, i});
+        ASSERT_NE(nullptr, page);
+        EXPECT_EQ("page" + std::to_string(i), std::string(page->get_data() + Page::OFFSET_PAGE_HDR));
+        EXPECT_EQ(true, bpm->unpin_page(PageId{fd, i}, false));
+    }
+    bpm.reset();
+    disk_manager_->close_file(fd);
+}
+
+/**
+ * @brief 测试doublewrite文件从头写入和恢复之后清空：文件后部残留的旧记录不能在恢复时把页面改回旧的副本
+ * @note 生成测试文件doublewrite_wrap_test和doublewrite_wrap_test.dblwr
+ */
+TEST_F(BufferPoolManagerTest, DoublewriteWrapTest) {
+    const std::string filename = "doublewrite_wrap_test";
+    const std::string dw_filename = "doublewrite_wrap_test.dblwr";
+    const size_t dw_pages = 16;
+    const page_id_t victim = 20;
+
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+    disk_manager_->set_page_checksums(fd, true);
+
+    std::vector<std::vector<char>> copies;
+    auto write_run = [&](DoublewriteBuffer &doublewrite, page_id_t first_page_no, int num_pages, int version) {
+        copies.assign(num_pages, std::vector<char>(PAGE_SIZE, 0));
+        std::vector<const char *> pages;
+        for (int i = 0; i < num_pages; i++) {
+            char *data = copies[i].data();
+            snprintf(data + Page::OFFSET_PAGE_HDR, PAGE_SIZE - Page::OFFSET_PAGE_HDR, "v%d", version);
+            set_page_checksum(data);
+            pages.push_back(data);
+        }
+        doublewrite.write(fd, first_page_no, pages);
+    };
+    {
+        DoublewriteBuffer doublewrite(disk_manager, dw_filename, dw_pages);
+        EXPECT_EQ(0, doublewrite.recover());
+        write_run(doublewrite, 0, 11, 1);       // 页面0~10，占用0~11
+        write_run(doublewrite, victim, 1, 1);   // 占用12~13：这条记录在之后从头写入时留在文件后部
+        write_run(doublewrite, victim, 3, 2);   // 放不下，从头写入，占用0~3
+        write_run(doublewrite, 0, 7, 2);        // 占用4~11
+        write_run(doublewrite, 0, 5, 3);        // 放不下，从头写入，覆盖了victim的v2副本，没有覆盖12~13
+        doublewrite.sync_data_files();
+    }
+
+    // victim已经同步为v2；校验和损坏时不能用残留的v1副本修复
+    char buf[PAGE_SIZE];
+    disk_manager_->read_page(fd, victim, buf, PAGE_SIZE);
+    EXPECT_EQ("v2", std::string(buf + Page::OFFSET_PAGE_HDR));
+    buf[PAGE_SIZE - 1] ^= 1;
+    disk_manager_->write_page(fd, victim, buf, PAGE_SIZE);
+    {
+        DoublewriteBuffer doublewrite(disk_manager, dw_filename, dw_pages);
+        EXPECT_EQ(0, doublewrite.recover());
+        EXPECT_EQ(0, disk_manager_->get_file_size(dw_filename));  // 恢复之后清空
+    }
+    disk_manager_->read_page(fd, victim, buf, PAGE_SIZE);
+    EXPECT_EQ("v2", std::string(buf + Page::OFFSET_PAGE_HDR));
+
+    disk_manager_->close_file(fd);
+}
+
+/**
+ * @brief 测试后台页面清理：按lsn顺序写回未被固定的脏页，遵守WAL规则，并区分前台和后台写回的计数
+ * @note 生成测试文件page_cleaner_test
+ */
+TEST_F(BufferPoolManagerTest, PageCleanerTest) {
+    const std::string filename = "page_cleaner_test";
+
+    const size_t buffer_pool_size = 16;
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager);
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+
+    // 页面i的lsn为i * 10，编号越小的页面越早被修改
+    PageId tmp_page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+    for (int i = 0; i < static_cast<int>(buffer_pool_size); ++i) {
+        Page *page = bpm->new_page(&tmp_page_id);
+        ASSERT_NE(nullptr, page);
+        page->set_page_lsn(i * 10);
+        EXPECT_EQ(true, bpm->unpin_page(tmp_page_id, true));
+    }
+    auto is_dirty = [&](int page_no) {
+        Page *page = bpm->fetch_page(PageId{fd, page_no});
+        bool dirty = page->is_dirty();
+        bpm->unpin_page(PageId{fd, page_no}, false);
+        return dirty;
+    };
+
+    // Scenario: 日志只持久化到lsn 25，只有lsn为0、10、20的页面0、1、2可以写回
+    bpm->set_persist_lsn_provider([]() { return 25; });
+    EXPECT_EQ(3, bpm->clean_pages(8));
+    for (int i = 0; i < static_cast<int>(buffer_pool_size); ++i) {
+        EXPECT_EQ(i >= 3, is_dirty(i));
+    }
+
+    // Scenario: 日志全部持久化后，按lsn从小到大写回，直到有8个干净可淘汰的帧
+    bpm->set_persist_lsn_provider([]() { return 1000; });
+    EXPECT_EQ(5, bpm->clean_pages(8));
+    for (int i = 0; i < static_cast<int>(buffer_pool_size); ++i) {
+        EXPECT_EQ(i >= 8, is_dirty(i));
+    }
+    EXPECT_EQ(0, bpm->clean_pages(8));
+    EXPECT_EQ(8, bpm->get_background_writes());
+    EXPECT_EQ(0, bpm->get_foreground_writes());
+
+    // Scenario: 最久未使用的页面0~7已经是干净页面，淘汰它们不需要写盘；之后请求线程只能自己写回脏页
+    for (int i = 0; i < 8; ++i) {
+        ASSERT_NE(nullptr, bpm->new_page(&tmp_page_id));
+        EXPECT_EQ(true, bpm->unpin_page(tmp_page_id, true));
+    }
+    EXPECT_EQ(0, bpm->get_foreground_writes());
+    ASSERT_NE(nullptr, bpm->new_page(&tmp_page_id));
+    EXPECT_EQ(true, bpm->unpin_page(tmp_page_id, true));
+    EXPECT_LT(0, bpm->get_foreground_writes());
+
+    // Scenario: 后台线程把剩余的脏页全部写回（单分区时一轮清理写回全部页面后才更新计数）
+    bpm->start_page_cleaner(buffer_pool_size, std::chrono::milliseconds(10));
+    for (int retry = 0; retry < 200 && bpm->get_background_writes() == 8; ++retry) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    bpm->stop_page_cleaner();
+    EXPECT_LT(8, bpm->get_background_writes());
+    EXPECT_EQ(0, bpm->clean_pages(buffer_pool_size));
+
+    disk_manager_->close_file(fd);
+}
+
 /**
  * @brief 在SimpleTest的基础上加大数据量（单文件），生成测试文件large_scale_test
  * @note lab1 计分：10 points
@@ -427,3 +1436,67 @@ TEST_F(BufferPoolManagerTest, ConcurrencyTest) {
 
     disk_manager_->close_file(fd);
 }
+
+
+/**
+ * @brief 多线程并发fetch/unpin，检查分区缓冲池的正确性，并输出不同线程数下的吞吐
+ * @note 热数据全部在缓冲池中；冷数据是缓冲池大小的4倍，大部分访问需要淘汰页面并在分区锁之外读磁盘
+ * @note 生成测试文件concurrent_fetch_test
+ */
+TEST_F(BufferPoolManagerTest, ConcurrentFetchBenchmark) {
+    const std::string filename = "concurrent_fetch_test";
+    const int buffer_pool_size = 1024;
+    const int num_pages = buffer_pool_size * 4;
+    const int hot_pages = buffer_pool_size / 2;
+    const int total_ops = 40000;
+
+    auto disk_manager = BufferPoolManagerTest::disk_manager_.get();
+    auto bpm = std::make_unique<BufferPoolManager>(static_cast<size_t>(buffer_pool_size), disk_manager);
+    EXPECT_GT(bpm->get_num_shards(), 1);
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+
+    // 每个页面的开头写入自己的page_no，读到错位的页面会导致校验失败
+    for (int i = 0; i < num_pages; i++) {
+        PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+        Page *page = bpm->new_page(&page_id);
+        ASSERT_NE(nullptr, page);
+        memcpy(page->get_data(), &page_id.page_no, sizeof(page_id.page_no));
+        EXPECT_EQ(true, bpm->unpin_page(page_id, true));
+    }
+    bpm->flush_all_pages(fd);
+
+    for (int working_set : {hot_pages, num_pages}) {
+        for (int num_threads : {1, 2, 4, 8, 16, 32}) {
+            std::atomic<int> errors{0};
+            std::vector<std::thread> threads;
+            auto start = std::chrono::steady_clock::now();
+            for (int tid = 0; tid < num_threads; tid++) {
+                threads.emplace_back([&, tid]() {
+                    std::mt19937 rng(tid + working_set);
+                    for (int op = 0; op < total_ops / num_threads; op++) {
+                        PageId page_id = {.fd = fd, .page_no = static_cast<page_id_t>(rng() % working_set)};
+                        Page *page = bpm->fetch_page(page_id);
+                        while (page == nullptr) {
+                            std::this_thread::yield();
+                            page = bpm->fetch_page(page_id);
+                        }
+                        page_id_t stamp;
+                        memcpy(&stamp, page->get_data(), sizeof(stamp));
+                        if (stamp != page_id.page_no) errors++;
+                        if (!bpm->unpin_page(page_id, false)) errors++;
+                    }
+                });
+            }
+            for (auto &thread : threads) {
+                thread.join();
+            }
+            double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            EXPECT_EQ(errors.load(), 0);
+            std::cout << (working_set == hot_pages ? "hot " : "cold") << " threads: " << num_threads
+                      << ", fetch+unpin/s: " << static_cast<long>(total_ops / secs) << std::endl;
+        }
+    }
+
+    disk_manager_->close_file(fd);
+}
@@ -0,0 +1,152 @@
+#include "replacer/clock_replacer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+/**
+ * @brief 简单测试ClockReplacer的基本功能
+ */
+TEST(ClockReplacerTest, SimpleTest) {
+    ClockReplacer clock_replacer(7);
+
+    // Scenario: unpin six elements, i.e. add them to the replacer.
+    clock_replacer.unpin(1);
+    clock_replacer.unpin(2);
+    clock_replacer.unpin(3);
+    clock_replacer.unpin(4);
+    clock_replacer.unpin(5);
+    clock_replacer.unpin(6);
+    clock_replacer.unpin(1);
+    EXPECT_EQ(6, clock_replacer.Size());
+
+    // Scenario: get three victims from the clock.
+    // The first sweep clears every reference bit, the second one evicts in frame order.
+    int value;
+    clock_replacer.victim(&value);
+    EXPECT_EQ(1, value);
+    clock_replacer.victim(&value);
+    EXPECT_EQ(2, value);
+    clock_replacer.victim(&value);
+    EXPECT_EQ(3, value);
+
+    // Scenario: pin elements in the replacer.
+    // Note that 3 has already been victimized, so pinning 3 should have no effect.
+    clock_replacer.pin(3);
+    clock_replacer.pin(4);
+    EXPECT_EQ(2, clock_replacer.Size());
+
+    // Scenario: unpin 4. We expect that the reference bit of 4 will be set to 1.
+    clock_replacer.unpin(4);
+
+    // Scenario: continue looking for victims. 4 gets a second chance.
+    clock_replacer.victim(&value);
+    EXPECT_EQ(5, value);
+    clock_replacer.victim(&value);
+    EXPECT_EQ(6, value);
+    clock_replacer.victim(&value);
+    EXPECT_EQ(4, value);
+    EXPECT_EQ(0, clock_replacer.Size());
+    EXPECT_FALSE(clock_replacer.victim(&value));
+}
+
+/**
+ * @brief 测试访问位：被再次unpin的帧在时钟指针经过时获得第二次机会
+ */
+TEST(ClockReplacerTest, SecondChanceTest) {
+    ClockReplacer clock_replacer(4);
+    for (int i = 0; i < 4; i++) {
+        clock_replacer.unpin(i);
+    }
+
+    // 第一次淘汰清除了所有访问位，淘汰0
+    int value;
+    EXPECT_TRUE(clock_replacer.victim(&value));
+    EXPECT_EQ(0, value);
+
+    // 2被重新访问，访问位重新置1
+    clock_replacer.pin(2);
+    clock_replacer.unpin(2);
+    EXPECT_EQ(3, clock_replacer.Size());
+
+    EXPECT_TRUE(clock_replacer.victim(&value));
+    EXPECT_EQ(1, value);
+    EXPECT_TRUE(clock_replacer.victim(&value));
+    EXPECT_EQ(3, value);
+    EXPECT_TRUE(clock_replacer.victim(&value));
+    EXPECT_EQ(2, value);
+    EXPECT_FALSE(clock_replacer.victim(&value));
+}
+
+/**
+ * @brief 测试扩大帧数：已有帧的状态保持不变，新增的帧可以被unpin和淘汰
+ */
+TEST(ClockReplacerTest, ResizeTest) {
+    ClockReplacer clock_replacer(2);
+    clock_replacer.unpin(0);
+    clock_replacer.unpin(1);
+    clock_replacer.pin(1);
+
+    clock_replacer.resize(4);
+    EXPECT_EQ(1, clock_replacer.Size());
+    clock_replacer.unpin(3);
+    EXPECT_EQ(2, clock_replacer.Size());
+
+    int value;
+    EXPECT_TRUE(clock_replacer.victim(&value));
+    EXPECT_EQ(0, value);
+    EXPECT_TRUE(clock_replacer.victim(&value));
+    EXPECT_EQ(3, value);
+    EXPECT_FALSE(clock_replacer.victim(&value));
+}
+
+/**
+ * @brief 并发测试ClockReplacer
+ */
+TEST(ClockReplacerTest, ConcurrencyTest) {
+    const int num_threads = 5;
+    const int num_runs = 50;
+    for (int run = 0; run < num_runs; run++) {
+        int value_size = 1000;
+        std::shared_ptr<ClockReplacer> clock_replacer{new ClockReplacer(value_size)};
+        std::vector<std::thread> threads;
+        int result;
+        std::vector<int> value(value_size);
+        for (int i = 0; i < value_size; i++) {
+            value[i] = i;
+        }
+        auto rng = std::default_random_engine{};
+        std::shuffle(value.begin(), value.end(), rng);
+
+        for (int tid = 0; tid < num_threads; tid++) {
+            threads.push_back(std::thread([tid, &clock_replacer, &value]() {
+                int share = 1000 / 5;
+                for (int i = 0; i < share; i++) {
+                    clock_replacer->unpin(value[tid * share + i]);
+                    clock_replacer->pin(value[tid * share + i]);
+                    clock_replacer->unpin(value[tid * share + i]);
+                }
+            }));
+        }
+
+        for (int i = 0; i < num_threads; i++) {
+            threads[i].join();
+        }
+        EXPECT_EQ(value_size, clock_replacer->Size());
+        std::vector<int> out_values;
+        for (int i = 0; i < value_size; i++) {
+            EXPECT_EQ(1, clock_replacer->victim(&result));
+            out_values.push_back(result);
+        }
+        std::sort(value.begin(), value.end());
+        std::sort(out_values.begin(), out_values.end());
+        EXPECT_EQ(value, out_values);
+        EXPECT_EQ(0, clock_replacer->victim(&result));
+    }
+}
@@ -1,7 +1,12 @@
 #include "storage/disk_manager.h"
+#include "storage/page_compression.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstring>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -147,3 +152,429 @@ TEST_F(DiskManagerTest, PageOperation) {
     disk_manager_->destroy_file(filename);
     EXPECT_EQ(disk_manager_->is_file(filename), false);
 }
+
+/**
+ * @brief 测试每个文件的I/O统计：读写次数、字节数和延迟直方图，重新打开文件时清零
+ */
+TEST_F(DiskManagerTest, IoStats) {
+    const std::string filename = "IoStatsTestFile";
+    if (disk_manager_->is_file(filename)) {
+        disk_manager_->destroy_file(filename);
+    }
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+    const FileIoStats *stats = disk_manager_->get_io_stats(fd);
+    ASSERT_NE(stats, nullptr);
+    EXPECT_EQ(stats->reads.load(), 0);
+    EXPECT_EQ(stats->writes.load(), 0);
+
+    std::vector<char> page(PAGE_SIZE);
+    rand_buf(page.data(), PAGE_SIZE);
+    for (int page_no = 0; page_no < 4; page_no++) {
+        disk_manager_->write_page(fd, page_no, page.data(), PAGE_SIZE);
+    }
+    // 编号连续的页面合并为一次写入
+    std::vector<const char *> run(4, page.data());
+    disk_manager_->write_page_run(fd, 4, run);
+    for (int page_no = 0; page_no < 8; page_no++) {
+        disk_manager_->read_page(fd, page_no, page.data(), PAGE_SIZE);
+    }
+
+    EXPECT_EQ(stats->writes.load(), 5);
+    EXPECT_EQ(stats->write_bytes.load(), 8 * PAGE_SIZE);
+    EXPECT_EQ(stats->reads.load(), 8);
+    EXPECT_EQ(stats->read_bytes.load(), 8 * PAGE_SIZE);
+    EXPECT_EQ(stats->write_latency.count(), 5);
+    EXPECT_EQ(stats->read_latency.count(), 8);
+    EXPECT_LE(stats->read_latency.percentile_us(0.5), stats->read_latency.percentile_us(0.99));
+    EXPECT_GT(stats->read_latency.percentile_us(0.99), 0);
+
+    std::vector<int> fds = disk_manager_->get_open_fds();
+    EXPECT_NE(std::find(fds.begin(), fds.end(), fd), fds.end());
+    EXPECT_EQ(disk_manager_->get_file_name(fd), filename);
+
+    disk_manager_->close_file(fd);
+    fd = disk_manager_->open_file(filename);
+    stats = disk_manager_->get_io_stats(fd);
+    EXPECT_EQ(stats->reads.load(), 0);
+    EXPECT_EQ(stats->writes.load(), 0);
+
+    disk_manager_->close_file(fd);
+    disk_manager_->destroy_file(filename);
+    EXPECT_EQ(disk_manager_->is_file(filename), false);
+}
+
+/**
+ * @brief 测试write_page_run()把编号连续的页面一次性写入，且不影响相邻页面
+ */
+TEST_F(DiskManagerTest, WritePageRun) {
+    const std::string filename = "WritePageRunTestFile";
+    if (disk_manager_->is_file(filename)) {
+        disk_manager_->destroy_file(filename);
+    }
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+
+    const int num_pages = 64;
+    std::vector<std::vector<char>> pages(num_pages, std::vector<char>(PAGE_SIZE));
+    for (int page_no = 0; page_no < num_pages; page_no++) {
+        rand_buf(pages[page_no].data(), PAGE_SIZE);
+        disk_manager_->write_page(fd, page_no, pages[page_no].data(), PAGE_SIZE);
+    }
+
+    // 覆盖[8, 40)这一段页面
+    std::vector<const char *> run;
+    for (int page_no = 8; page_no < 40; page_no++) {
+        rand_buf(pages[page_no].data(), PAGE_SIZE);
+        run.push_back(pages[page_no].data());
+    }
+    disk_manager_->write_page_run(fd, 8, run);
+
+    char buf[PAGE_SIZE];
+    for (int page_no = 0; page_no < num_pages; page_no++) {
+        disk_manager_->read_page(fd, page_no, buf, PAGE_SIZE);
+        EXPECT_EQ(std::memcmp(buf, pages[page_no].data(), PAGE_SIZE), 0);
+    }
+
+    disk_manager_->close_file(fd);
+    disk_manager_->destroy_file(filename);
+    EXPECT_EQ(disk_manager_->is_file(filename), false);
+}
+
+/**
+ * @brief 多线程并发读写页面，检查pread/pwrite定位读写的正确性，并输出不同线程数下的读吞吐
+ * @note 每个页面的内容由page_no决定，任何线程读到错位的页面都会导致校验失败
+ */
+TEST_F(DiskManagerTest, ConcurrentPageOperation) {
+    const std::string filename = "ConcurrentPageOperationTestFile";
+    const int num_pages = 1024;
+    const int reads_per_thread = 20000;
+    if (disk_manager_->is_file(filename)) {
+        disk_manager_->destroy_file(filename);
+    }
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+
+    // 生成page_no对应的页面内容
+    auto fill_page = [](char *buf, int page_no) {
+        for (int i = 0; i < PAGE_SIZE; i++) {
+            buf[i] = static_cast<char>((page_no * 31 + i) & 0xff);
+        }
+    };
+
+    // 多个线程并发写入互不相交的页面
+    const int num_writers = 8;
+    std::vector<std::thread> writers;
+    for (int tid = 0; tid < num_writers; tid++) {
+        writers.emplace_back([&, tid]() {
+            char data[PAGE_SIZE];
+            for (int page_no = tid; page_no < num_pages; page_no += num_writers) {
+                fill_page(data, page_no);
+                disk_manager_->write_page(fd, page_no, data, PAGE_SIZE);
+            }
+        });
+    }
+    for (auto &t : writers) {
+        t.join();
+    }
+
+    // 不同线程数下并发随机读取页面并校验内容
+    for (int num_threads : {1, 2, 4, 8, 16}) {
+        std::atomic<int> mismatches{0};
+        std::vector<std::thread> readers;
+        auto start = std::chrono::steady_clock::now();
+        for (int tid = 0; tid < num_threads; tid++) {
+            readers.emplace_back([&, tid]() {
+                char buf[PAGE_SIZE];
+                char expected[PAGE_SIZE];
+                unsigned seed = tid + 1;
+                for (int i = 0; i < reads_per_thread; i++) {
+                    int page_no = rand_r(&seed) % num_pages;
+                    disk_manager_->read_page(fd, page_no, buf, PAGE_SIZE);
+                    fill_page(expected, page_no);
+                    if (std::memcmp(buf, expected, PAGE_SIZE) != 0) {
+                        mismatches++;
+                    }
+                }
+            });
+        }
+        for (auto &t : readers) {
+            t.join();
+        }
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        EXPECT_EQ(mismatches.load(), 0);
+        std::cout << "threads: " << num_threads << ", page reads/s: "
+                  << static_cast<long>(num_threads * reads_per_thread / secs) << std::endl;
+    }
+
+    disk_manager_->close_file(fd);
+    disk_manager_->destroy_file(filename);
+    EXPECT_EQ(disk_manager_->is_file(filename), false);
+}
+
+/**
+ * @brief 测试异步/批量页面读写；未开启或者无法开启io_uring时走同步I/O，两种情况结果应当一致
+ */
+TEST_F(DiskManagerTest, AsyncPageOperation) {
+    const std::string filename = "AsyncPageOperationTestFile";
+    const int num_pages = 256;
+    if (disk_manager_->is_file(filename)) {
+        disk_manager_->destroy_file(filename);
+    }
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+
+    for (bool use_ring : {false, true}) {
+        if (use_ring && !disk_manager_->enable_async_io(16)) {
+            std::cout << "io_uring is unavailable, only the synchronous fallback is tested" << std::endl;
+            break;
+        }
+        std::vector<char> data(num_pages * PAGE_SIZE);
+        std::vector<char> buf(num_pages * PAGE_SIZE, 0);
+        rand_buf(data.data(), data.size());
+
+        // 批量写入，再批量读出
+        std::vector<PageIoRequest> writes;
+        for (int page_no = 0; page_no < num_pages; page_no++) {
+            writes.push_back({fd, page_no, &data[page_no * PAGE_SIZE], PAGE_SIZE});
+        }
+        disk_manager_->write_pages(writes);
+        std::vector<PageIoRequest> reads;
+        for (int page_no = 0; page_no < num_pages; page_no++) {
+            reads.push_back({fd, page_no, &buf[page_no * PAGE_SIZE], PAGE_SIZE});
+        }
+        disk_manager_->read_pages(reads);
+        EXPECT_EQ(std::memcmp(buf.data(), data.data(), data.size()), 0);
+
+        // 逐个提交异步读请求，通过poll_completions收集完成的tag
+        std::fill(buf.begin(), buf.end(), 0);
+        for (int page_no = num_pages - 1; page_no >= 0; page_no--) {
+            disk_manager_->submit_read_page(fd, page_no, &buf[page_no * PAGE_SIZE], PAGE_SIZE, page_no);
+        }
+        disk_manager_->submit_async_io();
+        std::vector<uint64_t> tags;
+        while (tags.size() < static_cast<size_t>(num_pages)) {
+            disk_manager_->poll_completions(&tags, 1);
+        }
+        std::sort(tags.begin(), tags.end());
+        for (int page_no = 0; page_no < num_pages; page_no++) {
+            EXPECT_EQ(tags[page_no], static_cast<uint64_t>(page_no));
+        }
+        EXPECT_EQ(std::memcmp(buf.data(), data.data(), data.size()), 0);
+    }
+
+    disk_manager_->close_file(fd);
+    disk_manager_->destroy_file(filename);
+    EXPECT_EQ(disk_manager_->is_file(filename), false);
+}
+
+/**
+ * @brief 测试O_DIRECT模式下的页面读写，包括对齐的整页读写和未对齐/不足一页的读写
+ * @note 文件系统不支持O_DIRECT时会退回普通模式，读写结果应当相同
+ */
+TEST_F(DiskManagerTest, DirectIOPageOperation) {
+    const std::string filename = "DirectIOPageOperationTestFile";
+    if (disk_manager_->is_file(filename)) {
+        disk_manager_->destroy_file(filename);
+    }
+    disk_manager_->set_direct_io(true);
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+    std::cout << "O_DIRECT " << (disk_manager_->is_direct_fd(fd) ? "enabled" : "unsupported, using buffered I/O")
+              << std::endl;
+
+    // 对齐的整页读写
+    char *aligned = static_cast<char *>(std::aligned_alloc(DIRECT_IO_ALIGNMENT, PAGE_SIZE));
+    char *aligned_buf = static_cast<char *>(std::aligned_alloc(DIRECT_IO_ALIGNMENT, PAGE_SIZE));
+    for (int page_no = 0; page_no < MAX_PAGES; page_no++) {
+        rand_buf(aligned, PAGE_SIZE);
+        disk_manager_->write_page(fd, page_no, aligned, PAGE_SIZE);
+        std::memset(aligned_buf, 0, PAGE_SIZE);
+        disk_manager_->read_page(fd, page_no, aligned_buf, PAGE_SIZE);
+        EXPECT_EQ(std::memcmp(aligned, aligned_buf, PAGE_SIZE), 0);
+    }
+
+    // 未对齐的缓冲区，以及只写页面开头若干字节（如文件头），页面其余内容应保持不变
+    char header[100];
+    rand_buf(header, sizeof(header));
+    disk_manager_->read_page(fd, 3, aligned, PAGE_SIZE);
+    disk_manager_->write_page(fd, 3, header, sizeof(header));
+    char read_header[100];
+    disk_manager_->read_page(fd, 3, read_header, sizeof(read_header));
+    EXPECT_EQ(std::memcmp(header, read_header, sizeof(header)), 0);
+    disk_manager_->read_page(fd, 3, aligned_buf, PAGE_SIZE);
+    EXPECT_EQ(std::memcmp(aligned_buf, header, sizeof(header)), 0);
+    EXPECT_EQ(std::memcmp(aligned_buf + sizeof(header), aligned + sizeof(header), PAGE_SIZE - sizeof(header)), 0);
+
+    std::free(aligned);
+    std::free(aligned_buf);
+    disk_manager_->close_file(fd);
+    disk_manager_->destroy_file(filename);
+    disk_manager_->set_direct_io(false);
+    EXPECT_EQ(disk_manager_->is_file(filename), false);
+}
+
+/**
+ * @brief 测试页面释放：空闲页面被allocate_page()复用、文件末尾的空闲页面被截断、空闲页面表在关闭/打开文件后保持不变
+ */
+TEST_F(DiskManagerTest, FreePageMap) {
+    const std::string filename = "FreePageMapTestFile";
+    if (disk_manager_->is_file(filename)) {
+        disk_manager_->destroy_file(filename);
+    }
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+    disk_manager_->set_fd2pageno(fd, 0);
+
+    const int num_pages = 16;
+    char data[PAGE_SIZE] = {0};
+    for (int page_no = 0; page_no < num_pages; page_no++) {
+        EXPECT_EQ(disk_manager_->allocate_page(fd), page_no);
+        rand_buf(data, PAGE_SIZE);
+        disk_manager_->write_page(fd, page_no, data, PAGE_SIZE);
+    }
+    EXPECT_EQ(disk_manager_->get_file_size(filename), num_pages * PAGE_SIZE);
+
+    // 释放中间的页面，文件大小不变，页面进入空闲页面表
+    disk_manager_->deallocate_page(fd, 9);
+    disk_manager_->deallocate_page(fd, 3);
+    disk_manager_->deallocate_page(fd, 5);
+    EXPECT_EQ(disk_manager_->get_num_free_pages(fd), 3);
+    EXPECT_TRUE(disk_manager_->is_free_page(fd, 5));
+    EXPECT_EQ(disk_manager_->get_file_size(filename), num_pages * PAGE_SIZE);
+
+    // 优先复用编号最小的空闲页面
+    EXPECT_EQ(disk_manager_->allocate_page(fd), 3);
+    EXPECT_FALSE(disk_manager_->is_free_page(fd, 3));
+    EXPECT_EQ(disk_manager_->get_num_free_pages(fd), 2);
+
+    // 关闭后重新打开，空闲页面表和已分配的页面个数从.fsm文件中恢复
+    disk_manager_->close_file(fd);
+    disk_manager_->set_fd2pageno(fd, 0);
+    fd = disk_manager_->open_file(filename);
+    EXPECT_EQ(disk_manager_->get_fd2pageno(fd), num_pages);
+    EXPECT_EQ(disk_manager_->get_num_free_pages(fd), 2);
+    EXPECT_TRUE(disk_manager_->is_free_page(fd, 5));
+    EXPECT_TRUE(disk_manager_->is_free_page(fd, 9));
+
+    // 释放文件末尾的页面，与之相连的空闲页面(9)一起被截断
+    for (int page_no = num_pages - 1; page_no >= 10; page_no--) {
+        disk_manager_->deallocate_page(fd, page_no);
+    }
+    EXPECT_EQ(disk_manager_->get_fd2pageno(fd), 9);
+    EXPECT_EQ(disk_manager_->get_num_free_pages(fd), 1);
+    EXPECT_EQ(disk_manager_->get_file_size(filename), 9 * PAGE_SIZE);
+
+    // 写回空闲页面表之后.fsm与内存一致，再次修改时删除过时的.fsm
+    const std::string map_file = filename + DiskManager::FREE_PAGE_MAP_SUFFIX;
+    disk_manager_->flush_free_page_map(fd);
+    EXPECT_TRUE(disk_manager_->is_file(map_file));
+
+    // 空闲页面用完后继续从文件末尾分配
+    EXPECT_EQ(disk_manager_->allocate_page(fd), 5);
+    EXPECT_FALSE(disk_manager_->is_file(map_file));
+    EXPECT_EQ(disk_manager_->allocate_page(fd), 9);
+
+    disk_manager_->close_file(fd);
+    EXPECT_TRUE(disk_manager_->is_file(map_file));
+    disk_manager_->destroy_file(filename);
+    EXPECT_EQ(disk_manager_->is_file(filename), false);
+    EXPECT_EQ(disk_manager_->is_file(filename + DiskManager::FREE_PAGE_MAP_SUFFIX), false);
+}
+
+/**
+ * @brief 测试压缩存储的文件：页面读写对上层透明，定长字段补0的页面压缩后占用的空间明显减少，关闭后重新打开内容不变
+ */
+TEST_F(DiskManagerTest, CompressedPageOperation) {
+    const std::string filename = "CompressedTestFile";
+    if (disk_manager_->is_file(filename)) {
+        disk_manager_->destroy_file(filename);
+    }
+    disk_manager_->create_file(filename, true);
+    int fd = disk_manager_->open_file(filename);
+    ASSERT_TRUE(disk_manager_->is_compressed(fd));
+
+    // 模拟CHAR(64)字段的表页面：每条记录只有开头的几个字节，其余补0
+    const int num_pages = 64;
+    const int record_size = 64;
+    std::vector<std::vector<char>> pages(num_pages, std::vector<char>(PAGE_SIZE, 0));
+    for (int page_no = 0; page_no < num_pages; page_no++) {
+        for (int slot = 0; (slot + 1) * record_size < PAGE_SIZE; slot++) {
+            snprintf(&pages[page_no][slot * record_size + 32], record_size - 32, "row-%d-%d", page_no, slot);
+        }
+    }
+    for (int page_no = 0; page_no < num_pages / 2; page_no++) {
+        disk_manager_->write_page(fd, page_no, pages[page_no].data(), PAGE_SIZE);
+    }
+    std::vector<const char *> run;
+    for (int page_no = num_pages / 2; page_no < num_pages; page_no++) {
+        run.push_back(pages[page_no].data());
+    }
+    disk_manager_->write_page_run(fd, num_pages / 2, run);
+
+    size_t stored = disk_manager_->compressed_file(fd)->get_stored_bytes();
+    std::cout << "compressed " << num_pages * PAGE_SIZE << " bytes into " << stored << " bytes\n";
+    EXPECT_LE(stored * 3, static_cast<size_t>(num_pages * PAGE_SIZE));
+
+    // 不可压缩的页面原样存放；只写入页面的一部分时其余内容不变
+    rand_buf(pages[7].data(), PAGE_SIZE);
+    disk_manager_->write_page(fd, 7, pages[7].data(), PAGE_SIZE);
+    memcpy(pages[3].data(), "partial", 8);
+    disk_manager_->write_page(fd, 3, "partial", 8);
+
+    char buf[PAGE_SIZE];
+    std::vector<char *> read_run;
+    std::vector<std::vector<char>> read_bufs(num_pages, std::vector<char>(PAGE_SIZE));
+    for (int page_no = 0; page_no < num_pages; page_no++) {
+        read_run.push_back(read_bufs[page_no].data());
+    }
+    disk_manager_->read_page_run(fd, 0, read_run);
+    for (int page_no = 0; page_no < num_pages; page_no++) {
+        EXPECT_EQ(std::memcmp(read_bufs[page_no].data(), pages[page_no].data(), PAGE_SIZE), 0);
+    }
+    EXPECT_THROW(disk_manager_->read_page(fd, num_pages, buf, PAGE_SIZE), InternalError);  // 没有写入过的页面
+
+    // 释放的页面不再占用空间
+    stored = disk_manager_->compressed_file(fd)->get_stored_bytes();
+    disk_manager_->set_fd2pageno(fd, num_pages);
+    disk_manager_->deallocate_page(fd, 7);
+    EXPECT_EQ(disk_manager_->compressed_file(fd)->get_stored_bytes(), stored - PAGE_SIZE);
+
+    // 关闭后重新打开，页面映射表从文件中恢复
+    disk_manager_->close_file(fd);
+    EXPECT_LT(disk_manager_->get_file_size(filename), num_pages * PAGE_SIZE / 2);
+    fd = disk_manager_->open_file(filename);
+    ASSERT_TRUE(disk_manager_->is_compressed(fd));
+    for (int page_no = 0; page_no < num_pages; page_no++) {
+        if (page_no == 7) continue;
+        disk_manager_->read_page(fd, page_no, buf, PAGE_SIZE);
+        EXPECT_EQ(std::memcmp(buf, pages[page_no].data(), PAGE_SIZE), 0);
+    }
+    // 释放出来的空间被之后写入的页面复用
+    disk_manager_->write_page(fd, 7, pages[8].data(), PAGE_SIZE);
+    disk_manager_->read_page(fd, 7, buf, PAGE_SIZE);
+    EXPECT_EQ(std::memcmp(buf, pages[8].data(), PAGE_SIZE), 0);
+    disk_manager_->close_file(fd);
+    EXPECT_LT(disk_manager_->get_file_size(filename), num_pages * PAGE_SIZE / 2);
+
+    // 编解码的边界情况：全0、全部不可压缩、短的重复模式
+    std::vector<char> src(PAGE_SIZE, 0), dst(PAGE_SIZE), out(PAGE_SIZE);
+    size_t len = compress_block(src.data(), PAGE_SIZE, dst.data(), PAGE_SIZE);
+    EXPECT_GT(len, 0);
+    EXPECT_LT(len, 32);
+    EXPECT_TRUE(decompress_block(dst.data(), len, out.data(), PAGE_SIZE));
+    EXPECT_EQ(src, out);
+    rand_buf(src.data(), PAGE_SIZE);
+    EXPECT_EQ(compress_block(src.data(), PAGE_SIZE, dst.data(), PAGE_SIZE - 512), 0);
+    for (int i = 0; i < PAGE_SIZE; i++) {
+        src[i] = "abc"[i % 3];
+    }
+    len = compress_block(src.data(), PAGE_SIZE, dst.data(), PAGE_SIZE);
+    ASSERT_GT(len, 0);
+    EXPECT_TRUE(decompress_block(dst.data(), len, out.data(), PAGE_SIZE));
+    EXPECT_EQ(src, out);
+    EXPECT_FALSE(decompress_block(dst.data(), len - 1, out.data(), PAGE_SIZE));
+
+    disk_manager_->destroy_file(filename);
+    EXPECT_EQ(disk_manager_->is_file(filename), false);
+}
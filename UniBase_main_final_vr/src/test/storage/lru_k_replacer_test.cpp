@@ -0,0 +1,206 @@
+#include "replacer/lru_k_replacer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "replacer/lru_replacer.h"
+
+/**
+ * @brief 简单测试LRUKReplacer的基本功能
+ */
+TEST(LRUKReplacerTest, SimpleTest) {
+    LRUKReplacer lru_k_replacer(7, 2);
+
+    // Scenario: access frames 1-6 once, and frame 1 twice.
+    for (int i = 1; i <= 6; i++) {
+        lru_k_replacer.record_access(i);
+    }
+    lru_k_replacer.record_access(1);
+    for (int i = 1; i <= 6; i++) {
+        lru_k_replacer.unpin(i);
+    }
+    EXPECT_EQ(6, lru_k_replacer.Size());
+
+    // Scenario: frames with fewer than k accesses are evicted first, in order of their first access.
+    int value;
+    lru_k_replacer.victim(&value);
+    EXPECT_EQ(2, value);
+    lru_k_replacer.victim(&value);
+    EXPECT_EQ(3, value);
+    lru_k_replacer.victim(&value);
+    EXPECT_EQ(4, value);
+
+    // Scenario: pin elements in the replacer.
+    // Note that 3 has already been victimized, so pinning 3 should have no effect.
+    lru_k_replacer.pin(3);
+    lru_k_replacer.pin(4);
+    EXPECT_EQ(3, lru_k_replacer.Size());
+
+    // Scenario: access 5 again, now 1 and 5 have k accesses and 6 has infinite K-distance.
+    lru_k_replacer.pin(5);
+    lru_k_replacer.record_access(5);
+    lru_k_replacer.unpin(5);
+
+    lru_k_replacer.victim(&value);
+    EXPECT_EQ(6, value);
+    // 1 has the oldest second-to-last access.
+    lru_k_replacer.victim(&value);
+    EXPECT_EQ(1, value);
+    lru_k_replacer.victim(&value);
+    EXPECT_EQ(5, value);
+    EXPECT_EQ(0, lru_k_replacer.Size());
+    EXPECT_FALSE(lru_k_replacer.victim(&value));
+
+    // Scenario: a victimized frame forgets its history.
+    lru_k_replacer.record_access(1);
+    lru_k_replacer.unpin(1);
+    lru_k_replacer.record_access(2);
+    lru_k_replacer.record_access(2);
+    lru_k_replacer.unpin(2);
+    lru_k_replacer.victim(&value);
+    EXPECT_EQ(1, value);
+
+    // Scenario: a removed frame is not evictable and forgets its history.
+    lru_k_replacer.remove(2);
+    EXPECT_EQ(0, lru_k_replacer.Size());
+}
+
+/**
+ * @brief 用Replacer模拟一个缓冲池，按给定的页面访问序列统计命中率
+ */
+static double hit_rate(Replacer *replacer, size_t num_frames, const std::vector<int> &accesses) {
+    std::unordered_map<int, frame_id_t> page_table;
+    std::vector<int> frame_page(num_frames, -1);
+    size_t next_free = 0;
+    size_t hits = 0;
+    for (int page : accesses) {
+        frame_id_t frame_id;
+        auto it = page_table.find(page);
+        if (it != page_table.end()) {
+            hits++;
+            frame_id = it->second;
+        } else {
+            if (next_free < num_frames) {
+                frame_id = static_cast<frame_id_t>(next_free++);
+            } else {
+                EXPECT_TRUE(replacer->victim(&frame_id));
+                page_table.erase(frame_page[frame_id]);
+            }
+            page_table[page] = frame_id;
+            frame_page[frame_id] = page;
+        }
+        // fetch_page + unpin_page
+        replacer->pin(frame_id);
+        replacer->record_access(frame_id);
+        replacer->unpin(frame_id);
+    }
+    return static_cast<double>(hits) / accesses.size();
+}
+
+/**
+ * @brief 热点页面的点查询与大表顺序扫描交替进行，LRU-K应当保留热点页面
+ */
+TEST(LRUKReplacerTest, ScanResistanceTest) {
+    const size_t num_frames = 128;
+    const int hot_pages = 64;
+    const int scan_pages = 1024;
+    const int rounds = 20;
+
+    std::vector<int> accesses;
+    auto rng = std::default_random_engine{};
+    std::uniform_int_distribution<int> hot_dist(0, hot_pages - 1);
+    for (int round = 0; round < rounds; round++) {
+        // OLTP: 点查询访问热点页面
+        for (int i = 0; i < 1000; i++) {
+            accesses.push_back(hot_dist(rng));
+        }
+        // SELECT *: 顺序扫描一遍大表，页面编号与热点页面不重叠
+        for (int i = 0; i < scan_pages; i++) {
+            accesses.push_back(hot_pages + i);
+        }
+    }
+
+    LRUReplacer lru_replacer(num_frames);
+    LRUKReplacer lru_k_replacer(num_frames, 2);
+    double lru_hit_rate = hit_rate(&lru_replacer, num_frames, accesses);
+    double lru_k_hit_rate = hit_rate(&lru_k_replacer, num_frames, accesses);
+    printf("LRU hit rate: %.3f, LRU-2 hit rate: %.3f\n", lru_hit_rate, lru_k_hit_rate);
+
+    // 扫描页面只访问一次，永远不会命中；热点页面在LRU下每轮被扫描冲掉，在LRU-K下常驻
+    const double hot_fraction = 1000.0 / (1000 + scan_pages);
+    EXPECT_GT(lru_k_hit_rate, hot_fraction * 0.95);
+    EXPECT_GT(lru_k_hit_rate, lru_hit_rate);
+}
+
+/**
+ * @brief 测试扩大帧数：已有帧的访问记录保持不变，新增的帧没有访问记录
+ */
+TEST(LRUKReplacerTest, ResizeTest) {
+    LRUKReplacer lru_k_replacer(2, 2);
+    lru_k_replacer.record_access(0);
+    lru_k_replacer.record_access(0);
+    lru_k_replacer.unpin(0);
+
+    lru_k_replacer.resize(4);
+    lru_k_replacer.record_access(3);
+    lru_k_replacer.unpin(3);
+    EXPECT_EQ(2, lru_k_replacer.Size());
+
+    // 3只访问了一次，K-distance为无穷大，先于0被淘汰
+    int value;
+    EXPECT_TRUE(lru_k_replacer.victim(&value));
+    EXPECT_EQ(3, value);
+    EXPECT_TRUE(lru_k_replacer.victim(&value));
+    EXPECT_EQ(0, value);
+    EXPECT_FALSE(lru_k_replacer.victim(&value));
+}
+
+/**
+ * @brief 并发测试LRUKReplacer
+ */
+TEST(LRUKReplacerTest, ConcurrencyTest) {
+    const int num_threads = 5;
+    const int num_runs = 50;
+    for (int run = 0; run < num_runs; run++) {
+        int value_size = 1000;
+        std::shared_ptr<LRUKReplacer> lru_k_replacer{new LRUKReplacer(value_size, 2)};
+        std::vector<std::thread> threads;
+        int result;
+        std::vector<int> value(value_size);
+        for (int i = 0; i < value_size; i++) {
+            value[i] = i;
+        }
+        auto rng = std::default_random_engine{};
+        std::shuffle(value.begin(), value.end(), rng);
+
+        for (int tid = 0; tid < num_threads; tid++) {
+            threads.push_back(std::thread([tid, &lru_k_replacer, &value]() {
+                int share = 1000 / 5;
+                for (int i = 0; i < share; i++) {
+                    lru_k_replacer->record_access(value[tid * share + i]);
+                    lru_k_replacer->unpin(value[tid * share + i]);
+                }
+            }));
+        }
+
+        for (int i = 0; i < num_threads; i++) {
+            threads[i].join();
+        }
+        EXPECT_EQ(value_size, lru_k_replacer->Size());
+        std::vector<int> out_values;
+        for (int i = 0; i < value_size; i++) {
+            EXPECT_EQ(1, lru_k_replacer->victim(&result));
+            out_values.push_back(result);
+        }
+        std::sort(value.begin(), value.end());
+        std::sort(out_values.begin(), out_values.end());
+        EXPECT_EQ(value, out_values);
+        EXPECT_EQ(0, lru_k_replacer->victim(&result));
+    }
+}
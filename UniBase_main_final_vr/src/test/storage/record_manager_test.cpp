@@ -223,4 +223,137 @@ TEST(RecordManagerTest, MultipleFilesTest) {
         std::string filename = filenames[i];
         rm_manager->destroy_file(filename);
     }
-}
\ No newline at end of file
+}
+/**
+ * @brief 测试Bitmap::next_bit：与逐位检查的结果一致，包括不是8的倍数的长度、从任意位置开始查找以及稀疏的bitmap
+ */
+TEST(RecordManagerTest, BitmapTest) {
+    srand((unsigned)time(nullptr));
+    char bm[BUFFER_LENGTH / 8];
+    auto naive_next_bit = [](bool bit, const char *bm, int max_n, int curr) {
+        for (int i = curr + 1; i < max_n; i++) {
+            if (Bitmap::is_set(bm, i) == bit) return i;
+        }
+        return max_n;
+    };
+    for (int round = 0; round < 200; round++) {
+        int max_n = 1 + rand() % (BUFFER_LENGTH / 8 * BITMAP_WIDTH - 1);
+        int density = rand() % 4;  // 0:全0 1:稀疏 2:随机 3:全1
+        Bitmap::init(bm, sizeof(bm));
+        for (int i = 0; i < max_n; i++) {
+            bool set = density == 3 || (density == 1 && rand() % 200 == 0) || (density == 2 && rand() % 2 == 0);
+            if (set) Bitmap::set(bm, i);
+        }
+        // max_n之后的位不应该影响结果
+        for (int i = max_n; i < (max_n + BITMAP_WIDTH - 1) / BITMAP_WIDTH * BITMAP_WIDTH; i++) {
+            if (rand() % 2 == 0) Bitmap::set(bm, i);
+        }
+        for (bool bit : {false, true}) {
+            for (int curr = -1; curr < max_n; curr = naive_next_bit(bit, bm, max_n, curr)) {
+                ASSERT_EQ(Bitmap::next_bit(bit, bm, max_n, curr), naive_next_bit(bit, bm, max_n, curr));
+            }
+            int curr = rand() % max_n;
+            ASSERT_EQ(Bitmap::next_bit(bit, bm, max_n, curr), naive_next_bit(bit, bm, max_n, curr));
+            ASSERT_EQ(Bitmap::first_bit(bit, bm, max_n), naive_next_bit(bit, bm, max_n, -1));
+        }
+    }
+}
+
+/**
+ * @brief 测试RmScan按页面扫描：稀疏的表上返回所有记录，每个页面只访问一次缓冲池
+ */
+TEST(RecordManagerTest, ScanTest) {
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    std::string filename = "scan.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    rm_manager->create_file(filename, 32);
+    auto file_handle = rm_manager->open_file(filename);
+
+    // 插入约50个页面的记录，再删除其中的大部分
+    char write_buf[PAGE_SIZE];
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+    int num_records = file_handle->file_hdr_.num_records_per_page * 50;
+    std::vector<Rid> rids;
+    for (int i = 0; i < num_records; i++) {
+        rand_buf(file_handle->file_hdr_.record_size, write_buf);
+        Rid rid = file_handle->insert_record(write_buf, context);
+        mock[rid] = std::string(write_buf, file_handle->file_hdr_.record_size);
+        rids.push_back(rid);
+    }
+    for (size_t i = 0; i < rids.size(); i++) {
+        if (i % 17 != 0) {
+            file_handle->delete_record(rids[i], context);
+            mock.erase(rids[i]);
+        }
+    }
+
+    BufferPoolStats before = buffer_pool_manager->get_stats();
+    std::vector<Rid> scanned;
+    for (RmScan scan(file_handle.get()); !scan.is_end(); scan.next()) {
+        scanned.push_back(scan.rid());
+    }
+    BufferPoolStats after = buffer_pool_manager->get_stats();
+    uint64_t fetches = after[BUFFER_HIT] + after[BUFFER_MISS] - before[BUFFER_HIT] - before[BUFFER_MISS];
+    EXPECT_LE(fetches, static_cast<uint64_t>(file_handle->file_hdr_.num_pages));
+
+    // 按(page_no, slot_no)升序返回每条记录恰好一次
+    ASSERT_EQ(scanned.size(), mock.size());
+    for (size_t i = 0; i < scanned.size(); i++) {
+        EXPECT_EQ(mock.count(scanned[i]), 1);
+        if (i > 0) {
+            EXPECT_TRUE(scanned[i - 1].page_no < scanned[i].page_no ||
+                        (scanned[i - 1].page_no == scanned[i].page_no && scanned[i - 1].slot_no < scanned[i].slot_no));
+        }
+    }
+
+    // 记录视图直接指向页面中的记录，销毁后页面可以被修改
+    {
+        RmRecordView view = file_handle->get_record_view(scanned[0], context);
+        EXPECT_EQ(view.size, file_handle->file_hdr_.record_size);
+        EXPECT_EQ(memcmp(view.data, mock.at(scanned[0]).c_str(), view.size), 0);
+        EXPECT_EQ(memcmp(view.to_record()->data, view.data, view.size), 0);
+    }
+    file_handle->delete_record(scanned[0], context);
+    EXPECT_THROW(file_handle->get_record_view(scanned[0], context), RecordNotFoundError);
+
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+}
+
+/**
+ * @brief 测试文件格式版本：第1版的表文件(文件头没有魔数和版本)打开时报错，并且不占用文件描述符
+ */
+TEST(RecordManagerTest, FormatVersionTest) {
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    std::string filename = "format.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    rm_manager->create_file(filename, 32);
+    auto file_handle = rm_manager->open_file(filename);
+    EXPECT_EQ(file_handle->file_hdr_.magic, Page::FILE_MAGIC);
+    EXPECT_EQ(file_handle->file_hdr_.format_version, Page::FILE_FORMAT_VERSION);
+    rm_manager->close_file(file_handle.get());
+
+    // 第1版的文件头从record_size开始
+    int old_hdr[5] = {32, 1, 100, RM_NO_PAGE, 13};
+    int fd = disk_manager->open_file(filename);
+    disk_manager->write_page(fd, RM_FILE_HDR_PAGE, reinterpret_cast<char *>(old_hdr), sizeof(old_hdr));
+    disk_manager->close_file(fd);
+    EXPECT_THROW(rm_manager->open_file(filename), FileFormatError);
+    EXPECT_THROW(rm_manager->open_file(filename), FileFormatError);
+
+    rm_manager->destroy_file(filename);
+}
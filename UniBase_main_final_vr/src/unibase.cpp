@@ -251,17 +251,44 @@ void start_server() {
 }
 
 int main(int argc, char **argv) {
-    if (argc != 2) {
-        // 需要指定数据库名称
-        std::cerr << "Usage: " << argv[0] << " <database>" << std::endl;
+    if (argc != 2 && argc != 3) {
+        // 需要指定数据库名称，缓冲池的帧数可选，默认为BUFFER_POOL_SIZE
+        std::cerr << "Usage: " << argv[0] << " <database> [buffer_pool_size]" << std::endl;
         exit(1);
     }
+    size_t pool_size = BUFFER_POOL_SIZE;
+    if (argc == 3) {
+        char *end = nullptr;
+        pool_size = strtoul(argv[2], &end, 10);
+        if (*end != '\0' || pool_size == 0) {
+            std::cerr << "Invalid buffer pool size: " << argv[2] << std::endl;
+            exit(1);
+        }
+    }
 
     signal(SIGINT, sigint_handler);
     try {
         std::cout << "Welcome to UniBase!\n"
                      "Type 'help;' for help.\n"
                      "\n";
+        if (pool_size != BUFFER_POOL_SIZE) {
+            // 打开数据库之前调整缓冲池大小；缩小时回收的帧的内存归还给操作系统，
+            // 使用MAP_HUGETLB大页时只能按整个大页归还，没有归还的内存在这里报告
+            std::cout << "buffer pool size: " << buffer_pool_manager->resize(pool_size) << "\n";
+            if (size_t retained = buffer_pool_manager->get_retained_memory(); retained > 0) {
+                std::cout << "buffer pool: " << retained << " bytes of retired frames stay in huge pages\n";
+            }
+        }
+        disk_manager->set_direct_io(ENABLE_DIRECT_IO);
+        // 尝试开启io_uring异步I/O，内核不支持时使用同步I/O
+        if (!disk_manager->enable_async_io(ASYNC_IO_QUEUE_DEPTH)) {
+            std::cout << "io_uring is unavailable, falling back to synchronous I/O\n";
+        }
+        // 后台写回脏页，淘汰页面时尽量不在客户端线程上写盘
+        // 没有设置persist_lsn_provider，清理线程不检查WAL规则，因此默认关闭
+        if (ENABLE_PAGE_CLEANER) {
+            buffer_pool_manager->start_page_cleaner(PAGE_CLEANER_CLEAN_FRAMES);
+        }
         // Database name is passed by args
         std::string db_name = argv[1];
         if (!sm_manager->is_dir(db_name)) {